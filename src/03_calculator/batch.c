@@ -0,0 +1,207 @@
+#include <errno.h>   // errno
+#include <fcntl.h>   // open, O_RDONLY
+#include <pthread.h> // pthread_*
+#include <stdbool.h> // bool, true, false
+#include <stdio.h>   // fprintf, fwrite, snprintf, stderr, stdout
+#include <stdlib.h>  // realloc, free, malloc
+#include <string.h>  // memchr, strerror
+
+#include <sys/mman.h> // mmap, munmap
+#include <sys/stat.h> // fstat
+#include <unistd.h>   // close
+
+#include "batch.h"
+#include "eval.h"          // eval, eval_state_*
+#include "eval_cache.h"    // eval_cache_*, eval_cached
+#include "format_number.h" // format_number, format_integer, FORMAT_NUMBER_MAX_LEN
+
+// input bytes handed to each thread per round. bounds the memory used for buffered output.
+#define BATCH_CHUNK_SIZE (1 << 22)
+
+typedef struct {
+    const char* begin_p;
+    const char* end_p;
+    const batch_options_type* options_p;
+    eval_cache_type* cache_p; // kept across rounds, or NULL
+
+    char* out_buf;
+    size_t out_len;
+    size_t out_capacity;
+    bool oom;
+} batch_worker_type;
+
+static bool batch_worker_reserve(batch_worker_type* worker_p, size_t n) {
+    if (worker_p->out_len + n <= worker_p->out_capacity) {
+        return true;
+    }
+    size_t new_capacity = worker_p->out_capacity == 0 ? 4096 : worker_p->out_capacity;
+    while (new_capacity < worker_p->out_len + n) {
+        new_capacity *= 2;
+    }
+    char* buf = realloc(worker_p->out_buf, new_capacity);
+    if (buf == NULL) {
+        return false;
+    }
+    worker_p->out_buf = buf;
+    worker_p->out_capacity = new_capacity;
+    return true;
+}
+
+static void* batch_worker_run(void* arg) {
+    batch_worker_type* worker_p = arg;
+
+    eval_state_type state;
+    eval_state_init(&state, false);
+    state.int_mode = worker_p->options_p->int_mode;
+    int precision = worker_p->options_p->precision;
+
+    const char* line_p = worker_p->begin_p;
+    while (line_p < worker_p->end_p) {
+        const char* newline_p = memchr(line_p, '\n', (size_t)(worker_p->end_p - line_p));
+        const char* next_p = newline_p != NULL ? newline_p + 1 : worker_p->end_p;
+
+        double value = worker_p->cache_p != NULL ? eval_cached(&state, worker_p->cache_p, line_p, next_p - line_p)
+                                                 : eval(&state, line_p, next_p - line_p);
+
+        // longest possible output: a formatted number, or an error message with its column.
+        if (!batch_worker_reserve(worker_p, 128)) {
+            worker_p->oom = true;
+            return NULL;
+        }
+        char* dest_p = &worker_p->out_buf[worker_p->out_len];
+        size_t avail = worker_p->out_capacity - worker_p->out_len;
+        int written;
+        if (state.error_msg == NULL && state.last_value_is_int && precision < 0) {
+            written = (int)format_integer(state.last_int_value, dest_p);
+            dest_p[written++] = '\n';
+        } else if (state.error_msg == NULL) {
+            written = (int)format_number(value, precision, dest_p);
+            dest_p[written++] = '\n';
+        } else if (state.error_index < 0) {
+            written = snprintf(dest_p, avail, "error: %s\n", state.error_msg);
+        } else {
+            written = snprintf(dest_p, avail, "error: col %zd: %s\n", state.error_index + 1, state.error_msg);
+        }
+        worker_p->out_len += (size_t)written;
+
+        line_p = next_p;
+    }
+    return NULL;
+}
+
+// return the position after the newline at or after `p`, or `end_p`.
+static const char* batch_next_line(const char* p, const char* end_p) {
+    if (p >= end_p) {
+        return end_p;
+    }
+    const char* newline_p = memchr(p, '\n', (size_t)(end_p - p));
+    return newline_p != NULL ? newline_p + 1 : end_p;
+}
+
+bool batch_eval_file(const char* path, const batch_options_type* options_p) {
+    size_t thread_count = options_p->thread_count;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        close(fd);
+        return false;
+    }
+    size_t size = (size_t)st.st_size;
+    if (size == 0) {
+        close(fd);
+        return true;
+    }
+    const char* data_p = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data_p == MAP_FAILED) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return false;
+    }
+    madvise((void*)data_p, size, MADV_SEQUENTIAL);
+
+    bool success = false;
+    batch_worker_type* workers_p = calloc(thread_count, sizeof(batch_worker_type));
+    pthread_t* threads_p = calloc(thread_count, sizeof(pthread_t));
+    if (workers_p == NULL || threads_p == NULL) {
+        fprintf(stderr, "%s\n", EVAL_OOM_ERROR_MSG);
+        goto cleanup;
+    }
+    for (size_t i = 0; i < thread_count; i++) {
+        workers_p[i].options_p = options_p;
+        if (options_p->cache_capacity > 0) {
+            workers_p[i].cache_p = eval_cache_create(options_p->cache_capacity);
+            if (workers_p[i].cache_p == NULL) {
+                fprintf(stderr, "%s\n", EVAL_OOM_ERROR_MSG);
+                goto cleanup;
+            }
+        }
+    }
+
+    // every round, split the next `thread_count` chunks on line boundaries, evaluate them in parallel and write the
+    // output of the workers in order.
+    const char* end_p = data_p + size;
+    const char* pos_p = data_p;
+    while (pos_p < end_p) {
+        for (size_t i = 0; i < thread_count; i++) {
+            const char* chunk_end_p = (size_t)(end_p - pos_p) > BATCH_CHUNK_SIZE ? pos_p + BATCH_CHUNK_SIZE : end_p;
+            workers_p[i].begin_p = pos_p;
+            workers_p[i].end_p = chunk_end_p == end_p ? end_p : batch_next_line(chunk_end_p - 1, end_p);
+            workers_p[i].out_len = 0;
+            pos_p = workers_p[i].end_p;
+        }
+
+        size_t started = 0;
+        for (; started < thread_count; started++) {
+            if (pthread_create(&threads_p[started], NULL, batch_worker_run, &workers_p[started]) != 0) {
+                break;
+            }
+        }
+        // chunks without a thread are evaluated on the calling thread
+        for (size_t i = started; i < thread_count; i++) {
+            batch_worker_run(&workers_p[i]);
+        }
+        for (size_t i = 0; i < started; i++) {
+            pthread_join(threads_p[i], NULL);
+        }
+
+        for (size_t i = 0; i < thread_count; i++) {
+            if (workers_p[i].oom) {
+                fprintf(stderr, "%s\n", EVAL_OOM_ERROR_MSG);
+                goto cleanup;
+            }
+            if (workers_p[i].out_len > 0) {
+                fwrite(workers_p[i].out_buf, 1, workers_p[i].out_len, stdout);
+            }
+        }
+    }
+    success = true;
+
+    if (options_p->print_cache_stats && options_p->cache_capacity > 0) {
+        eval_cache_stats_type total = {0};
+        for (size_t i = 0; i < thread_count; i++) {
+            eval_cache_stats_type stats = eval_cache_stats(workers_p[i].cache_p);
+            total.hits += stats.hits;
+            total.misses += stats.misses;
+            total.evictions += stats.evictions;
+        }
+        fprintf(stderr, "cache: %zu hits, %zu misses, %zu evictions\n", total.hits, total.misses, total.evictions);
+    }
+
+cleanup:
+    if (workers_p != NULL) {
+        for (size_t i = 0; i < thread_count; i++) {
+            eval_cache_destroy(workers_p[i].cache_p);
+            free(workers_p[i].out_buf);
+        }
+    }
+    free(workers_p);
+    free(threads_p);
+    munmap((void*)data_p, size);
+
+    return success;
+}
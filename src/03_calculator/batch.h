@@ -0,0 +1,18 @@
+#pragma once
+
+#include <stdbool.h> // bool
+#include <stddef.h>  // size_t
+
+#include "eval.h" // eval_int_mode_type
+
+typedef struct {
+    size_t thread_count;
+    int precision; // as for `format_number`. exact integer results are printed in full unless it is given
+    eval_int_mode_type int_mode;
+    size_t cache_capacity;  // expressions cached per thread, or 0 for none
+    bool print_cache_stats; // write the summed cache counters to stderr when done
+} batch_options_type;
+
+// evaluate every line of the file at `path` using `options_p->thread_count` threads, and write the results to stdout in
+// input order. `_` is not available in batch mode, since lines are evaluated independently.
+bool batch_eval_file(const char* path, const batch_options_type* options_p);
@@ -0,0 +1,286 @@
+/*
+    benchmark for expression evaluation, by phase.
+
+    usage: ./bench_eval CORPUS_FILE [EXPECTED_FILE]
+
+    the corpus has one expression per line, as written by gen_corpus.py. every phase is timed over the whole corpus:
+    - lexer:          `eval_lex`
+    - shunting yard:  `eval_compile` minus the lexer
+    - postfix eval:   `eval_program_run` on the compiled programs
+    and is run once more in a child process to measure how much its peak RSS grows. with an expected file, every line is
+    first evaluated with `eval` and compared against the reference result.
+*/
+
+#include <ctype.h>    // isdigit
+#include <inttypes.h> // PRId64
+#include <math.h>     // isnan
+#include <stdbool.h>  // bool, true, false
+#include <stdint.h>   // int64_t
+#include <stdio.h>    // printf, fprintf, fopen, fread
+#include <stdlib.h>   // malloc, free, strtod, strtoll
+#include <time.h>     // clock_gettime
+
+#include <sys/resource.h> // getrusage
+#include <sys/stat.h>     // stat
+#include <sys/wait.h>     // waitpid
+#include <unistd.h>       // fork, pipe, read, write, _exit
+
+#include "eval.h" // eval, eval_lex, eval_compile, eval_program_*
+
+#define REPEAT_COUNT 5
+#define MISMATCHES_SHOWN 10
+
+typedef struct {
+    size_t begin;
+    size_t len;
+} span_type;
+
+typedef enum { LEX_PHASE, COMPILE_PHASE, RUN_PHASE } phase_type;
+
+static char* corpus_p;
+static span_type* spans_p;
+static size_t span_count;
+static eval_program_type** programs_pp;
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return 1e9 * (double)ts.tv_sec + (double)ts.tv_nsec;
+}
+
+static char* read_file(const char* path, size_t* size_p) {
+    struct stat st;
+    FILE* fp = fopen(path, "r");
+    if (fp == NULL || stat(path, &st) != 0) {
+        if (fp != NULL) {
+            fclose(fp);
+        }
+        return NULL;
+    }
+    char* data_p = malloc((size_t)st.st_size + 1);
+    if (data_p != NULL) {
+        *size_p = fread(data_p, 1, (size_t)st.st_size, fp);
+        data_p[*size_p] = '\0';
+    }
+    fclose(fp);
+    return data_p;
+}
+
+// split `data_p` into lines. returns the number of lines.
+static size_t split_lines(const char* data_p, size_t size, span_type* lines_p) {
+    size_t count = 0;
+    for (size_t begin = 0, end = 0; begin < size; begin = end + 1) {
+        for (end = begin; end < size && data_p[end] != '\n'; end++) {
+        }
+        lines_p[count++] = (span_type){.begin = begin, .len = end - begin};
+    }
+    return count;
+}
+
+static size_t count_lines(const char* data_p, size_t size) {
+    size_t count = 0;
+    for (size_t i = 0; i < size; i++) {
+        count += data_p[i] == '\n';
+    }
+    return count + (size > 0 && data_p[size - 1] != '\n');
+}
+
+// run a phase over the whole corpus once. returns the number of lexemes for the lexer, otherwise 0.
+static size_t run_phase(phase_type phase) {
+    eval_state_type state;
+    eval_state_init(&state, true);
+    size_t lexeme_count = 0;
+
+    for (size_t i = 0; i < span_count; i++) {
+        const char* str = &corpus_p[spans_p[i].begin];
+        ssize_t len = (ssize_t)spans_p[i].len;
+        switch (phase) {
+        case LEX_PHASE:
+            lexeme_count += eval_lex(&state, str, len);
+            break;
+        case COMPILE_PHASE:
+            eval_program_destroy(eval_compile(&state, str, len));
+            break;
+        case RUN_PHASE:
+            if (programs_pp[i] != NULL) {
+                eval_program_run(&state, programs_pp[i], NULL);
+            }
+            break;
+        }
+    }
+    return lexeme_count;
+}
+
+static double time_phase(phase_type phase) {
+    double best = 1e300;
+    for (int rep = 0; rep < REPEAT_COUNT; rep++) {
+        double t0 = now_ns();
+        run_phase(phase);
+        double t = now_ns() - t0;
+        best = t < best ? t : best;
+    }
+    return best;
+}
+
+// growth of the peak RSS in KiB while running the phase, measured in a child so phases do not mask each other.
+static long peak_rss_growth_kib(phase_type phase) {
+    int fds[2];
+    if (pipe(fds) != 0) {
+        return -1;
+    }
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(fds[0]);
+        close(fds[1]);
+        return -1;
+    }
+    if (pid == 0) {
+        struct rusage before, after;
+        getrusage(RUSAGE_SELF, &before);
+        run_phase(phase);
+        getrusage(RUSAGE_SELF, &after);
+        long growth = after.ru_maxrss - before.ru_maxrss;
+        ssize_t written = write(fds[1], &growth, sizeof(growth));
+        _exit(written == sizeof(growth) ? 0 : 1);
+    }
+    close(fds[1]);
+    long growth = -1;
+    if (read(fds[0], &growth, sizeof(growth)) != sizeof(growth)) {
+        growth = -1;
+    }
+    close(fds[0]);
+    waitpid(pid, NULL, 0);
+    return growth;
+}
+
+// the reference writes exact integer results without '.' or an exponent
+static bool is_integer_text(const char* str, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        if (!isdigit((unsigned char)str[i]) && !(i == 0 && str[i] == '-')) {
+            return false;
+        }
+    }
+    return len > 0;
+}
+
+// evaluate every line in order and compare against the reference. returns the number of mismatches.
+static size_t cross_check(const char* expected_data_p, const span_type* expected_lines_p) {
+    eval_state_type state;
+    eval_state_init(&state, true);
+    size_t mismatches = 0;
+
+    for (size_t i = 0; i < span_count; i++) {
+        const char* str = &corpus_p[spans_p[i].begin];
+        double value = eval(&state, str, (ssize_t)spans_p[i].len);
+
+        const char* expected_str = &expected_data_p[expected_lines_p[i].begin];
+        bool expected_is_int = is_integer_text(expected_str, expected_lines_p[i].len);
+        bool match;
+        if (state.error_msg != NULL) {
+            match = false;
+        } else if (expected_is_int) {
+            match = state.last_value_is_int && state.last_int_value == strtoll(expected_str, NULL, 10);
+        } else {
+            double expected = strtod(expected_str, NULL);
+            match = !state.last_value_is_int &&
+                    (isnan(expected) ? isnan(value) : value == expected && signbit(value) == signbit(expected));
+        }
+        if (!match && mismatches++ < MISMATCHES_SHOWN) {
+            printf("line %zu: %.*s\n", i + 1, (int)spans_p[i].len, str);
+            if (state.error_msg != NULL) {
+                printf("  error: %s expected: %.*s\n", state.error_msg, (int)expected_lines_p[i].len, expected_str);
+            } else if (state.last_value_is_int) {
+                printf("  got: %" PRId64 " expected: %.*s\n", state.last_int_value, (int)expected_lines_p[i].len,
+                       expected_str);
+            } else {
+                printf("  got: %.17g expected: %.*s\n", value, (int)expected_lines_p[i].len, expected_str);
+            }
+        }
+    }
+    return mismatches;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s CORPUS_FILE [EXPECTED_FILE]\n", argv[0]);
+        return 1;
+    }
+    size_t size = 0;
+    corpus_p = read_file(argv[1], &size);
+    if (corpus_p == NULL) {
+        fprintf(stderr, "Could not load corpus.\n");
+        return 1;
+    }
+    spans_p = malloc(sizeof(span_type) * (count_lines(corpus_p, size) + 1));
+    if (spans_p == NULL) {
+        fprintf(stderr, "Out of memory.\n");
+        return 1;
+    }
+    span_count = split_lines(corpus_p, size, spans_p);
+    printf("corpus: %zu bytes, %zu expressions\n", size, span_count);
+
+    int exit_code = 0;
+    if (argc > 2) {
+        size_t expected_size = 0;
+        char* expected_data_p = read_file(argv[2], &expected_size);
+        span_type* expected_lines_p =
+            expected_data_p != NULL ? malloc(sizeof(span_type) * (count_lines(expected_data_p, expected_size) + 1)) : NULL;
+        if (expected_lines_p == NULL) {
+            fprintf(stderr, "Could not load expected results.\n");
+            return 1;
+        }
+        if (split_lines(expected_data_p, expected_size, expected_lines_p) != span_count) {
+            fprintf(stderr, "Expected %zu results.\n", span_count);
+            return 1;
+        }
+        size_t mismatches = cross_check(expected_data_p, expected_lines_p);
+        printf("cross-check: %zu mismatches\n", mismatches);
+        exit_code = mismatches == 0 ? 0 : 1;
+        free(expected_lines_p);
+        free(expected_data_p);
+    }
+
+    size_t lexeme_count = run_phase(LEX_PHASE);
+    printf("lexemes: %zu\n\n", lexeme_count);
+
+    double lex_ns = time_phase(LEX_PHASE);
+    long lex_rss = peak_rss_growth_kib(LEX_PHASE);
+    double compile_ns = time_phase(COMPILE_PHASE);
+    long compile_rss = peak_rss_growth_kib(COMPILE_PHASE);
+
+    eval_state_type state;
+    eval_state_init(&state, true);
+    programs_pp = malloc(sizeof(eval_program_type*) * (span_count + 1));
+    if (programs_pp == NULL) {
+        fprintf(stderr, "Out of memory.\n");
+        return 1;
+    }
+    for (size_t i = 0; i < span_count; i++) {
+        programs_pp[i] = eval_compile(&state, &corpus_p[spans_p[i].begin], (ssize_t)spans_p[i].len);
+    }
+    double run_ns = time_phase(RUN_PHASE);
+    long run_rss = peak_rss_growth_kib(RUN_PHASE);
+
+    printf("%-14s %12s %14s %10s %14s\n", "phase", "ns/expr", "expr/s", "ns/lexeme", "peak RSS +KiB");
+    const char* names[] = {"lexer", "shunting yard", "postfix eval", "total"};
+    double times[] = {lex_ns, compile_ns - lex_ns, run_ns, compile_ns + run_ns};
+    long rss[] = {lex_rss, compile_rss, run_rss, -1};
+    for (int i = 0; i < 4; i++) {
+        printf("%-14s %12.1f %14.0f %10.2f ", names[i], times[i] / (double)span_count, 1e9 * (double)span_count / times[i],
+               times[i] / (double)lexeme_count);
+        if (rss[i] >= 0) {
+            printf("%14ld\n", rss[i]);
+        } else {
+            printf("%14s\n", "-");
+        }
+    }
+    printf("\nshunting yard RSS includes the lexer, as it cannot run on its own.\n");
+
+    for (size_t i = 0; i < span_count; i++) {
+        eval_program_destroy(programs_pp[i]);
+    }
+    free(programs_pp);
+    free(spans_p);
+    free(corpus_p);
+    return exit_code;
+}
@@ -0,0 +1,213 @@
+/*
+    benchmark for number literal parsing.
+
+    usage: ./bench_number [CORPUS_FILE]
+
+    every number literal in the corpus (one expression per line) is parsed with the hand-rolled loop `eval` used to
+    have, with `parse_number`, and with `strtod`, and results are compared bit for bit against `strtod`. without a
+    corpus file, a numeric-heavy corpus is generated.
+*/
+
+#include <ctype.h>   // isdigit
+#include <stdint.h>  // uint64_t
+#include <stdio.h>   // printf, fprintf, fopen, fread, snprintf
+#include <stdlib.h>  // malloc, free, strtod
+#include <string.h>  // memcpy
+#include <time.h>    // clock_gettime
+#include <sys/stat.h> // stat
+
+#include "eval.h"         // eval
+#include "parse_number.h" // parse_number
+
+#define GENERATED_LINES 200000
+
+typedef struct {
+    size_t begin;
+    size_t len;
+} span_type;
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return 1e9 * (double)ts.tv_sec + (double)ts.tv_nsec;
+}
+
+static uint64_t rng_state = 0x9E3779B97F4A7C15u;
+
+static uint64_t rng_next(void) {
+    // xorshift64
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+static size_t generate_literal(char* buf, size_t capacity) {
+    switch (rng_next() % 4) {
+    case 0: // integer
+        return (size_t)snprintf(buf, capacity, "%llu", (unsigned long long)(rng_next() % 1000000000u));
+    case 1: // short decimal
+        return (size_t)snprintf(buf, capacity, "%u.%02u", (unsigned)(rng_next() % 1000u), (unsigned)(rng_next() % 100u));
+    case 2: // long decimal
+        return (size_t)snprintf(buf, capacity, "%.17g", (double)(rng_next() >> 11) / (double)(1 + rng_next() % 1000000u));
+    default: // exponent
+        return (size_t)snprintf(buf, capacity, "%u.%ue%d", (unsigned)(rng_next() % 10u), (unsigned)(rng_next() % 100000u),
+                                (int)(rng_next() % 41) - 20);
+    }
+}
+
+static char* generate_corpus(size_t* size_p) {
+    static const char ops[] = "+-*/";
+    size_t capacity = (size_t)GENERATED_LINES * 160;
+    char* corpus_p = malloc(capacity);
+    if (corpus_p == NULL) {
+        return NULL;
+    }
+    size_t n = 0;
+    for (size_t line = 0; line < GENERATED_LINES; line++) {
+        size_t literal_count = 2 + rng_next() % 4;
+        for (size_t i = 0; i < literal_count; i++) {
+            if (i != 0) {
+                corpus_p[n++] = ' ';
+                corpus_p[n++] = ops[rng_next() % 4];
+                corpus_p[n++] = ' ';
+            }
+            n += generate_literal(&corpus_p[n], capacity - n);
+        }
+        corpus_p[n++] = '\n';
+    }
+    corpus_p[n] = '\0';
+    *size_p = n;
+    return corpus_p;
+}
+
+static char* read_corpus(const char* path, size_t* size_p) {
+    struct stat st;
+    FILE* fp = fopen(path, "r");
+    if (fp == NULL || stat(path, &st) != 0) {
+        return NULL;
+    }
+    char* corpus_p = malloc((size_t)st.st_size + 1);
+    if (corpus_p != NULL) {
+        *size_p = fread(corpus_p, 1, (size_t)st.st_size, fp);
+        corpus_p[*size_p] = '\0';
+    }
+    fclose(fp);
+    return corpus_p;
+}
+
+// the number lexer `eval` used before `parse_number`.
+static size_t legacy_parse_number(const char* str, size_t len, double* value_p) {
+    size_t i = 0;
+    double value = 0.;
+    while (i < len && isdigit((unsigned char)str[i])) {
+        value = 10. * value + (str[i] - '0');
+        i++;
+    }
+    if (i < len && str[i] == '.') {
+        i++;
+        double c = 10.;
+        while (i < len && isdigit((unsigned char)str[i])) {
+            value = value + (str[i] - '0') / c;
+            c *= 10.;
+            i++;
+        }
+    }
+    *value_p = value;
+    return i;
+}
+
+int main(int argc, char** argv) {
+    size_t size = 0;
+    char* corpus_p = argc > 1 ? read_corpus(argv[1], &size) : generate_corpus(&size);
+    if (corpus_p == NULL) {
+        fprintf(stderr, "Could not load corpus.\n");
+        return 1;
+    }
+
+    // find every literal
+    size_t span_count = 0;
+    span_type* spans_p = malloc(sizeof(span_type) * (size / 2 + 1));
+    double* values_p = malloc(sizeof(double) * (size / 2 + 1));
+    double* expected_p = malloc(sizeof(double) * (size / 2 + 1));
+    if (spans_p == NULL || values_p == NULL || expected_p == NULL) {
+        fprintf(stderr, "Out of memory.\n");
+        return 1;
+    }
+    size_t literal_bytes = 0;
+    for (size_t i = 0; i < size;) {
+        if (!isdigit((unsigned char)corpus_p[i]) && corpus_p[i] != '.') {
+            i++;
+            continue;
+        }
+        double value;
+        const char* error_msg;
+        size_t n = parse_number(&corpus_p[i], size - i, &value, &error_msg);
+        if (error_msg != NULL || n == 0) {
+            i++;
+            continue;
+        }
+        spans_p[span_count++] = (span_type){.begin = i, .len = n};
+        literal_bytes += n;
+        i += n;
+    }
+    printf("corpus: %zu bytes, %zu literals (%zu bytes)\n\n", size, span_count, literal_bytes);
+
+    for (size_t i = 0; i < span_count; i++) {
+        expected_p[i] = strtod(&corpus_p[spans_p[i].begin], NULL);
+    }
+
+    printf("%-14s %10s %10s %12s\n", "parser", "ns/number", "MB/s", "mismatches");
+
+    for (int parser = 0; parser < 3; parser++) {
+        const char* name = parser == 0 ? "legacy loop" : parser == 1 ? "parse_number" : "strtod";
+        double best = 1e300;
+        for (int rep = 0; rep < 5; rep++) {
+            double t0 = now_ns();
+            for (size_t i = 0; i < span_count; i++) {
+                const char* str = &corpus_p[spans_p[i].begin];
+                const char* error_msg;
+                switch (parser) {
+                case 0:
+                    legacy_parse_number(str, spans_p[i].len, &values_p[i]);
+                    break;
+                case 1:
+                    parse_number(str, spans_p[i].len, &values_p[i], &error_msg);
+                    break;
+                default:
+                    values_p[i] = strtod(str, NULL);
+                    break;
+                }
+            }
+            double t = now_ns() - t0;
+            best = t < best ? t : best;
+        }
+        size_t mismatches = 0;
+        for (size_t i = 0; i < span_count; i++) {
+            mismatches += memcmp(&values_p[i], &expected_p[i], sizeof(double)) != 0;
+        }
+        printf("%-14s %10.2f %10.1f %12zu\n", name, best / (double)span_count, 1e3 * (double)literal_bytes / best, mismatches);
+    }
+
+    // whole expressions, for scale
+    {
+        eval_state_type state;
+        eval_state_init(&state, false);
+        size_t line_count = 0;
+        double t0 = now_ns();
+        for (size_t begin = 0, end = 0; begin < size; begin = end + 1) {
+            for (end = begin; end < size && corpus_p[end] != '\n'; end++) {
+            }
+            eval(&state, &corpus_p[begin], (ssize_t)(end - begin));
+            line_count++;
+        }
+        double t = now_ns() - t0;
+        printf("\neval: %.1f ns/expression over %zu expressions\n", t / (double)line_count, line_count);
+    }
+
+    free(spans_p);
+    free(values_p);
+    free(expected_p);
+    free(corpus_p);
+    return 0;
+}
@@ -0,0 +1,94 @@
+/*
+    check that `eval_cached` gives the same results and errors as `eval`.
+
+    usage: ./check_cache [RANDOM_COUNT]
+
+    inputs whose cache keys are easy to get wrong are evaluated after an input they must not share an entry with, then
+    RANDOM_COUNT short random inputs (default 2000000) are drawn from a small alphabet so that many of them collide in
+    the cache. every input is evaluated by both, each with its own state, and the results are compared.
+*/
+
+#include <math.h>    // isnan
+#include <stdbool.h> // bool, true, false
+#include <stdio.h>   // printf, fprintf
+#include <stdlib.h>  // rand, srand, strtoul
+#include <string.h>  // strlen
+
+#include "eval.h"       // eval, eval_state_*
+#include "eval_cache.h" // eval_cache_*, eval_cached
+
+#define MISMATCHES_SHOWN 10
+
+static const char* const tricky_inputs[] = {
+    "1e+5\n", "1e--5\n", "1e +5\n", "1e - 5\n", "1e-5\n", "1e+-5\n", "1e 5\n",  "1e\n5\n", "1E+5\n",
+    "2.5e+3\n", "2.5e++3\n", ".5e-1\n", ".5e - 1\n", "1+--2\n", "1 + --2\n", "1 2\n", "12\n",   "3e\n",
+};
+
+static bool same_result(const eval_state_type* a_p, double a, const eval_state_type* b_p, double b) {
+    if ((a_p->error_msg == NULL) != (b_p->error_msg == NULL)) {
+        return false;
+    }
+    if (a_p->error_msg != NULL) {
+        return true;
+    }
+    return a_p->last_value_is_int == b_p->last_value_is_int && (a == b || (isnan(a) && isnan(b)));
+}
+
+// evaluate `str` both ways. returns false and reports the input on a mismatch.
+static bool check(eval_state_type* plain_p, eval_state_type* cached_p, eval_cache_type* cache_p, const char* str,
+                  ssize_t len, size_t* mismatches_p) {
+    double plain = eval(plain_p, str, len);
+    double cached = eval_cached(cached_p, cache_p, str, len);
+    if (same_result(plain_p, plain, cached_p, cached)) {
+        return true;
+    }
+    if ((*mismatches_p)++ < MISMATCHES_SHOWN) {
+        printf("mismatch on '%.*s': eval %s %.17g, eval_cached %s %.17g\n", (int)len, str,
+               plain_p->error_msg != NULL ? plain_p->error_msg : "", plain,
+               cached_p->error_msg != NULL ? cached_p->error_msg : "", cached);
+    }
+    // keep `_` the same for the inputs that follow
+    *cached_p = *plain_p;
+    return false;
+}
+
+int main(int argc, char** argv) {
+    size_t random_count = argc > 1 ? strtoul(argv[1], NULL, 10) : 2000000;
+
+    eval_state_type plain;
+    eval_state_type cached;
+    eval_state_init(&plain, true);
+    eval_state_init(&cached, true);
+    eval_cache_type* cache_p = eval_cache_create(64);
+    if (cache_p == NULL) {
+        fprintf(stderr, "Out of memory.\n");
+        return 1;
+    }
+    size_t mismatches = 0;
+
+    // every tricky input right after every other, so a wrongly shared key is found in the cache
+    size_t tricky_count = sizeof(tricky_inputs) / sizeof(tricky_inputs[0]);
+    for (size_t i = 0; i < tricky_count; i++) {
+        for (size_t j = 0; j < tricky_count; j++) {
+            check(&plain, &cached, cache_p, tricky_inputs[i], (ssize_t)strlen(tricky_inputs[i]), &mismatches);
+            check(&plain, &cached, cache_p, tricky_inputs[j], (ssize_t)strlen(tricky_inputs[j]), &mismatches);
+        }
+    }
+
+    const char alphabet[] = "12 -+-*/^()_.\n eE";
+    srand(1);
+    for (size_t i = 0; i < random_count; i++) {
+        char str[8];
+        size_t len = 1 + (size_t)rand() % sizeof(str);
+        for (size_t j = 0; j < len; j++) {
+            str[j] = alphabet[(size_t)rand() % (sizeof(alphabet) - 1)];
+        }
+        check(&plain, &cached, cache_p, str, (ssize_t)len, &mismatches);
+    }
+
+    eval_cache_stats_type stats = eval_cache_stats(cache_p);
+    printf("%zu mismatches (cache: %zu hits, %zu misses, %zu evictions)\n", mismatches, stats.hits, stats.misses,
+           stats.evictions);
+    eval_cache_destroy(cache_p);
+    return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,291 @@
+#!/usr/bin/env python3
+
+# Writes a reproducible random expression corpus for bench_eval, one expression per line, and the expected result of
+# every line as computed by an independent reference evaluator.
+#
+# Expressions are generated as syntax trees, rendered to text, and evaluated from the tree, so the reference never
+# parses the text. The rendering relies only on the documented behaviour of `eval`:
+# - all binary operators are left-associative, `^` included.
+# - a sign directly before a literal or `_` binds tighter than `^`, so `-2^2` is 4.
+# - a sign before `(` multiplies by -1, so a negated group is rendered as `(-(e))`.
+# - a sign after `+` or `-` folds into it, so such right operands are parenthesized.
+# - integer-only expressions run in int64 and fall back to double on overflow, a negative exponent, division by zero or
+#   inexact division. `_` is the previous line's result.
+#
+# usage: ./gen_corpus.py [--count N] [--depth D] [--nest N] [--ops SPEC] [--implicit P] [--unary P] [--last-value P]
+#                        [--float P] [--space P] [--seed S] [--out FILE] [--expected FILE]
+
+import argparse
+import math
+import random
+import sys
+import threading
+
+INT64_MIN = -(2**63)
+INT64_MAX = 2**63 - 1
+
+PRECEDENCE = {"+": 1, "-": 1, "*": 2, "/": 2, "^": 3}
+ATOM_PRECEDENCE = 5
+
+
+class Fallback(Exception):
+    pass
+
+
+# syntax tree nodes:
+# ("lit", text, value, is_int)  literal. `value` is an int if `is_int`, otherwise a float
+# ("last",)                     `_`
+# ("signed", negative, atom)    a sign run before a literal or `_`
+# ("neg", e)                    a negated group
+# ("bin", op, a, b, implicit)   a binary operation, `implicit` for multiplication by juxtaposition
+
+
+def gen_literal(rng, float_prob):
+    if rng.random() >= float_prob:
+        if rng.random() < 0.1:
+            value = rng.randrange(0, 256)
+            return ("lit", "0x%x" % value, value, True)
+        value = rng.choice([rng.randrange(0, 10), rng.randrange(0, 1000), rng.randrange(0, 10**12)])
+        return ("lit", str(value), value, True)
+    kind = rng.randrange(3)
+    if kind == 0:
+        text = "%d.%d" % (rng.randrange(0, 1000), rng.randrange(0, 1000))
+    elif kind == 1:
+        text = ".%d" % rng.randrange(0, 100000)
+    else:
+        text = "%d.%de%d" % (rng.randrange(1, 10), rng.randrange(0, 100), rng.randrange(-20, 21))
+    return ("lit", text, float(text), False)
+
+
+def gen_atom(rng, args, allow_last):
+    if allow_last and rng.random() < args.last_value:
+        return ("last",)
+    return gen_literal(rng, args.float)
+
+
+def gen_expr(rng, args, ops, weights, depth, allow_last):
+    if depth <= 0 or rng.random() < 0.3:
+        atom = gen_atom(rng, args, allow_last)
+        if rng.random() < args.unary:
+            return ("signed", rng.random() < 0.5, atom)
+        return atom
+    if rng.random() < args.unary:
+        return ("neg", gen_expr(rng, args, ops, weights, depth - 1, allow_last))
+    op = rng.choices(ops, weights)[0]
+    a = gen_expr(rng, args, ops, weights, depth - 1, allow_last)
+    b = gen_expr(rng, args, ops, weights, depth - 1, allow_last)
+    return ("bin", op, a, b, op == "*" and rng.random() < args.implicit)
+
+
+def gen_nest(rng, args, ops, weights, expr, nest, allow_last):
+    # right-nested chain `a op (b op (... (expr)))`, deepening both the operator and the operand stack
+    for _ in range(nest):
+        op = rng.choices(ops, weights)[0]
+        expr = ("bin", op, gen_atom(rng, args, allow_last), expr, False)
+    return expr
+
+
+def sign_run(rng, negative):
+    # a random run of signs with the given parity
+    n = rng.randrange(1, 4)
+    signs = [rng.choice("+-") for _ in range(n)]
+    if (signs.count("-") % 2 == 1) != negative:
+        signs[0] = "-" if signs[0] == "+" else "+"
+    return "".join(signs)
+
+
+def render(rng, args, node):
+    # returns (text, precedence)
+    kind = node[0]
+    if kind == "lit":
+        return node[1], ATOM_PRECEDENCE
+    if kind == "last":
+        return "_", ATOM_PRECEDENCE
+    if kind == "signed":
+        return sign_run(rng, node[1]) + space(rng, args) + render(rng, args, node[2])[0], ATOM_PRECEDENCE
+    if kind == "neg":
+        return "(-(" + render(rng, args, node[1])[0] + "))", ATOM_PRECEDENCE
+
+    op, a, b, implicit = node[1], node[2], node[3], node[4]
+    p = PRECEDENCE[op]
+    a_text, a_prec = render(rng, args, a)
+    b_text, b_prec = render(rng, args, b)
+    if a_prec < p:
+        a_text = "(" + a_text + ")"
+    if b_prec <= p or (op in "+-" and b_text[0] in "+-"):
+        b_text = "(" + b_text + ")"
+    if implicit and b_text[0] != "+" and b_text[0] != "-" and (b_text[0] == "(" or a_text[-1] == ")"):
+        return a_text + space(rng, args) + b_text, p
+    return a_text + space(rng, args) + op + space(rng, args) + b_text, p
+
+
+def space(rng, args):
+    return " " if rng.random() < args.space else ""
+
+
+# reference evaluation. `last` is (value, is_int) of the previous line.
+
+
+def check_int(value):
+    if value < INT64_MIN or value > INT64_MAX:
+        raise Fallback()
+    return value
+
+
+def eval_int(node, last):
+    kind = node[0]
+    if kind == "lit":
+        if not node[3] or node[2] > INT64_MAX:
+            raise Fallback()
+        return node[2]
+    if kind == "last":
+        if not last[1]:
+            raise Fallback()
+        return last[0]
+    if kind == "signed":
+        value = eval_int(node[2], last)
+        return check_int(-value) if node[1] else value
+    if kind == "neg":
+        return check_int(-1 * eval_int(node[1], last))
+
+    op = node[1]
+    x = eval_int(node[2], last)
+    y = eval_int(node[3], last)
+    if op == "+":
+        return check_int(x + y)
+    if op == "-":
+        return check_int(x - y)
+    if op == "*":
+        return check_int(x * y)
+    if op == "/":
+        if y == 0 or x % y != 0:
+            raise Fallback()
+        return check_int(x // y)
+    if y < 0 or (abs(x) >= 2 and y >= 64):
+        raise Fallback()
+    return check_int(x**y)
+
+
+def is_odd_integer(y):
+    return math.isfinite(y) and y == math.floor(y) and math.fmod(y, 2) != 0
+
+
+def ieee_div(x, y):
+    if y != 0:
+        return x / y
+    if x == 0 or math.isnan(x):
+        return math.nan
+    return math.copysign(math.inf, x) * math.copysign(1.0, y)
+
+
+def c_pow(x, y):
+    # math.pow raises where C's pow returns inf or nan
+    try:
+        return math.pow(x, y)
+    except OverflowError:
+        return -math.inf if x < 0 and is_odd_integer(y) else math.inf
+    except ValueError:
+        if x == 0:
+            return math.copysign(math.inf, x) if is_odd_integer(y) else math.inf
+        return math.nan
+
+
+def eval_double(node, last):
+    kind = node[0]
+    if kind == "lit":
+        return float(node[2])
+    if kind == "last":
+        return float(last[0])
+    if kind == "signed":
+        if node[2][0] == "lit" and not has_float_literal(node[2]):
+            # integer literals are negated before conversion, so `-0` is +0
+            return float(-node[2][2] if node[1] else node[2][2])
+        value = eval_double(node[2], last)
+        return -value if node[1] else value
+    if kind == "neg":
+        return -1.0 * eval_double(node[1], last)
+
+    op = node[1]
+    x = eval_double(node[2], last)
+    y = eval_double(node[3], last)
+    if op == "+":
+        return x + y
+    if op == "-":
+        return x - y
+    if op == "*":
+        return x * y
+    if op == "/":
+        return ieee_div(x, y)
+    return c_pow(x, y)
+
+
+def has_float_literal(node):
+    kind = node[0]
+    if kind == "lit":
+        return not node[3] or node[2] > INT64_MAX
+    if kind == "signed" or kind == "neg":
+        return has_float_literal(node[-1])
+    if kind == "bin":
+        return has_float_literal(node[2]) or has_float_literal(node[3])
+    return False
+
+
+def eval_line(node, last):
+    if not has_float_literal(node):
+        try:
+            return eval_int(node, last), True
+        except Fallback:
+            pass
+    return eval_double(node, last), False
+
+
+def parse_ops(spec):
+    ops = []
+    weights = []
+    for item in spec.split(","):
+        op, _, weight = item.partition(":")
+        if op not in PRECEDENCE:
+            sys.exit("Unknown operator '%s'." % op)
+        ops.append(op)
+        weights.append(float(weight) if weight else 1.0)
+    return ops, weights
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Generate an expression corpus and its expected results.")
+    parser.add_argument("--count", type=int, default=100000, help="number of expressions")
+    parser.add_argument("--depth", type=int, default=6, help="maximum depth of the random expression tree")
+    parser.add_argument("--nest", type=int, default=0, help="extra right-nested levels around every expression")
+    parser.add_argument("--ops", default="+:4,-:4,*:3,/:2,^:1", help="operators with weights, e.g. '+:4,*:1'")
+    parser.add_argument("--implicit", type=float, default=0.2, help="probability of implicit multiplication")
+    parser.add_argument("--unary", type=float, default=0.15, help="probability of a unary sign")
+    parser.add_argument("--last-value", type=float, default=0.05, help="probability of `_` as an operand")
+    parser.add_argument("--float", type=float, default=0.5, help="probability of a non-integer literal")
+    parser.add_argument("--space", type=float, default=0.5, help="probability of a space between tokens")
+    parser.add_argument("--seed", type=int, default=1)
+    parser.add_argument("--out", default="corpus.txt")
+    parser.add_argument("--expected", default="corpus.expected")
+    args = parser.parse_args()
+
+    ops, weights = parse_ops(args.ops)
+    rng = random.Random(args.seed)
+    last = (0.0, False)
+
+    with open(args.out, "w") as out, open(args.expected, "w") as expected:
+        for i in range(args.count):
+            node = gen_expr(rng, args, ops, weights, args.depth, i > 0)
+            node = gen_nest(rng, args, ops, weights, node, args.nest, i > 0)
+            out.write(render(rng, args, node)[0] + "\n")
+            last = eval_line(node, last)
+            expected.write((str(last[0]) if last[1] else repr(last[0])) + "\n")
+
+    print("Writing %d expressions to %s and %s" % (args.count, args.out, args.expected))
+
+
+if __name__ == "__main__":
+    # deeply nested expressions need deep recursion
+    sys.setrecursionlimit(1000000)
+    threading.stack_size(512 * 1024 * 1024)
+    thread = threading.Thread(target=main)
+    thread.start()
+    thread.join()
@@ -0,0 +1,148 @@
+#include <stdbool.h> // bool, true, false
+#include <stdio.h>   // FILE, getline, fprintf, stderr, stdout
+#include <stdlib.h>  // malloc, realloc, free, strtod
+#include <string.h>  // strcmp, strlen, strspn, strcspn
+
+#include "columns.h"
+#include "eval.h"         // eval_*
+#include "write_buffer.h" // write_buffer_*
+
+#define COLUMNS_SEPARATORS " \t\r\n,"
+
+typedef struct {
+    char* name_p;
+    double* values_p;
+} column_type;
+
+static void columns_destroy(column_type* columns_p, size_t column_count) {
+    for (size_t i = 0; i < column_count; i++) {
+        free(columns_p[i].name_p);
+        free(columns_p[i].values_p);
+    }
+    free(columns_p);
+}
+
+bool columns_eval_stream(const char* expr, FILE* fp, int precision) {
+    bool success = false;
+    eval_program_type* program_p = NULL;
+    column_type* columns_p = NULL;
+    size_t column_count = 0;
+    const double** bound_pp = NULL;
+    double* out_p = NULL;
+    char* line_p = NULL;
+    size_t n = 0;
+
+    eval_state_type state;
+    eval_state_init(&state, false);
+    state.variables_enabled = true;
+
+    program_p = eval_compile(&state, expr, (ssize_t)strlen(expr));
+    if (program_p == NULL) {
+        fprintf(stderr, "%s\n", state.error_msg);
+        goto cleanup;
+    }
+
+    // header:
+    if (getline(&line_p, &n, fp) <= 0) {
+        fprintf(stderr, "Missing header line.\n");
+        goto cleanup;
+    }
+    for (char* p = line_p + strspn(line_p, COLUMNS_SEPARATORS); *p != '\0'; p += strspn(p, COLUMNS_SEPARATORS)) {
+        size_t m = strcspn(p, COLUMNS_SEPARATORS);
+        column_type* new_columns_p = realloc(columns_p, (column_count + 1) * sizeof(column_type));
+        if (new_columns_p == NULL) {
+            goto on_oom_error;
+        }
+        columns_p = new_columns_p;
+        columns_p[column_count] = (column_type){.name_p = malloc(m + 1), .values_p = NULL};
+        column_count++;
+        if (columns_p[column_count - 1].name_p == NULL) {
+            goto on_oom_error;
+        }
+        memcpy(columns_p[column_count - 1].name_p, p, m);
+        columns_p[column_count - 1].name_p[m] = '\0';
+        p += m;
+    }
+
+    // rows:
+    size_t row_count = 0;
+    size_t row_capacity = 0;
+    size_t line_number = 1;
+    while (getline(&line_p, &n, fp) > 0) {
+        line_number++;
+        if (line_p[strspn(line_p, COLUMNS_SEPARATORS)] == '\0') {
+            continue;
+        }
+        if (row_count == row_capacity) {
+            row_capacity = row_capacity == 0 ? 1024 : 2 * row_capacity;
+            for (size_t i = 0; i < column_count; i++) {
+                double* values_p = realloc(columns_p[i].values_p, row_capacity * sizeof(double));
+                if (values_p == NULL) {
+                    goto on_oom_error;
+                }
+                columns_p[i].values_p = values_p;
+            }
+        }
+        char* p = line_p;
+        for (size_t i = 0; i < column_count; i++) {
+            p += strspn(p, COLUMNS_SEPARATORS);
+            char* end_p;
+            columns_p[i].values_p[row_count] = strtod(p, &end_p);
+            if (end_p == p) {
+                fprintf(stderr, "line %zu: expected %zu numbers.\n", line_number, column_count);
+                goto cleanup;
+            }
+            p = end_p;
+        }
+        row_count++;
+    }
+
+    // bind variables to columns:
+    size_t variable_count = eval_program_variable_count(program_p);
+    bound_pp = malloc((variable_count + 1) * sizeof(double*));
+    out_p = malloc((row_count + 1) * sizeof(double));
+    if (bound_pp == NULL || out_p == NULL) {
+        goto on_oom_error;
+    }
+    for (size_t v = 0; v < variable_count; v++) {
+        const char* name_p = eval_program_variable_name(program_p, v);
+        bound_pp[v] = NULL;
+        for (size_t i = 0; i < column_count; i++) {
+            if (strcmp(columns_p[i].name_p, name_p) == 0) {
+                bound_pp[v] = columns_p[i].values_p;
+                break;
+            }
+        }
+        if (bound_pp[v] == NULL) {
+            fprintf(stderr, "No column named '%s'.\n", name_p);
+            goto cleanup;
+        }
+    }
+
+    if (!eval_program_run_columns(&state, program_p, bound_pp, row_count, out_p)) {
+        fprintf(stderr, "%s\n", state.error_msg);
+        goto cleanup;
+    }
+    write_buffer_type wb;
+    if (!write_buffer_init(&wb, stdout, WRITE_BUFFER_DEFAULT_CAPACITY)) {
+        goto on_oom_error;
+    }
+    for (size_t r = 0; r < row_count; r++) {
+        write_buffer_write_number(&wb, out_p[r], precision);
+    }
+    write_buffer_destroy(&wb);
+    success = true;
+    goto cleanup;
+
+on_oom_error:
+    fprintf(stderr, "%s\n", EVAL_OOM_ERROR_MSG);
+
+cleanup:
+    free(line_p);
+    free(out_p);
+    free(bound_pp);
+    columns_destroy(columns_p, column_count);
+    eval_program_destroy(program_p);
+
+    return success;
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+#include <stdbool.h> // bool
+#include <stdio.h>   // FILE
+
+// evaluate `expr` once per row of the whitespace-separated table read from `fp`, and write one result per row to
+// stdout, formatted as by `format_number` with `precision`. the first line of the table names the columns, which are
+// bound to the variables of `expr`.
+bool columns_eval_stream(const char* expr, FILE* fp, int precision);
@@ -0,0 +1,931 @@
+#include <ctype.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <math.h>
+
+#include "eval.h"
+#include "parse_number.h" // parse_number, parse_integer
+
+typedef enum { DEFAULTOKEN, NUMBER_TOKEN, INTEGER_TOKEN, OP_TOKEN, VARIABLE_TOKEN, LAST_VALUE_TOKEN } token_type;
+
+typedef enum {
+    DEFAULOP,
+    ADD_OP,
+    SUB_OP,
+    MUL_OP,
+    DIV_OP,
+    POW_OP,
+    NEG_OP,
+    OPENING_PAREN_OP,
+    CLOSING_PAREN_OP
+} operation_type;
+
+typedef struct {
+    token_type token;
+    union {
+        double num;
+        int64_t inum;
+        operation_type op;
+        size_t var_index;
+    } metadata;
+} lexeme_type;
+
+#define NAME lex_queue
+#define VALUE_TYPE lexeme_type
+#include "fqueue.h"
+
+#define NAME lex_stack
+#define VALUE_TYPE lexeme_type
+#include "fstack.h"
+
+struct eval_program_type {
+    size_t variable_count;
+    char** variable_names_pp;
+
+    size_t stack_depth; // max number of operands on the stack while running
+    bool is_integral;   // no variables and only integer literals, so it can run in int64_t
+    bool uses_last_value;
+    size_t count;
+    lexeme_type* code_p; // postfix
+};
+
+char decode_op(operation_type op) {
+    switch (op) {
+    case ADD_OP:
+        return '+';
+    case SUB_OP:
+    case NEG_OP:
+        return '-';
+    case MUL_OP:
+        return '*';
+    case DIV_OP:
+        return '/';
+    case POW_OP:
+        return '^';
+    case OPENING_PAREN_OP:
+        return '(';
+    case CLOSING_PAREN_OP:
+        return ')';
+    default:
+        break;
+    }
+    return 'D';
+}
+
+int op_precedence(operation_type op) {
+    switch (op) {
+    case NEG_OP:
+        return 4;
+    case POW_OP:
+        return 3;
+    case DIV_OP:
+    case MUL_OP:
+        return 2;
+    case SUB_OP:
+    case ADD_OP:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+int op_precedence_cmp(operation_type o1, operation_type o2) {
+    int o1_prec = op_precedence(o1);
+    int o2_prec = op_precedence(o2);
+    return -(o1_prec < o2_prec) + (o1_prec > o2_prec);
+}
+
+static const double RTR_VALUE_DEFAULT = 0.;
+
+void eval_state_init(eval_state_type* state_p, bool last_value_enabled) {
+    *state_p = (eval_state_type){.last_value = RTR_VALUE_DEFAULT,
+                                 .last_value_enabled = last_value_enabled,
+                                 .variables_enabled = false,
+                                 .int_mode = EVAL_INT_MODE_AUTO,
+                                 .last_value_is_int = false,
+                                 .last_int_value = 0,
+                                 .error_msg = NULL,
+                                 .error_index = 0};
+}
+
+static size_t eval_program_add_variable(eval_program_type* program_p, const char* name_p, size_t n) {
+    for (size_t i = 0; i < program_p->variable_count; i++) {
+        if (strncmp(program_p->variable_names_pp[i], name_p, n) == 0 && program_p->variable_names_pp[i][n] == '\0') {
+            return i;
+        }
+    }
+    char** names_pp = realloc(program_p->variable_names_pp, (program_p->variable_count + 1) * sizeof(char*));
+    if (names_pp == NULL) {
+        return SIZE_MAX;
+    }
+    program_p->variable_names_pp = names_pp;
+
+    char* str = malloc(n + 1);
+    if (str == NULL) {
+        return SIZE_MAX;
+    }
+    memcpy(str, name_p, n);
+    str[n] = '\0';
+    names_pp[program_p->variable_count] = str;
+
+    return program_p->variable_count++;
+}
+
+void eval_program_destroy(eval_program_type* program_p) {
+    if (program_p == NULL) {
+        return;
+    }
+    for (size_t i = 0; i < program_p->variable_count; i++) {
+        free(program_p->variable_names_pp[i]);
+    }
+    free(program_p->variable_names_pp);
+    free(program_p->code_p);
+    free(program_p);
+}
+
+size_t eval_program_variable_count(const eval_program_type* program_p) {
+    return program_p->variable_count;
+}
+
+const char* eval_program_variable_name(const eval_program_type* program_p, size_t index) {
+    return program_p->variable_names_pp[index];
+}
+
+bool eval_program_uses_last_value(const eval_program_type* program_p) {
+    return program_p->uses_last_value;
+}
+
+#define last_token(inp_queue) (lex_queue_is_empty(inp_queue) ? DEFAULTOKEN : lex_queue_get_back(inp_queue).token)
+#define last_op(inp_queue) (lex_queue_is_empty(inp_queue) ? DEFAULOP : lex_queue_get_back(inp_queue).metadata.op)
+#define last_is_operand(inp_queue)                                                       \
+    (last_token(inp_queue) == NUMBER_TOKEN || last_token(inp_queue) == INTEGER_TOKEN || \
+     last_token(inp_queue) == VARIABLE_TOKEN || last_token(inp_queue) == LAST_VALUE_TOKEN)
+
+#define is_ident_start(c) (isalpha((unsigned char)(c)))
+#define is_ident_char(c) (isalnum((unsigned char)(c)) || (c) == '_')
+
+// index of the last character of `str` that is not whitespace, or 0.
+static ssize_t last_char_index(const char* str, ssize_t len) {
+    ssize_t i = len - 1;
+    while (i > 0 && (str[i] == ' ' || str[i] == '\n' || str[i] == '\0')) {
+        i--;
+    }
+    return i > 0 ? i : 0;
+}
+
+// lexer: convert `str` to infix lexemes, resolving signs and implicit multiplication. variables are added to
+// `program_p`. on error `state_p` is set and NULL is returned.
+static lex_queue_type* eval_lex_to_queue(eval_state_type* state_p, eval_program_type* program_p, const char* str, ssize_t len) {
+    // an operand may expand to up to two lexemes (implicit multiplication)
+    lex_queue_type* inp_queue = lex_queue_create(2 * (size_t)len + 1);
+    if (!inp_queue) {
+        goto on_oom_error;
+    }
+
+    // error handling:
+    const char* error_msg = NULL;
+    ssize_t error_index = 0;
+    size_t opening_paren_count = 0;
+    size_t closing_paren_count = 0;
+    bool incomplete_input = true;
+
+    operation_type sign = DEFAULOP;
+
+    for (ssize_t i = 0; i < len; i++) {
+        switch (str[i]) {
+        case '+':
+        case '-':
+            incomplete_input = true;
+            error_index = i;
+
+            sign = str[i] == '+' ? ADD_OP : SUB_OP;
+            while (i + 1 < len && (str[i + 1] == '-' || str[i + 1] == '+' || str[i + 1] == ' ')) {
+                if (str[i + 1] == '-') {
+                    sign = sign == SUB_OP ? ADD_OP : SUB_OP;
+                }
+                if (str[i + 1] == '+' || str[i + 1] == '-') {
+                    error_index = i + 1;
+                }
+                i++;
+            }
+            break;
+        case '*':
+        case '/':
+            incomplete_input = true;
+            error_index = i;
+            if (!last_is_operand(inp_queue) && !(last_token(inp_queue) == OP_TOKEN && last_op(inp_queue) == CLOSING_PAREN_OP)) {
+                error_msg = "Incorrect use of '*' or '/'.";
+                error_index = i;
+                goto on_inp_error;
+            }
+            lex_queue_enqueue(inp_queue, (lexeme_type){.token = OP_TOKEN, .metadata = {.op = str[i] == '*' ? MUL_OP : DIV_OP}});
+            break;
+        case '^':
+            incomplete_input = true;
+            error_index = i;
+            if (!last_is_operand(inp_queue) && !(last_token(inp_queue) == OP_TOKEN && last_op(inp_queue) == CLOSING_PAREN_OP)) {
+                error_msg = "Incorrect use of '^'.";
+                error_index = i;
+                goto on_inp_error;
+            }
+            lex_queue_enqueue(inp_queue, (lexeme_type){.token = OP_TOKEN, .metadata = {.op = POW_OP}});
+            break;
+        case '0':
+        case '1':
+        case '2':
+        case '3':
+        case '4':
+        case '5':
+        case '6':
+        case '7':
+        case '8':
+        case '9':
+        case '.':
+        case '_':
+            incomplete_input = false;
+            if ((last_is_operand(inp_queue) || (last_token(inp_queue) == OP_TOKEN && last_op(inp_queue) == CLOSING_PAREN_OP)) &&
+                sign != DEFAULOP) {
+                lex_queue_enqueue(inp_queue, (lexeme_type){.token = OP_TOKEN, .metadata = {.op = sign}});
+                sign = DEFAULOP;
+            } else if (last_is_operand(inp_queue)) {
+                error_msg = "Two numbers in a row.";
+                error_index = i;
+                goto on_inp_error;
+            }
+            if (last_token(inp_queue) == OP_TOKEN && last_op(inp_queue) == CLOSING_PAREN_OP) {
+                lex_queue_enqueue(inp_queue, (lexeme_type){.token = OP_TOKEN, .metadata = {.op = MUL_OP}});
+            }
+            if (str[i] == '_') {
+                if (!state_p->last_value_enabled) {
+                    error_msg = "'_' is not available here.";
+                    error_index = i;
+                    goto on_inp_error;
+                }
+                if (sign == SUB_OP) {
+                    lex_queue_enqueue(inp_queue, (lexeme_type){.token = OP_TOKEN, .metadata = {.op = NEG_OP}});
+                }
+                sign = DEFAULOP;
+                lex_queue_enqueue(inp_queue, (lexeme_type){.token = LAST_VALUE_TOKEN});
+                program_p->uses_last_value = true;
+                continue;
+            }
+            double value;
+            const char* number_error_msg;
+            size_t number_len = parse_number(&str[i], (size_t)(len - i), &value, &number_error_msg);
+            if (number_error_msg != NULL) {
+                error_msg = number_error_msg;
+                error_index = i + (ssize_t)number_len;
+                goto on_inp_error;
+            }
+            int64_t int_value;
+            bool is_integer = parse_integer(&str[i], number_len, &int_value);
+            i += (ssize_t)number_len - 1;
+            if (sign == SUB_OP) {
+                value = -value;
+                int_value = -int_value;
+            }
+            sign = DEFAULOP;
+            if (is_integer) {
+                lex_queue_enqueue(inp_queue, (lexeme_type){.token = INTEGER_TOKEN, .metadata = {.inum = int_value}});
+            } else {
+                lex_queue_enqueue(inp_queue, (lexeme_type){.token = NUMBER_TOKEN, .metadata = {.num = value}});
+                program_p->is_integral = false;
+            }
+            break;
+        case '(':
+        case ')':
+            opening_paren_count += (str[i] == '(');
+            closing_paren_count += (str[i] == ')');
+            if (opening_paren_count < closing_paren_count) {
+                error_msg = "Closed parenthesis before opening one.";
+                error_index = i;
+                goto on_inp_error;
+            }
+            if (str[i] == '(') {
+                incomplete_input = true;
+                error_index = i;
+                if (sign != DEFAULOP) {
+                    if (last_is_operand(inp_queue) ||
+                        (last_token(inp_queue) == OP_TOKEN && last_op(inp_queue) == CLOSING_PAREN_OP)) {
+                        lex_queue_enqueue(inp_queue, (lexeme_type){.token = OP_TOKEN, .metadata = {.op = sign}});
+                    } else {
+                        lex_queue_enqueue(inp_queue, (lexeme_type){.token = INTEGER_TOKEN,
+                                                                   .metadata = {.inum = -(sign == SUB_OP) + (sign == ADD_OP)}});
+                        lex_queue_enqueue(inp_queue, (lexeme_type){.token = OP_TOKEN, .metadata = {.op = MUL_OP}});
+                    }
+                    sign = DEFAULOP;
+                }
+                if (last_is_operand(inp_queue) ||
+                    (last_token(inp_queue) == OP_TOKEN && last_op(inp_queue) == CLOSING_PAREN_OP)) {
+                    lex_queue_enqueue(inp_queue, (lexeme_type){.token = OP_TOKEN, .metadata = {.op = MUL_OP}});
+                }
+            } else if (incomplete_input) {
+                error_msg = "Incomplete input.";
+                goto on_inp_error;
+            }
+            lex_queue_enqueue(
+                inp_queue, (lexeme_type){.token = OP_TOKEN, .metadata = {.op = str[i] == '(' ? OPENING_PAREN_OP : CLOSING_PAREN_OP}});
+            break;
+        case ' ':
+        case '\n':
+        case '\0':
+            continue;
+        default:
+            if (!is_ident_start(str[i])) {
+                error_msg = "Unknown character.";
+                error_index = i;
+                goto on_inp_error;
+            }
+            if (!state_p->variables_enabled) {
+                error_msg = "Variables are not available here.";
+                error_index = i;
+                goto on_inp_error;
+            }
+            incomplete_input = false;
+            if ((last_is_operand(inp_queue) || (last_token(inp_queue) == OP_TOKEN && last_op(inp_queue) == CLOSING_PAREN_OP)) &&
+                sign != DEFAULOP) {
+                lex_queue_enqueue(inp_queue, (lexeme_type){.token = OP_TOKEN, .metadata = {.op = sign}});
+                sign = DEFAULOP;
+            } else if (last_is_operand(inp_queue)) {
+                error_msg = "Two numbers in a row.";
+                error_index = i;
+                goto on_inp_error;
+            }
+            if (last_token(inp_queue) == OP_TOKEN && last_op(inp_queue) == CLOSING_PAREN_OP) {
+                lex_queue_enqueue(inp_queue, (lexeme_type){.token = OP_TOKEN, .metadata = {.op = MUL_OP}});
+            }
+            if (sign == SUB_OP) {
+                lex_queue_enqueue(inp_queue, (lexeme_type){.token = OP_TOKEN, .metadata = {.op = NEG_OP}});
+            }
+            sign = DEFAULOP;
+
+            ssize_t begin = i;
+            while (i + 1 < len && is_ident_char(str[i + 1])) {
+                i++;
+            }
+            size_t var_index = eval_program_add_variable(program_p, &str[begin], (size_t)(i + 1 - begin));
+            if (var_index == SIZE_MAX) {
+                goto on_oom_error;
+            }
+            lex_queue_enqueue(inp_queue, (lexeme_type){.token = VARIABLE_TOKEN, .metadata = {.var_index = var_index}});
+            program_p->is_integral = false;
+            break;
+        }
+    }
+
+    if (incomplete_input) {
+        error_msg = "Incomplete input.";
+        error_index = last_char_index(str, len);
+        goto on_inp_error;
+    }
+
+    if (opening_paren_count != closing_paren_count) {
+        error_msg = "Not all open parenthesis are closed.";
+        error_index = last_char_index(str, len);
+        goto on_inp_error;
+    }
+
+#ifdef DEBUG
+    {
+        size_t index;
+        lexeme_type lex;
+        printf("Input queue (prefix): ");
+        fqueue_for_each(inp_queue, index, lex) {
+            switch (lex.token) {
+            case NUMBER_TOKEN:
+                printf(" %g", lex.metadata.num);
+                break;
+            case INTEGER_TOKEN:
+                printf(" %" PRId64, lex.metadata.inum);
+                break;
+            case OP_TOKEN:
+                printf(" %c", decode_op(lex.metadata.op));
+                break;
+            case VARIABLE_TOKEN:
+                printf(" %s", program_p->variable_names_pp[lex.metadata.var_index]);
+                break;
+            case LAST_VALUE_TOKEN:
+                printf(" _");
+                break;
+            default:
+                break;
+            }
+        }
+        putchar('\n');
+    }
+#endif
+
+    return inp_queue;
+
+on_inp_error:
+    state_p->error_msg = error_msg;
+    state_p->error_index = error_index;
+
+    lex_queue_destroy(inp_queue);
+    return NULL;
+
+on_oom_error:
+    state_p->error_msg = EVAL_OOM_ERROR_MSG;
+    state_p->error_index = -1;
+
+    if (inp_queue != NULL) {
+        lex_queue_destroy(inp_queue);
+    }
+    return NULL;
+}
+
+size_t eval_lex(eval_state_type* state_p, const char* str, ssize_t len) {
+    state_p->error_msg = NULL;
+    state_p->error_index = 0;
+    if (len < 0) {
+        return 0;
+    }
+    eval_program_type* program_p = calloc(1, sizeof(eval_program_type));
+    if (!program_p) {
+        state_p->error_msg = EVAL_OOM_ERROR_MSG;
+        state_p->error_index = -1;
+        return 0;
+    }
+    lex_queue_type* inp_queue = eval_lex_to_queue(state_p, program_p, str, len);
+    size_t count = inp_queue != NULL ? inp_queue->count : 0;
+    if (inp_queue != NULL) {
+        lex_queue_destroy(inp_queue);
+    }
+    eval_program_destroy(program_p);
+    return count;
+}
+
+eval_program_type* eval_compile(eval_state_type* state_p, const char* str, ssize_t len) {
+    state_p->error_msg = NULL;
+    state_p->error_index = 0;
+    if (len < 0) {
+        return NULL;
+    }
+    eval_program_type* program_p = NULL;
+    lex_queue_type* inp_queue = NULL;
+    lex_stack_type* op_stack = NULL;
+
+    program_p = calloc(1, sizeof(eval_program_type));
+    if (!program_p) {
+        goto on_oom_error;
+    }
+    program_p->is_integral = true;
+    inp_queue = eval_lex_to_queue(state_p, program_p, str, len);
+    if (!inp_queue) {
+        eval_program_destroy(program_p);
+        return NULL;
+    }
+
+    program_p->code_p = malloc(inp_queue->count * sizeof(lexeme_type));
+    if (!program_p->code_p) {
+        goto on_oom_error;
+    }
+    op_stack = lex_stack_create(inp_queue->count);
+    if (!op_stack) {
+        goto on_oom_error;
+    }
+
+    // shunting yard algorithm (with simplified assumptions).
+    {
+        size_t index;
+        lexeme_type lex;
+        lexeme_type* code_p = program_p->code_p;
+        size_t count = 0;
+        size_t depth = 0;
+
+        // track the operand stack depth of the postfix program as it is emitted
+#define emit(lex)                                                                                     \
+    do {                                                                                              \
+        lexeme_type emit_lex = (lex);                                                                 \
+        code_p[count++] = emit_lex;                                                                   \
+        if (emit_lex.token != OP_TOKEN) {                                                             \
+            depth++;                                                                                  \
+            program_p->stack_depth = depth > program_p->stack_depth ? depth : program_p->stack_depth; \
+        } else if (emit_lex.metadata.op != NEG_OP) {                                                  \
+            depth--;                                                                                  \
+        }                                                                                             \
+    } while (0)
+
+        fqueue_for_each(inp_queue, index, lex) {
+            switch (lex.token) {
+            case NUMBER_TOKEN:
+            case INTEGER_TOKEN:
+            case VARIABLE_TOKEN:
+            case LAST_VALUE_TOKEN:
+                emit(lex);
+                break;
+            case OP_TOKEN:
+                switch (lex.metadata.op) {
+                case OPENING_PAREN_OP:
+                case NEG_OP: // prefix operators have no left operand to reduce
+                    lex_stack_push(op_stack, lex);
+                    break;
+                case CLOSING_PAREN_OP:
+                    while (lex_stack_peek(op_stack).metadata.op != OPENING_PAREN_OP) {
+                        emit(lex_stack_pop(op_stack));
+                    }
+                    lex_stack_pop(op_stack);
+                    break;
+                default:
+                    while (!lex_stack_is_empty(op_stack) && lex_stack_peek(op_stack).metadata.op != OPENING_PAREN_OP &&
+                           op_precedence_cmp(lex_stack_peek(op_stack).metadata.op, lex.metadata.op) >= 0) {
+                        emit(lex_stack_pop(op_stack));
+                    }
+                    lex_stack_push(op_stack, lex);
+                    break;
+                }
+            default:
+                break;
+            }
+        }
+        while (!lex_stack_is_empty(op_stack)) {
+            emit(lex_stack_pop(op_stack));
+        }
+#undef emit
+        program_p->count = count;
+    }
+
+#ifdef DEBUG
+    {
+        lexeme_type lex;
+        printf("Input queue (postfix):");
+        for (size_t i = 0; i < program_p->count; i++) {
+            lex = program_p->code_p[i];
+            switch (lex.token) {
+            case NUMBER_TOKEN:
+                printf(" %g", lex.metadata.num);
+                break;
+            case INTEGER_TOKEN:
+                printf(" %" PRId64, lex.metadata.inum);
+                break;
+            case OP_TOKEN:
+                printf(" %c", decode_op(lex.metadata.op));
+                break;
+            case VARIABLE_TOKEN:
+                printf(" %s", program_p->variable_names_pp[lex.metadata.var_index]);
+                break;
+            case LAST_VALUE_TOKEN:
+                printf(" _");
+                break;
+            default:
+                break;
+            }
+        }
+        putchar('\n');
+    }
+#endif
+
+    lex_stack_destroy(op_stack);
+    lex_queue_destroy(inp_queue);
+
+    return program_p;
+
+on_oom_error:
+    state_p->error_msg = EVAL_OOM_ERROR_MSG;
+    state_p->error_index = -1;
+
+    if (op_stack != NULL) {
+        lex_stack_destroy(op_stack);
+    }
+    if (inp_queue != NULL) {
+        lex_queue_destroy(inp_queue);
+    }
+    eval_program_destroy(program_p);
+    return NULL;
+}
+
+#define EVAL_LOCAL_STACK_SIZE 64
+
+// run the program in int64_t. returns 1 on success, 0 if the program must run in double instead (overflow, inexact
+// division, negative exponent or a non-integral `_`), and -1 when out of memory.
+static int eval_program_run_int(const eval_state_type* state_p, const eval_program_type* program_p, int64_t* result_p) {
+    int64_t local_stack[EVAL_LOCAL_STACK_SIZE];
+    int64_t* stack_p = local_stack;
+    if (program_p->stack_depth > EVAL_LOCAL_STACK_SIZE) {
+        stack_p = malloc(program_p->stack_depth * sizeof(int64_t));
+        if (!stack_p) {
+            return -1;
+        }
+    }
+    int rtr_value = 0;
+    size_t n = 0;
+    stack_p[0] = 0;
+
+    for (size_t i = 0; i < program_p->count; i++) {
+        lexeme_type lex = program_p->code_p[i];
+        switch (lex.token) {
+        case INTEGER_TOKEN:
+            stack_p[n++] = lex.metadata.inum;
+            break;
+        case LAST_VALUE_TOKEN:
+            if (!state_p->last_value_is_int) {
+                goto cleanup;
+            }
+            stack_p[n++] = state_p->last_int_value;
+            break;
+        case OP_TOKEN: {
+            if (lex.metadata.op == NEG_OP) {
+                if (__builtin_sub_overflow(0, stack_p[n - 1], &stack_p[n - 1])) {
+                    goto cleanup;
+                }
+                break;
+            }
+            int64_t y = stack_p[--n];
+            int64_t x = stack_p[n - 1];
+            int64_t* r_p = &stack_p[n - 1];
+            switch (lex.metadata.op) {
+            case ADD_OP:
+                if (__builtin_add_overflow(x, y, r_p)) {
+                    goto cleanup;
+                }
+                break;
+            case SUB_OP:
+                if (__builtin_sub_overflow(x, y, r_p)) {
+                    goto cleanup;
+                }
+                break;
+            case MUL_OP:
+                if (__builtin_mul_overflow(x, y, r_p)) {
+                    goto cleanup;
+                }
+                break;
+            case DIV_OP:
+                // truncating division only when forced, otherwise only exact quotients stay integers
+                if (y == 0 || (x == INT64_MIN && y == -1) || (state_p->int_mode != EVAL_INT_MODE_FORCE && x % y != 0)) {
+                    goto cleanup;
+                }
+                *r_p = x / y;
+                break;
+            case POW_OP: {
+                // exponentiation by squaring
+                if (y < 0) {
+                    goto cleanup;
+                }
+                int64_t result = 1;
+                while (y > 0) {
+                    if ((y & 1) && __builtin_mul_overflow(result, x, &result)) {
+                        goto cleanup;
+                    }
+                    y >>= 1;
+                    if (y > 0 && __builtin_mul_overflow(x, x, &x)) {
+                        goto cleanup;
+                    }
+                }
+                *r_p = result;
+                break;
+            }
+            default:
+                break;
+            }
+            break;
+        }
+        default:
+            goto cleanup;
+        }
+    }
+    *result_p = stack_p[0];
+    rtr_value = 1;
+
+cleanup:
+    if (stack_p != local_stack) {
+        free(stack_p);
+    }
+    return rtr_value;
+}
+
+double eval_program_run(eval_state_type* state_p, const eval_program_type* program_p, const double* variables_p) {
+    if (state_p->int_mode != EVAL_INT_MODE_OFF && program_p->is_integral) {
+        int64_t int_value;
+        switch (eval_program_run_int(state_p, program_p, &int_value)) {
+        case 1:
+            state_p->last_int_value = int_value;
+            state_p->last_value_is_int = true;
+            state_p->last_value = (double)int_value;
+            return state_p->last_value;
+        case -1:
+            state_p->error_msg = EVAL_OOM_ERROR_MSG;
+            state_p->error_index = -1;
+            return RTR_VALUE_DEFAULT;
+        default:
+            break;
+        }
+    }
+
+    double local_stack[EVAL_LOCAL_STACK_SIZE];
+    double* stack_p = local_stack;
+    if (program_p->stack_depth > EVAL_LOCAL_STACK_SIZE) {
+        stack_p = malloc(program_p->stack_depth * sizeof(double));
+        if (!stack_p) {
+            state_p->error_msg = EVAL_OOM_ERROR_MSG;
+            state_p->error_index = -1;
+            return RTR_VALUE_DEFAULT;
+        }
+    }
+    size_t n = 0;
+    stack_p[0] = RTR_VALUE_DEFAULT;
+
+    for (size_t i = 0; i < program_p->count; i++) {
+        lexeme_type lex = program_p->code_p[i];
+        switch (lex.token) {
+        case NUMBER_TOKEN:
+            stack_p[n++] = lex.metadata.num;
+            break;
+        case INTEGER_TOKEN:
+            stack_p[n++] = (double)lex.metadata.inum;
+            break;
+        case VARIABLE_TOKEN:
+            stack_p[n++] = variables_p[lex.metadata.var_index];
+            break;
+        case LAST_VALUE_TOKEN:
+            stack_p[n++] = state_p->last_value;
+            break;
+        case OP_TOKEN: {
+            if (lex.metadata.op == NEG_OP) {
+                stack_p[n - 1] = -stack_p[n - 1];
+                break;
+            }
+            double y = stack_p[--n];
+            double x = stack_p[n - 1];
+            switch (lex.metadata.op) {
+            case ADD_OP:
+                stack_p[n - 1] = x + y;
+                break;
+            case SUB_OP:
+                stack_p[n - 1] = x - y;
+                break;
+            case MUL_OP:
+                stack_p[n - 1] = x * y;
+                break;
+            case DIV_OP:
+                stack_p[n - 1] = x / y;
+                break;
+            case POW_OP:
+                stack_p[n - 1] = pow(x, y);
+                break;
+            default:
+                break;
+            }
+            break;
+        }
+        default:
+            break;
+        }
+    }
+
+    double rtr_value = stack_p[0];
+    if (stack_p != local_stack) {
+        free(stack_p);
+    }
+    state_p->last_value = rtr_value;
+    state_p->last_value_is_int = false;
+    return rtr_value;
+}
+
+// columnar evaluation: the program is run one operation at a time over blocks of rows. every operand on the stack is
+// a pointer to a block, either into a column or into scratch space owned by its stack slot.
+
+#define EVAL_BLOCK_SIZE 512
+
+typedef double vec_double_type __attribute__((vector_size(32)));
+#define VEC_LANES (sizeof(vec_double_type) / sizeof(double))
+
+#define define_binary_kernel(name, vec_expr, scalar_expr)                             \
+    static void name(double* out_p, const double* x_p, const double* y_p, size_t n) { \
+        size_t i = 0;                                                                 \
+        for (; i + VEC_LANES <= n; i += VEC_LANES) {                                  \
+            vec_double_type x, y, r;                                                  \
+            memcpy(&x, &x_p[i], sizeof(x));                                           \
+            memcpy(&y, &y_p[i], sizeof(y));                                           \
+            r = (vec_expr);                                                           \
+            memcpy(&out_p[i], &r, sizeof(r));                                         \
+        }                                                                             \
+        for (; i < n; i++) {                                                          \
+            double x = x_p[i], y = y_p[i];                                            \
+            out_p[i] = (scalar_expr);                                                 \
+        }                                                                             \
+    }
+
+define_binary_kernel(kernel_add, x + y, x + y)
+define_binary_kernel(kernel_sub, x - y, x - y)
+define_binary_kernel(kernel_mul, x * y, x * y)
+define_binary_kernel(kernel_div, x / y, x / y)
+
+static void kernel_pow(double* out_p, const double* x_p, const double* y_p, size_t n) {
+    // there is no vector pow in libm. keep it as a tight scalar loop.
+    for (size_t i = 0; i < n; i++) {
+        out_p[i] = pow(x_p[i], y_p[i]);
+    }
+}
+
+static void kernel_neg(double* out_p, const double* x_p, size_t n) {
+    size_t i = 0;
+    for (; i + VEC_LANES <= n; i += VEC_LANES) {
+        vec_double_type x;
+        memcpy(&x, &x_p[i], sizeof(x));
+        x = -x;
+        memcpy(&out_p[i], &x, sizeof(x));
+    }
+    for (; i < n; i++) {
+        out_p[i] = -x_p[i];
+    }
+}
+
+static void kernel_fill(double* out_p, double value, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        out_p[i] = value;
+    }
+}
+
+bool eval_program_run_columns(eval_state_type* state_p, const eval_program_type* program_p, const double* const* columns_pp,
+                              size_t row_count, double* out_p) {
+    state_p->error_msg = NULL;
+    state_p->error_index = 0;
+
+    size_t depth = program_p->stack_depth;
+    double* scratch_p = malloc(depth * EVAL_BLOCK_SIZE * sizeof(double));
+    const double** stack_pp = malloc(depth * sizeof(double*));
+    if (!scratch_p || !stack_pp) {
+        free(scratch_p);
+        free(stack_pp);
+        state_p->error_msg = EVAL_OOM_ERROR_MSG;
+        state_p->error_index = -1;
+        return false;
+    }
+
+    for (size_t begin = 0; begin < row_count; begin += EVAL_BLOCK_SIZE) {
+        size_t m = row_count - begin < EVAL_BLOCK_SIZE ? row_count - begin : EVAL_BLOCK_SIZE;
+        size_t n = 0;
+
+        for (size_t i = 0; i < program_p->count; i++) {
+            lexeme_type lex = program_p->code_p[i];
+            double* slot_p = &scratch_p[(n == 0 ? 0 : n - 1) * EVAL_BLOCK_SIZE];
+
+            switch (lex.token) {
+            case NUMBER_TOKEN:
+            case INTEGER_TOKEN:
+            case LAST_VALUE_TOKEN:
+                slot_p = &scratch_p[n * EVAL_BLOCK_SIZE];
+                kernel_fill(slot_p,
+                            lex.token == NUMBER_TOKEN    ? lex.metadata.num
+                            : lex.token == INTEGER_TOKEN ? (double)lex.metadata.inum
+                                                         : state_p->last_value,
+                            m);
+                stack_pp[n++] = slot_p;
+                break;
+            case VARIABLE_TOKEN:
+                stack_pp[n++] = &columns_pp[lex.metadata.var_index][begin];
+                break;
+            case OP_TOKEN:
+                if (lex.metadata.op == NEG_OP) {
+                    kernel_neg(slot_p, stack_pp[n - 1], m);
+                    stack_pp[n - 1] = slot_p;
+                    break;
+                }
+                slot_p = &scratch_p[(n - 2) * EVAL_BLOCK_SIZE];
+                switch (lex.metadata.op) {
+                case ADD_OP:
+                    kernel_add(slot_p, stack_pp[n - 2], stack_pp[n - 1], m);
+                    break;
+                case SUB_OP:
+                    kernel_sub(slot_p, stack_pp[n - 2], stack_pp[n - 1], m);
+                    break;
+                case MUL_OP:
+                    kernel_mul(slot_p, stack_pp[n - 2], stack_pp[n - 1], m);
+                    break;
+                case DIV_OP:
+                    kernel_div(slot_p, stack_pp[n - 2], stack_pp[n - 1], m);
+                    break;
+                case POW_OP:
+                    kernel_pow(slot_p, stack_pp[n - 2], stack_pp[n - 1], m);
+                    break;
+                default:
+                    break;
+                }
+                stack_pp[n - 2] = slot_p;
+                n--;
+                break;
+            default:
+                break;
+            }
+        }
+        memcpy(&out_p[begin], stack_pp[0], m * sizeof(double));
+    }
+
+    free(scratch_p);
+    free(stack_pp);
+    return true;
+}
+
+double eval(eval_state_type* state_p, const char* str, ssize_t len) {
+    eval_program_type* program_p = eval_compile(state_p, str, len);
+    if (program_p == NULL) {
+        return RTR_VALUE_DEFAULT;
+    }
+    double rtr_value = eval_program_run(state_p, program_p, NULL);
+    eval_program_destroy(program_p);
+    return rtr_value;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <stdbool.h>   // bool
+#include <stddef.h>    // size_t
+#include <stdint.h>    // int64_t
+#include <sys/types.h> // ssize_t
+
+#define EVAL_OOM_ERROR_MSG "Out of memory."
+
+typedef enum {
+    EVAL_INT_MODE_AUTO,  // integer-only expressions run in int64_t while results stay exact
+    EVAL_INT_MODE_FORCE, // as above, but `/` truncates towards zero
+    EVAL_INT_MODE_OFF,   // always run in double
+} eval_int_mode_type;
+
+// evaluation state. every thread evaluating expressions should use its own.
+typedef struct {
+    double last_value;       // value of `_`
+    bool last_value_enabled; // if false, `_` is rejected
+    bool variables_enabled;  // if false, names such as `a` are rejected
+
+    // expressions with only integer literals run in int64_t, and fall back to double on overflow, a negative
+    // exponent, division by zero, or (unless forced) inexact division.
+    eval_int_mode_type int_mode;
+    bool last_value_is_int; // if true, `last_value` is `last_int_value` exactly
+    int64_t last_int_value;
+
+    const char* error_msg; // set on error, otherwise NULL
+    ssize_t error_index;   // 0-based index of the offending character in the input, or -1
+} eval_state_type;
+
+// compiled (postfix) form of an expression. immutable once compiled, so it can be shared between threads.
+typedef struct eval_program_type eval_program_type;
+
+void eval_state_init(eval_state_type* state_p, bool last_value_enabled);
+
+double eval(eval_state_type* state_p, const char* str, ssize_t len);
+
+eval_program_type* eval_compile(eval_state_type* state_p, const char* str, ssize_t len);
+
+// run only the lexer phase of `eval_compile`. returns the number of lexemes, or 0 on error. used for benchmarking.
+size_t eval_lex(eval_state_type* state_p, const char* str, ssize_t len);
+
+void eval_program_destroy(eval_program_type* program_p);
+
+size_t eval_program_variable_count(const eval_program_type* program_p);
+
+const char* eval_program_variable_name(const eval_program_type* program_p, size_t index);
+
+// if true, the result depends on `_` and not only on the variables.
+bool eval_program_uses_last_value(const eval_program_type* program_p);
+
+// `variables_p[i]` is the value of variable `i`.
+double eval_program_run(eval_state_type* state_p, const eval_program_type* program_p, const double* variables_p);
+
+// `columns_pp[i]` points to `row_count` values of variable `i`. writes `row_count` results to `out_p`.
+bool eval_program_run_columns(eval_state_type* state_p, const eval_program_type* program_p, const double* const* columns_pp,
+                              size_t row_count, double* out_p);
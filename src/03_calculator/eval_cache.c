@@ -0,0 +1,281 @@
+#include <ctype.h>   // isalnum, isdigit
+#include <stdbool.h> // bool, true, false
+#include <stdint.h>  // uint64_t, int64_t, SIZE_MAX
+#include <stdlib.h>  // malloc, calloc, realloc, free
+#include <string.h>  // memcmp, memcpy
+
+#include "eval.h" // eval, eval_compile, eval_program_*
+#include "eval_cache.h"
+
+#define EVAL_CACHE_NIL SIZE_MAX
+
+typedef struct {
+    char* key_p;
+    size_t key_len;
+    uint64_t hash;
+    size_t next_in_bucket;
+    size_t lru_prev; // towards the most recently used entry
+    size_t lru_next; // towards the least recently used entry
+
+    eval_program_type* program_p;
+    bool has_result; // false if the program uses `_`
+    double value;
+    bool value_is_int;
+    int64_t int_value;
+} eval_cache_entry_type;
+
+struct eval_cache_type {
+    size_t capacity;
+    size_t count;
+    size_t bucket_mask;
+    size_t* buckets_p;
+    eval_cache_entry_type* entries_p;
+    size_t lru_head; // most recently used
+    size_t lru_tail; // least recently used
+
+    char* key_buf;
+    size_t key_buf_capacity;
+
+    eval_cache_stats_type stats;
+};
+
+eval_cache_type* eval_cache_create(size_t capacity) {
+    if (capacity == 0) {
+        return NULL;
+    }
+    eval_cache_type* cache_p = calloc(1, sizeof(eval_cache_type));
+    if (cache_p == NULL) {
+        return NULL;
+    }
+    size_t bucket_count = 1;
+    while (bucket_count < 2 * capacity) {
+        bucket_count <<= 1;
+    }
+    cache_p->capacity = capacity;
+    cache_p->bucket_mask = bucket_count - 1;
+    cache_p->buckets_p = malloc(bucket_count * sizeof(size_t));
+    cache_p->entries_p = malloc(capacity * sizeof(eval_cache_entry_type));
+    if (cache_p->buckets_p == NULL || cache_p->entries_p == NULL) {
+        eval_cache_destroy(cache_p);
+        return NULL;
+    }
+    for (size_t i = 0; i < bucket_count; i++) {
+        cache_p->buckets_p[i] = EVAL_CACHE_NIL;
+    }
+    cache_p->lru_head = cache_p->lru_tail = EVAL_CACHE_NIL;
+    return cache_p;
+}
+
+void eval_cache_destroy(eval_cache_type* cache_p) {
+    if (cache_p == NULL) {
+        return;
+    }
+    for (size_t i = 0; i < cache_p->count; i++) {
+        free(cache_p->entries_p[i].key_p);
+        eval_program_destroy(cache_p->entries_p[i].program_p);
+    }
+    free(cache_p->entries_p);
+    free(cache_p->buckets_p);
+    free(cache_p->key_buf);
+    free(cache_p);
+}
+
+eval_cache_stats_type eval_cache_stats(const eval_cache_type* cache_p) {
+    return cache_p->stats;
+}
+
+#define is_word_char(c) (isalnum((unsigned char)(c)) || (c) == '.' || (c) == '_')
+#define is_sign_char(c) ((c) == '+' || (c) == '-')
+#define is_space_char(c) ((c) == ' ' || (c) == '\n' || (c) == '\0')
+
+// write the key of `str` to `key_p`, which must fit `len + 1` characters. returns the key length.
+//
+// the key starts with a byte of the state flags that change how the expression compiles or runs. whitespace is dropped
+// unless it separates two operands (`1 2` is an error, `12` is not). a sign run is folded the way the lexer reads it: ' '
+// within the run is skipped, and a run after a newline replaces the previous one. spaces and signs after the 'e' of a
+// number are kept as written, since they decide whether its exponent is valid (`1e+5` is a number, `1e--5` is an error).
+static size_t eval_cache_make_key(const eval_state_type* state_p, const char* str, size_t len, char* key_p) {
+    size_t n = 0;
+    key_p[n++] = (char)(state_p->last_value_enabled | state_p->variables_enabled << 1 | state_p->int_mode << 2);
+
+    bool after_space = false;
+    bool in_number = false; // the last word in the key started with a digit or '.'
+    for (size_t i = 0; i < len; i++) {
+        char c = str[i];
+        // after the 'e' of a number, only a single sign directly followed by a digit makes a valid exponent. the spaces and
+        // signs that follow are kept as written.
+        if (in_number && (key_p[n - 1] == 'e' || key_p[n - 1] == 'E') && (is_space_char(c) || is_sign_char(c))) {
+            while (i < len && (is_space_char(str[i]) || is_sign_char(str[i]))) {
+                key_p[n++] = str[i++];
+            }
+            i--;
+            after_space = false;
+            in_number = false;
+            continue;
+        }
+        if (is_space_char(c)) {
+            after_space = true;
+            continue;
+        }
+        if (is_sign_char(c)) {
+            bool negative = c == '-';
+            while (i + 1 < len && (is_sign_char(str[i + 1]) || str[i + 1] == ' ')) {
+                negative ^= str[i + 1] == '-';
+                i++;
+            }
+            c = negative ? '-' : '+';
+            if (is_sign_char(key_p[n - 1])) {
+                n--;
+            }
+        } else if (after_space && is_word_char(key_p[n - 1]) && is_word_char(c)) {
+            key_p[n++] = ' ';
+        }
+        after_space = false;
+        if (is_word_char(c)) {
+            in_number = is_word_char(key_p[n - 1]) ? in_number : isdigit((unsigned char)c) || c == '.';
+        } else {
+            in_number = false;
+        }
+        key_p[n++] = c;
+    }
+    return n;
+}
+
+static uint64_t eval_cache_hash(const char* key_p, size_t len) {
+    // FNV-1a hash
+    uint64_t hash = 14695981039346656037UL;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (unsigned char)key_p[i];
+        hash *= 1099511628211UL;
+    }
+    return hash;
+}
+
+static size_t eval_cache_find(const eval_cache_type* cache_p, const char* key_p, size_t key_len, uint64_t hash) {
+    size_t index = cache_p->buckets_p[hash & cache_p->bucket_mask];
+    while (index != EVAL_CACHE_NIL) {
+        const eval_cache_entry_type* entry_p = &cache_p->entries_p[index];
+        if (entry_p->hash == hash && entry_p->key_len == key_len && memcmp(entry_p->key_p, key_p, key_len) == 0) {
+            return index;
+        }
+        index = entry_p->next_in_bucket;
+    }
+    return EVAL_CACHE_NIL;
+}
+
+static void eval_cache_lru_unlink(eval_cache_type* cache_p, size_t index) {
+    eval_cache_entry_type* entry_p = &cache_p->entries_p[index];
+    if (entry_p->lru_prev != EVAL_CACHE_NIL) {
+        cache_p->entries_p[entry_p->lru_prev].lru_next = entry_p->lru_next;
+    } else {
+        cache_p->lru_head = entry_p->lru_next;
+    }
+    if (entry_p->lru_next != EVAL_CACHE_NIL) {
+        cache_p->entries_p[entry_p->lru_next].lru_prev = entry_p->lru_prev;
+    } else {
+        cache_p->lru_tail = entry_p->lru_prev;
+    }
+}
+
+static void eval_cache_lru_push_front(eval_cache_type* cache_p, size_t index) {
+    eval_cache_entry_type* entry_p = &cache_p->entries_p[index];
+    entry_p->lru_prev = EVAL_CACHE_NIL;
+    entry_p->lru_next = cache_p->lru_head;
+    if (cache_p->lru_head != EVAL_CACHE_NIL) {
+        cache_p->entries_p[cache_p->lru_head].lru_prev = index;
+    } else {
+        cache_p->lru_tail = index;
+    }
+    cache_p->lru_head = index;
+}
+
+// free the least recently used entry and return its slot.
+static size_t eval_cache_evict(eval_cache_type* cache_p) {
+    size_t index = cache_p->lru_tail;
+    eval_cache_entry_type* entry_p = &cache_p->entries_p[index];
+    eval_cache_lru_unlink(cache_p, index);
+
+    size_t* link_p = &cache_p->buckets_p[entry_p->hash & cache_p->bucket_mask];
+    while (*link_p != index) {
+        link_p = &cache_p->entries_p[*link_p].next_in_bucket;
+    }
+    *link_p = entry_p->next_in_bucket;
+
+    free(entry_p->key_p);
+    eval_program_destroy(entry_p->program_p);
+    cache_p->stats.evictions++;
+    return index;
+}
+
+// take ownership of `program_p`. on allocation failure it is destroyed and nothing is cached.
+static void eval_cache_insert(eval_cache_type* cache_p, const eval_state_type* state_p, eval_program_type* program_p,
+                              size_t key_len, uint64_t hash) {
+    char* key_p = malloc(key_len);
+    if (key_p == NULL) {
+        eval_program_destroy(program_p);
+        return;
+    }
+    memcpy(key_p, cache_p->key_buf, key_len);
+
+    size_t index = cache_p->count < cache_p->capacity ? cache_p->count++ : eval_cache_evict(cache_p);
+    eval_cache_entry_type* entry_p = &cache_p->entries_p[index];
+    *entry_p = (eval_cache_entry_type){.key_p = key_p,
+                                       .key_len = key_len,
+                                       .hash = hash,
+                                       .next_in_bucket = cache_p->buckets_p[hash & cache_p->bucket_mask],
+                                       .program_p = program_p,
+                                       .has_result = !eval_program_uses_last_value(program_p),
+                                       .value = state_p->last_value,
+                                       .value_is_int = state_p->last_value_is_int,
+                                       .int_value = state_p->last_int_value};
+    cache_p->buckets_p[hash & cache_p->bucket_mask] = index;
+    eval_cache_lru_push_front(cache_p, index);
+}
+
+double eval_cached(eval_state_type* state_p, eval_cache_type* cache_p, const char* str, ssize_t len) {
+    if (len < 0) {
+        return eval(state_p, str, len);
+    }
+    if (cache_p->key_buf_capacity < (size_t)len + 1) {
+        char* key_buf = realloc(cache_p->key_buf, (size_t)len + 1);
+        if (key_buf == NULL) {
+            return eval(state_p, str, len);
+        }
+        cache_p->key_buf = key_buf;
+        cache_p->key_buf_capacity = (size_t)len + 1;
+    }
+    size_t key_len = eval_cache_make_key(state_p, str, (size_t)len, cache_p->key_buf);
+    uint64_t hash = eval_cache_hash(cache_p->key_buf, key_len);
+
+    size_t index = eval_cache_find(cache_p, cache_p->key_buf, key_len, hash);
+    if (index != EVAL_CACHE_NIL) {
+        cache_p->stats.hits++;
+        if (index != cache_p->lru_head) {
+            eval_cache_lru_unlink(cache_p, index);
+            eval_cache_lru_push_front(cache_p, index);
+        }
+        const eval_cache_entry_type* entry_p = &cache_p->entries_p[index];
+        state_p->error_msg = NULL;
+        state_p->error_index = 0;
+        if (!entry_p->has_result) {
+            return eval_program_run(state_p, entry_p->program_p, NULL);
+        }
+        state_p->last_value = entry_p->value;
+        state_p->last_value_is_int = entry_p->value_is_int;
+        state_p->last_int_value = entry_p->int_value;
+        return entry_p->value;
+    }
+
+    cache_p->stats.misses++;
+    eval_program_type* program_p = eval_compile(state_p, str, len);
+    if (program_p == NULL) {
+        return 0.;
+    }
+    double value = eval_program_run(state_p, program_p, NULL);
+    if (state_p->error_msg != NULL) {
+        eval_program_destroy(program_p);
+        return value;
+    }
+    eval_cache_insert(cache_p, state_p, program_p, key_len, hash);
+    return value;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <stddef.h>    // size_t
+#include <sys/types.h> // ssize_t
+
+#include "eval.h" // eval_state_type
+
+// bounded LRU cache of compiled expressions, keyed on the expression with insignificant whitespace removed and runs of
+// signs folded, so `1 + --2` and `1+2` share an entry. for expressions not using `_` the result is cached as well.
+// only successfully compiled expressions are cached. not thread-safe: use one per eval state.
+typedef struct eval_cache_type eval_cache_type;
+
+typedef struct {
+    size_t hits;
+    size_t misses;
+    size_t evictions;
+} eval_cache_stats_type;
+
+eval_cache_type* eval_cache_create(size_t capacity);
+
+void eval_cache_destroy(eval_cache_type* cache_p);
+
+// as `eval`, but looks up `str` in the cache first.
+double eval_cached(eval_state_type* state_p, eval_cache_type* cache_p, const char* str, ssize_t len);
+
+eval_cache_stats_type eval_cache_stats(const eval_cache_type* cache_p);
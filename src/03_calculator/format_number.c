@@ -0,0 +1,354 @@
+/*
+    double to string conversion.
+
+    `format_number_shortest` prints the shortest digit string that reads back as the same double, using the Grisu3
+    algorithm: the value and the boundaries halfway to its neighbours are scaled by a cached power of ten into a
+    range where digits can be generated with 64-bit integer arithmetic, and digit generation stops as soon as the
+    digits lie inside the boundaries. the scaled values are off by up to one unit, so the digits are generated for
+    the widest interval that could be inside the boundaries, and kept only if they are provably the shortest and
+    closest. for the rare doubles where that cannot be decided (under 1%), the shortest of "%.15e", "%.16e" and
+    "%.17e" that reads back as the value is used instead.
+
+    sources:
+    - https://www.cs.tufts.edu/~nr/cs257/archive/florian-loitsch/printf.pdf (Florian Loitsch, Printing
+      Floating-Point Numbers Quickly and Accurately with Integers)
+    - https://github.com/google/double-conversion/blob/master/double-conversion/fast-dtoa.cc
+*/
+
+#include <stdbool.h> // bool, true, false
+#include <stdint.h>  // uint64_t, uint32_t, int64_t
+#include <stdio.h>   // snprintf
+#include <stdlib.h>  // strtod, strtol
+#include <string.h>  // memcpy, memmove, memset
+
+#include "format_number.h"
+
+__extension__ typedef unsigned __int128 uint128_type;
+
+#define DP_SIGNIFICAND_SIZE 52
+#define DP_EXPONENT_BIAS (0x3FF + DP_SIGNIFICAND_SIZE)
+#define DP_MIN_EXPONENT (-DP_EXPONENT_BIAS)
+#define DP_EXPONENT_MASK 0x7FF0000000000000u
+#define DP_SIGNIFICAND_MASK 0x000FFFFFFFFFFFFFu
+#define DP_HIDDEN_BIT 0x0010000000000000u
+
+// "do-it-yourself floating point": f * 2^e
+typedef struct {
+    uint64_t f;
+    int e;
+} diy_fp_type;
+
+static const uint64_t cached_powers_f[] = {
+    0xfa8fd5a0081c0288u, 0xbaaee17fa23ebf76u, 0x8b16fb203055ac76u, 0xcf42894a5dce35eau,
+    0x9a6bb0aa55653b2du, 0xe61acf033d1a45dfu, 0xab70fe17c79ac6cau, 0xff77b1fcbebcdc4fu,
+    0xbe5691ef416bd60cu, 0x8dd01fad907ffc3cu, 0xd3515c2831559a83u, 0x9d71ac8fada6c9b5u,
+    0xea9c227723ee8bcbu, 0xaecc49914078536du, 0x823c12795db6ce57u, 0xc21094364dfb5637u,
+    0x9096ea6f3848984fu, 0xd77485cb25823ac7u, 0xa086cfcd97bf97f4u, 0xef340a98172aace5u,
+    0xb23867fb2a35b28eu, 0x84c8d4dfd2c63f3bu, 0xc5dd44271ad3cdbau, 0x936b9fcebb25c996u,
+    0xdbac6c247d62a584u, 0xa3ab66580d5fdaf6u, 0xf3e2f893dec3f126u, 0xb5b5ada8aaff80b8u,
+    0x87625f056c7c4a8bu, 0xc9bcff6034c13053u, 0x964e858c91ba2655u, 0xdff9772470297ebdu,
+    0xa6dfbd9fb8e5b88fu, 0xf8a95fcf88747d94u, 0xb94470938fa89bcfu, 0x8a08f0f8bf0f156bu,
+    0xcdb02555653131b6u, 0x993fe2c6d07b7facu, 0xe45c10c42a2b3b06u, 0xaa242499697392d3u,
+    0xfd87b5f28300ca0eu, 0xbce5086492111aebu, 0x8cbccc096f5088ccu, 0xd1b71758e219652cu,
+    0x9c40000000000000u, 0xe8d4a51000000000u, 0xad78ebc5ac620000u, 0x813f3978f8940984u,
+    0xc097ce7bc90715b3u, 0x8f7e32ce7bea5c70u, 0xd5d238a4abe98068u, 0x9f4f2726179a2245u,
+    0xed63a231d4c4fb27u, 0xb0de65388cc8ada8u, 0x83c7088e1aab65dbu, 0xc45d1df942711d9au,
+    0x924d692ca61be758u, 0xda01ee641a708deau, 0xa26da3999aef774au, 0xf209787bb47d6b85u,
+    0xb454e4a179dd1877u, 0x865b86925b9bc5c2u, 0xc83553c5c8965d3du, 0x952ab45cfa97a0b3u,
+    0xde469fbd99a05fe3u, 0xa59bc234db398c25u, 0xf6c69a72a3989f5cu, 0xb7dcbf5354e9beceu,
+    0x88fcf317f22241e2u, 0xcc20ce9bd35c78a5u, 0x98165af37b2153dfu, 0xe2a0b5dc971f303au,
+    0xa8d9d1535ce3b396u, 0xfb9b7cd9a4a7443cu, 0xbb764c4ca7a44410u, 0x8bab8eefb6409c1au,
+    0xd01fef10a657842cu, 0x9b10a4e5e9913129u, 0xe7109bfba19c0c9du, 0xac2820d9623bf429u,
+    0x80444b5e7aa7cf85u, 0xbf21e44003acdd2du, 0x8e679c2f5e44ff8fu, 0xd433179d9c8cb841u,
+    0x9e19db92b4e31ba9u, 0xeb96bf6ebadf77d9u, 0xaf87023b9bf0ee6bu,
+};
+
+static const int16_t cached_powers_e[] = {
+    -1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034, -1007, -980,
+    -954, -927, -901, -874, -847, -821, -794, -768, -741, -715,
+    -688, -661, -635, -608, -582, -555, -529, -502, -475, -449,
+    -422, -396, -369, -343, -316, -289, -263, -236, -210, -183,
+    -157, -130, -103, -77, -50, -24, 3, 30, 56, 83,
+    109, 136, 162, 189, 216, 242, 269, 295, 322, 348,
+    375, 402, 428, 455, 481, 508, 534, 561, 588, 614,
+    641, 667, 694, 720, 747, 774, 800, 827, 853, 880,
+    907, 933, 960, 986, 1013, 1039, 1066,
+};
+
+static const uint64_t pow10_table[] = {
+    1u, 10u, 100u, 1000u, 10000u, 100000u, 1000000u, 10000000u, 100000000u, 1000000000u, 10000000000u, 100000000000u,
+    1000000000000u, 10000000000000u, 100000000000000u, 1000000000000000u, 10000000000000000u, 100000000000000000u,
+    1000000000000000000u, 10000000000000000000u
+};
+
+static inline diy_fp_type diy_fp_mul(diy_fp_type x, diy_fp_type y) {
+    uint128_type p = (uint128_type)x.f * y.f;
+    uint64_t h = (uint64_t)(p >> 64);
+    uint64_t l = (uint64_t)p;
+    if (l & ((uint64_t)1 << 63)) { // rounding
+        h++;
+    }
+    return (diy_fp_type){.f = h, .e = x.e + y.e + 64};
+}
+
+static inline diy_fp_type diy_fp_normalize(diy_fp_type x) {
+    int s = __builtin_clzll(x.f);
+    return (diy_fp_type){.f = x.f << s, .e = x.e - s};
+}
+
+static inline diy_fp_type diy_fp_normalize_boundary(diy_fp_type x) {
+    while (!(x.f & (DP_HIDDEN_BIT << 1))) {
+        x.f <<= 1;
+        x.e--;
+    }
+    x.f <<= 64 - DP_SIGNIFICAND_SIZE - 2;
+    x.e -= 64 - DP_SIGNIFICAND_SIZE - 2;
+    return x;
+}
+
+static inline diy_fp_type diy_fp_from_bits(uint64_t bits) {
+    int biased_e = (int)((bits & DP_EXPONENT_MASK) >> DP_SIGNIFICAND_SIZE);
+    uint64_t significand = bits & DP_SIGNIFICAND_MASK;
+    if (biased_e != 0) {
+        return (diy_fp_type){.f = significand + DP_HIDDEN_BIT, .e = biased_e - DP_EXPONENT_BIAS};
+    }
+    return (diy_fp_type){.f = significand, .e = DP_MIN_EXPONENT + 1};
+}
+
+// boundaries m- and m+ of v, the halfway points to its neighbours, sharing the exponent of the normalized m+.
+static void diy_fp_normalized_boundaries(diy_fp_type v, diy_fp_type* minus_p, diy_fp_type* plus_p) {
+    diy_fp_type pl = diy_fp_normalize_boundary((diy_fp_type){.f = (v.f << 1) + 1, .e = v.e - 1});
+    diy_fp_type mi = v.f == DP_HIDDEN_BIT ? (diy_fp_type){.f = (v.f << 2) - 1, .e = v.e - 2}
+                                          : (diy_fp_type){.f = (v.f << 1) - 1, .e = v.e - 1};
+    mi.f <<= mi.e - pl.e;
+    mi.e = pl.e;
+    *plus_p = pl;
+    *minus_p = mi;
+}
+
+// a cached power of ten c_k, such that e + c_k.e + 64 is in [-60, -32]. *k_p is set to -k.
+static diy_fp_type get_cached_power(int e, int* k_p) {
+    double dk = (-61 - e) * 0.30102999566398114 + 347; // 1/log2(10)
+    int k = (int)dk;
+    if (dk - k > 0.) {
+        k++;
+    }
+    unsigned index = (unsigned)((k >> 3) + 1);
+    *k_p = -(-348 + (int)(index << 3));
+    return (diy_fp_type){.f = cached_powers_f[index], .e = cached_powers_e[index]};
+}
+
+// move the last digit of buf towards w while that stays inside the unsafe interval and gets closer to w. the distance
+// from the upper boundary to w is only known to within `unit`, so the digits are kept only if the same digit would have
+// been chosen at both ends of that range, and if they are inside the boundaries even with the error.
+static bool round_weed(char* buf, size_t len, uint64_t too_high_w, uint64_t unsafe_interval, uint64_t rest, uint64_t ten_kappa,
+                       uint64_t unit) {
+    uint64_t small_distance = too_high_w - unit;
+    uint64_t big_distance = too_high_w + unit;
+    while (rest < small_distance && unsafe_interval - rest >= ten_kappa &&
+           (rest + ten_kappa < small_distance || small_distance - rest >= rest + ten_kappa - small_distance)) {
+        buf[len - 1]--;
+        rest += ten_kappa;
+    }
+    if (rest < big_distance && unsafe_interval - rest >= ten_kappa &&
+        (rest + ten_kappa < big_distance || big_distance - rest > rest + ten_kappa - big_distance)) {
+        return false;
+    }
+    return 2 * unit <= rest && rest <= unsafe_interval - 4 * unit;
+}
+
+static inline int count_decimal_digits_32(uint32_t n) {
+    int count = 1;
+    while (n >= 10) {
+        n /= 10;
+        count++;
+    }
+    return count;
+}
+
+// generate the digits of the shortest number in (low, high), closest to w. all three are off by up to one unit. returns
+// false if the digits cannot be proven correct.
+static bool digit_gen(diy_fp_type low, diy_fp_type w, diy_fp_type high, char* buf, size_t* len_p, int* k_p) {
+    uint64_t unit = 1;
+    const diy_fp_type too_low = {.f = low.f - unit, .e = low.e};
+    const diy_fp_type too_high = {.f = high.f + unit, .e = high.e};
+    uint64_t unsafe_interval = too_high.f - too_low.f;
+    const diy_fp_type one = {.f = (uint64_t)1 << -w.e, .e = w.e};
+    uint32_t p1 = (uint32_t)(too_high.f >> -one.e);
+    uint64_t p2 = too_high.f & (one.f - 1);
+    int kappa = count_decimal_digits_32(p1);
+    size_t len = 0;
+
+    // integral part
+    while (kappa > 0) {
+        uint32_t divisor = (uint32_t)pow10_table[kappa - 1];
+        buf[len++] = (char)('0' + p1 / divisor);
+        p1 %= divisor;
+        kappa--;
+        uint64_t rest = ((uint64_t)p1 << -one.e) + p2;
+        if (rest < unsafe_interval) {
+            *k_p += kappa;
+            *len_p = len;
+            return round_weed(buf, len, too_high.f - w.f, unsafe_interval, rest, (uint64_t)divisor << -one.e, unit);
+        }
+    }
+
+    // fractional part
+    while (true) {
+        p2 *= 10;
+        unit *= 10;
+        unsafe_interval *= 10;
+        buf[len++] = (char)('0' + (p2 >> -one.e));
+        p2 &= one.f - 1;
+        kappa--;
+        if (p2 < unsafe_interval) {
+            *k_p += kappa;
+            *len_p = len;
+            return round_weed(buf, len, (too_high.f - w.f) * unit, unsafe_interval, p2, one.f, unit);
+        }
+    }
+}
+
+// write the digits of v (positive, finite, nonzero) to buf. v = buf * 10^k. returns false if they could not be proven
+// to be the shortest.
+static bool grisu3(uint64_t bits, char* buf, size_t* len_p, int* k_p) {
+    diy_fp_type v = diy_fp_from_bits(bits);
+    diy_fp_type w_m, w_p;
+    diy_fp_normalized_boundaries(v, &w_m, &w_p);
+
+    diy_fp_type c_mk = get_cached_power(w_p.e, k_p);
+    diy_fp_type w = diy_fp_mul(diy_fp_normalize(v), c_mk);
+    diy_fp_type wp = diy_fp_mul(w_p, c_mk);
+    diy_fp_type wm = diy_fp_mul(w_m, c_mk);
+    return digit_gen(wm, w, wp, buf, len_p, k_p);
+}
+
+// as grisu3, with the fewest of 15, 16 or 17 digits that read back as `value`. any double that can be written with
+// fewer digits is one of these with trailing zeros.
+static void digits_fallback(double value, char* buf, size_t* len_p, int* k_p) {
+    char tmp[FORMAT_NUMBER_MAX_LEN];
+    int precision = 15;
+    snprintf(tmp, sizeof(tmp), "%.*e", precision - 1, value);
+    while (precision < FORMAT_NUMBER_MAX_DIGITS && strtod(tmp, NULL) != value) {
+        precision++;
+        snprintf(tmp, sizeof(tmp), "%.*e", precision - 1, value);
+    }
+
+    // d.ddde+XX
+    size_t len = 0;
+    buf[len++] = tmp[0];
+    for (int i = 1; i < precision; i++) {
+        buf[len++] = tmp[i + 1];
+    }
+    while (len > 1 && buf[len - 1] == '0') {
+        len--;
+    }
+    *len_p = len;
+    *k_p = (int)strtol(&tmp[precision + 2], NULL, 10) - (int)len + 1;
+}
+
+static size_t write_exponent(int k, char* buf) {
+    size_t len = 0;
+    buf[len++] = 'e';
+    buf[len++] = k < 0 ? '-' : '+';
+    if (k < 0) {
+        k = -k;
+    }
+    if (k >= 100) {
+        buf[len++] = (char)('0' + k / 100);
+        k %= 100;
+        buf[len++] = (char)('0' + k / 10);
+    } else {
+        buf[len++] = (char)('0' + k / 10);
+    }
+    buf[len++] = (char)('0' + k % 10);
+    return len;
+}
+
+size_t format_number_shortest(double value, char* buf) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    size_t len = 0;
+    if (bits >> 63) {
+        buf[len++] = '-';
+        bits &= ~((uint64_t)1 << 63);
+    }
+    if ((bits & DP_EXPONENT_MASK) == DP_EXPONENT_MASK) {
+        memcpy(&buf[len], (bits & DP_SIGNIFICAND_MASK) ? "nan" : "inf", 3);
+        return len + 3;
+    }
+    if (bits == 0) {
+        buf[len++] = '0';
+        return len;
+    }
+
+    char* digits_p = &buf[len];
+    size_t digit_count;
+    int k;
+    if (!grisu3(bits, digits_p, &digit_count, &k)) {
+        double abs_value;
+        memcpy(&abs_value, &bits, sizeof(abs_value));
+        digits_fallback(abs_value, digits_p, &digit_count, &k);
+    }
+
+    // same choice of notation as "%.17g": scientific if the decimal exponent is below -4 or above 16
+    int exp10 = (int)digit_count + k - 1;
+    if (exp10 < -4 || exp10 >= FORMAT_NUMBER_MAX_DIGITS) {
+        // d.ddde+XX
+        if (digit_count > 1) {
+            memmove(&digits_p[2], &digits_p[1], digit_count - 1);
+            digits_p[1] = '.';
+            digit_count++;
+        }
+        return len + digit_count + write_exponent(exp10, &digits_p[digit_count]);
+    }
+    if (k >= 0) {
+        // ddd000
+        memset(&digits_p[digit_count], '0', (size_t)k);
+        return len + digit_count + (size_t)k;
+    }
+    if (exp10 >= 0) {
+        // dd.ddd
+        size_t point_index = (size_t)exp10 + 1;
+        memmove(&digits_p[point_index + 1], &digits_p[point_index], digit_count - point_index);
+        digits_p[point_index] = '.';
+        return len + digit_count + 1;
+    }
+    // 0.000ddd
+    size_t zero_count = (size_t)(-exp10 - 1);
+    memmove(&digits_p[2 + zero_count], digits_p, digit_count);
+    digits_p[0] = '0';
+    digits_p[1] = '.';
+    memset(&digits_p[2], '0', zero_count);
+    return len + 2 + zero_count + digit_count;
+}
+
+size_t format_number(double value, int precision, char* buf) {
+    if (precision < 0) {
+        return format_number_shortest(value, buf);
+    }
+    if (precision > FORMAT_NUMBER_MAX_DIGITS) {
+        precision = FORMAT_NUMBER_MAX_DIGITS;
+    }
+    return (size_t)snprintf(buf, FORMAT_NUMBER_MAX_LEN, "%.*g", precision, value);
+}
+
+size_t format_integer(int64_t value, char* buf) {
+    char digits[20];
+    size_t digit_count = 0;
+    uint64_t u = value < 0 ? -(uint64_t)value : (uint64_t)value;
+    do {
+        digits[digit_count++] = (char)('0' + u % 10);
+        u /= 10;
+    } while (u > 0);
+
+    size_t len = 0;
+    if (value < 0) {
+        buf[len++] = '-';
+    }
+    while (digit_count > 0) {
+        buf[len++] = digits[--digit_count];
+    }
+    return len;
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <stddef.h> // size_t
+#include <stdint.h> // int64_t
+
+#define FORMAT_NUMBER_MAX_DIGITS 17 // enough for any double to round-trip
+#define FORMAT_NUMBER_MAX_LEN 32    // buffer size that fits any output of the functions below
+
+// write the shortest representation of `value` that reads back as `value` to `buf`. not NUL-terminated. returns the
+// number of characters written.
+size_t format_number_shortest(double value, char* buf);
+
+// as `format_number_shortest` if `precision` is negative, otherwise as "%.*g" with `precision` (at most 17).
+size_t format_number(double value, int precision, char* buf);
+
+// write `value` exactly in decimal to `buf`. not NUL-terminated. returns the number of characters written.
+size_t format_integer(int64_t value, char* buf);
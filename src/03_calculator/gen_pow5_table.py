@@ -0,0 +1,46 @@
+#!/usr/bin/env python3
+
+# Writes pow5_table.h: 128-bit approximations of 5^q for q in [-342, 308], as used by the Eisel-Lemire algorithm
+# in parse_number.c. Each entry is normalized so that its most significant bit is set. Negative powers are rounded
+# up, positive powers truncated.
+# See: https://github.com/fastfloat/fast_float/blob/main/script/table_generation.py
+
+SMALLEST_POWER = -342
+LARGEST_POWER = 308
+
+entries = []
+for q in range(SMALLEST_POWER, 0):
+    power5 = 5 ** -q
+    z = 0
+    while (1 << z) < power5:
+        z += 1
+    if q >= -27:
+        b = z + 127
+        c = 2**b // power5 + 1
+    else:
+        b = 2 * z + 2 * 64
+        c = 2**b // power5 + 1
+        while c >= (1 << 128):
+            c //= 2
+    entries.append(c)
+for q in range(0, LARGEST_POWER + 1):
+    power5 = 5**q
+    while power5 < (1 << 127):
+        power5 *= 2
+    while power5 >= (1 << 128):
+        power5 //= 2
+    entries.append(power5)
+
+with open("pow5_table.h", "w") as f:
+    f.write("// generated by gen_pow5_table.py. do not edit.\n\n")
+    f.write("#pragma once\n\n")
+    f.write("#include <stdint.h>\n\n")
+    f.write("#define POW5_TABLE_SMALLEST_POWER (%d)\n" % SMALLEST_POWER)
+    f.write("#define POW5_TABLE_LARGEST_POWER (%d)\n\n" % LARGEST_POWER)
+    f.write("// { high 64 bits, low 64 bits } of 5^q, for q = POW5_TABLE_SMALLEST_POWER, ..., POW5_TABLE_LARGEST_POWER\n")
+    f.write("static const uint64_t pow5_table[%d] = {\n" % (2 * len(entries)))
+    for c in entries:
+        f.write("    0x%016xu, 0x%016xu,\n" % (c >> 64, c & ((1 << 64) - 1)))
+    f.write("};\n")
+
+print("Writing to pow5_table.h")
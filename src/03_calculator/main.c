@@ -1,429 +1,113 @@
-#include <ctype.h>
-#include <stdio.h>
-#include <stdlib.h>
+#include <stdbool.h> // bool, true, false
+#include <stdio.h>   // printf, fprintf, fwrite, getline, stdin, stdout, stderr
+#include <stdlib.h>  // free, strtol, strtoul
+#include <string.h>  // strcmp
 
-#include <math.h>
+#include <unistd.h> // sysconf
 
-typedef enum { DEFAULTOKEN, NUMBER_TOKEN, OP_TOKEN } token_type;
+#include "batch.h"         // batch_eval_file, batch_options_type
+#include "columns.h"       // columns_eval_stream
+#include "eval.h"          // eval, eval_state_*, eval_int_mode_type
+#include "eval_cache.h"    // eval_cache_*, eval_cached
+#include "format_number.h" // format_number, format_integer, FORMAT_NUMBER_MAX_LEN
 
-typedef enum { DEFAULOP, ADD_OP, SUB_OP, MUL_OP, DIV_OP, POW_OP, OPENING_PAREN_OP, CLOSING_PAREN_OP } operation_type;
+static const char prompt[] = "> ";
+#define prompt_len (sizeof(prompt) - 1)
 
-typedef struct {
-    token_type token;
-    union {
-        double num;
-        operation_type op;
-    } metadata;
-} lexeme_type;
-
-#define NAME lex_queue
-#define VALUE_TYPE lexeme_type
-#include "fqueue.h"
-
-#define NAME lex_stack
-#define VALUE_TYPE lexeme_type
-#include "fstack.h"
-
-char decode_op(operation_type op) {
-    switch (op) {
-    case ADD_OP:
-        return '+';
-    case SUB_OP:
-        return '-';
-    case MUL_OP:
-        return '*';
-    case DIV_OP:
-        return '/';
-    case POW_OP:
-        return '^';
-    case OPENING_PAREN_OP:
-        return '(';
-    case CLOSING_PAREN_OP:
-        return ')';
-    default:
-        break;
-    }
-    return 'D';
-}
-
-int op_precedence(operation_type op) {
-    switch (op) {
-    case POW_OP:
-        return 3;
-    case DIV_OP:
-    case MUL_OP:
-        return 2;
-    case SUB_OP:
-    case ADD_OP:
-        return 1;
-    default:
-        return 0;
-    }
+static void print_usage(const char* prog_name) {
+    fprintf(stderr, "Usage: %s [--precision N] [--int | --no-int] [--cache N [--cache-stats]] [--batch FILE [--threads N] | --columns EXPR]\n", prog_name);
 }
 
-int op_precedence_cmp(operation_type o1, operation_type o2) {
-    int o1_prec = op_precedence(o1);
-    int o2_prec = op_precedence(o2);
-    return -(o1_prec < o2_prec) + (o1_prec > o2_prec);
-}
-
-static const double RTR_VALUE_DEFAULT = 0.;
-static double RTR_VALUE_LAST = RTR_VALUE_DEFAULT;
-
-#define digit_to_num(v) ((v) - '0')
-#define last_token(inp_queue) (lex_queue_is_empty(inp_queue) ? DEFAULTOKEN : lex_queue_get_back(inp_queue).token)
-#define last_op(inp_queue) (lex_queue_is_empty(inp_queue) ? DEFAULOP : lex_queue_get_back(inp_queue).metadata.op)
-
-double eval(char* str, ssize_t len) {
-    if (len < 0) {
-        return RTR_VALUE_DEFAULT;
-    }
-    double rtr_value = RTR_VALUE_DEFAULT;
-    lex_queue_type* inp_queue = NULL;
-    lex_queue_type* inp_queue_postfix = NULL;
-    lex_stack_type* op_stack = NULL;
-    lex_stack_type* num_stack = NULL;
-
-    inp_queue = lex_queue_create(len);
-    if (!inp_queue) {
-        goto on_oom_error;
-    }
-
-    // error handling:
-    char* error_msg = NULL;
-    ssize_t error_index = 0;
-    size_t opening_paren_count = 0;
-    size_t closing_paren_count = 0;
-    bool incomplete_input = true;
-
-    operation_type sign = DEFAULOP;
-
-    for (ssize_t i = 0; i < len; i++) {
-        switch (str[i]) {
-        case '+':
-        case '-':
-            incomplete_input = true;
-            error_index = i;
-
-            sign = str[i] == '+' ? ADD_OP : SUB_OP;
-            while (i + 1 < len && (str[i + 1] == '-' || str[i + 1] == '+' || str[i + 1] == ' ')) {
-                if (str[i + 1] == '-') {
-                    sign = sign == SUB_OP ? ADD_OP : SUB_OP;
-                }
-                if (str[i + 1] == '+' || str[i + 1] == '-') {
-                    error_index = i + 1;
-                }
-                i++;
-            }
-            break;
-        case '*':
-        case '/':
-            incomplete_input = true;
-            error_index = i;
-            if (lex_queue_is_empty(inp_queue) ||
-                (last_token(inp_queue) == OP_TOKEN && (last_op(inp_queue) == MUL_OP || last_op(inp_queue) == DIV_OP))) {
-                error_msg = "Incorrect use of '*' or '/'.";
-                error_index = i;
-                goto on_inp_error;
-            }
-            lex_queue_enqueue(inp_queue, (lexeme_type){.token = OP_TOKEN, .metadata = {.op = str[i] == '*' ? MUL_OP : DIV_OP}});
-            break;
-        case '^':
-            incomplete_input = true;
-            error_index = i;
-            if (lex_queue_is_empty(inp_queue) || (last_token(inp_queue) == OP_TOKEN && last_op(inp_queue) == POW_OP)) {
-                error_msg = "Incorrect use of '^'.";
-                error_index = i;
-                goto on_inp_error;
-            }
-            lex_queue_enqueue(inp_queue, (lexeme_type){.token = OP_TOKEN, .metadata = {.op = POW_OP}});
-            break;
-        case '0':
-        case '1':
-        case '2':
-        case '3':
-        case '4':
-        case '5':
-        case '6':
-        case '7':
-        case '8':
-        case '9':
-        case '.':
-        case '_':
-            incomplete_input = false;
-            if ((last_token(inp_queue) == NUMBER_TOKEN ||
-                 (last_token(inp_queue) == OP_TOKEN && last_op(inp_queue) == CLOSING_PAREN_OP)) &&
-                sign != DEFAULOP) {
-                lex_queue_enqueue(inp_queue, (lexeme_type){.token = OP_TOKEN, .metadata = {.op = sign}});
-                sign = DEFAULOP;
-            } else if (last_token(inp_queue) == NUMBER_TOKEN) {
-                error_msg = "Two numbers in a row.";
-                error_index = i;
-                goto on_inp_error;
-            }
-            if (last_token(inp_queue) == OP_TOKEN && last_op(inp_queue) == CLOSING_PAREN_OP) {
-                lex_queue_enqueue(inp_queue, (lexeme_type){.token = OP_TOKEN, .metadata = {.op = MUL_OP}});
-            }
-            if (str[i] == '_') {
-                lex_queue_enqueue(inp_queue, (lexeme_type){.token = NUMBER_TOKEN, .metadata = {.num = RTR_VALUE_LAST}});
-                continue;
-            }
-            i--;
-            double value = 0.;
-            while (i + 1 < len && isdigit(str[i + 1])) {
-                value = 10. * value + digit_to_num(str[i + 1]);
-                i++;
-            }
-            if (sign == SUB_OP) {
-                value = -value;
-            }
-            sign = DEFAULOP;
-            if (str[i + 1] == '.') {
-                if (i + 2 < len && !isdigit(str[i + 2])) {
-                    error_msg = "No digits after '.'.";
-                    error_index = i + 1;
-                    goto on_inp_error;
-                }
-                i++;
-                double c = 10.;
-                while (i + 1 < len && isdigit(str[i + 1])) {
-                    value = value + digit_to_num(str[i + 1]) / c;
-                    c *= 10.;
-                    i++;
-                }
-            }
-            lex_queue_enqueue(inp_queue, (lexeme_type){.token = NUMBER_TOKEN, .metadata = {.num = value}});
-            break;
-        case '(':
-        case ')':
-            opening_paren_count += (str[i] == '(');
-            closing_paren_count += (str[i] == ')');
-            if (opening_paren_count < closing_paren_count) {
-                error_msg = "Closed parenthesis before opening one.";
-                error_index = i;
-                goto on_inp_error;
-            }
-            if (str[i] == '(') {
-                incomplete_input = true;
-                error_index = i;
-                if (sign != DEFAULOP) {
-                    if (last_token(inp_queue) == NUMBER_TOKEN ||
-                        (last_token(inp_queue) == OP_TOKEN && last_op(inp_queue) == CLOSING_PAREN_OP)) {
-                        lex_queue_enqueue(inp_queue, (lexeme_type){.token = OP_TOKEN, .metadata = {.op = sign}});
-                    } else {
-                        lex_queue_enqueue(inp_queue, (lexeme_type){.token = NUMBER_TOKEN,
-                                                                   .metadata = {.num = -(sign == SUB_OP) + (sign == ADD_OP)}});
-                        lex_queue_enqueue(inp_queue, (lexeme_type){.token = OP_TOKEN, .metadata = {.op = MUL_OP}});
-                    }
-                    sign = DEFAULOP;
-                }
-                if (last_token(inp_queue) == NUMBER_TOKEN ||
-                    (last_token(inp_queue) == OP_TOKEN && last_op(inp_queue) == CLOSING_PAREN_OP)) {
-                    lex_queue_enqueue(inp_queue, (lexeme_type){.token = OP_TOKEN, .metadata = {.op = MUL_OP}});
-                }
-            } else if (incomplete_input) {
-                error_msg = "Incomplete input.";
-                goto on_inp_error;
-            }
-            lex_queue_enqueue(
-                inp_queue, (lexeme_type){.token = OP_TOKEN, .metadata = {.op = str[i] == '(' ? OPENING_PAREN_OP : CLOSING_PAREN_OP}});
-            break;
-        case ' ':
-        case '\n':
-        case '\0':
-            continue;
-        default:
-            error_msg = "Unknown character.";
-            error_index = i + 2;
-            goto on_inp_error;
+int main(int argc, char** argv) {
+    const char* batch_path = NULL;
+    const char* columns_expr = NULL;
+    size_t thread_count = 0;
+    int precision = -1; // shortest round-trip representation
+    eval_int_mode_type int_mode = EVAL_INT_MODE_AUTO;
+    size_t cache_capacity = 0;
+    bool print_cache_stats = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc) {
+            batch_path = argv[++i];
+        } else if (strcmp(argv[i], "--columns") == 0 && i + 1 < argc) {
+            columns_expr = argv[++i];
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            thread_count = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--precision") == 0 && i + 1 < argc) {
+            precision = (int)strtol(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--int") == 0) {
+            int_mode = EVAL_INT_MODE_FORCE;
+        } else if (strcmp(argv[i], "--no-int") == 0) {
+            int_mode = EVAL_INT_MODE_OFF;
+        } else if (strcmp(argv[i], "--cache") == 0 && i + 1 < argc) {
+            cache_capacity = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--cache-stats") == 0) {
+            print_cache_stats = true;
+        } else {
+            print_usage(argv[0]);
+            return 1;
         }
     }
 
-    if (incomplete_input) {
-        error_msg = "Incomplete input.";
-        error_index = len - 2;
-        goto on_inp_error;
-    }
-
-    if (opening_paren_count != closing_paren_count) {
-        error_msg = "Not all open parenthesis are closed.";
-        error_index = len - 2;
-        goto on_inp_error;
+    if (columns_expr != NULL) {
+        return columns_eval_stream(columns_expr, stdin, precision) ? 0 : 1;
     }
-
-#ifdef DEBUG
-    {
-        size_t index;
-        lexeme_type lex;
-        printf("Input queue (prefix): ");
-        fqueue_for_each(inp_queue, index, lex) {
-            switch (lex.token) {
-            case NUMBER_TOKEN:
-                printf(" %g", lex.metadata.num);
-                break;
-            case OP_TOKEN:
-                printf(" %c", decode_op(lex.metadata.op));
-                break;
-            default:
-                break;
-            }
+    if (batch_path != NULL) {
+        if (thread_count == 0) {
+            long n = sysconf(_SC_NPROCESSORS_ONLN);
+            thread_count = n > 0 ? (size_t)n : 1;
         }
-        putchar('\n');
-    }
-#endif
-
-    inp_queue_postfix = lex_queue_create(inp_queue->count);
-    if (!inp_queue_postfix) {
-        goto on_oom_error;
-    }
-    op_stack = lex_stack_create(inp_queue->count);
-    if (!op_stack) {
-        goto on_oom_error;
-    }
-
-    // shunting yard algorithm (with simplified assumptions).
-    {
-        size_t index;
-        lexeme_type lex;
-        fqueue_for_each(inp_queue, index, lex) {
-            switch (lex.token) {
-            case NUMBER_TOKEN:
-                lex_queue_enqueue(inp_queue_postfix, lex);
-                break;
-            case OP_TOKEN:
-                switch (lex.metadata.op) {
-                case OPENING_PAREN_OP:
-                    lex_stack_push(op_stack, lex);
-                    break;
-                case CLOSING_PAREN_OP:
-                    while (lex_stack_peek(op_stack).metadata.op != OPENING_PAREN_OP) {
-                        lex_queue_enqueue(inp_queue_postfix, lex_stack_pop(op_stack));
-                    }
-                    lex_stack_pop(op_stack);
-                    break;
-                default:
-                    while (!lex_stack_is_empty(op_stack) && lex_stack_peek(op_stack).metadata.op != OPENING_PAREN_OP &&
-                           op_precedence_cmp(lex_stack_peek(op_stack).metadata.op, lex.metadata.op) >= 0) {
-                        lex_queue_enqueue(inp_queue_postfix, lex_stack_pop(op_stack));
-                    }
-                    lex_stack_push(op_stack, lex);
-                    break;
-                }
-            default:
-                break;
-            }
-        }
-    }
-    while (!lex_stack_is_empty(op_stack)) {
-        lex_queue_enqueue(inp_queue_postfix, lex_stack_pop(op_stack));
-    }
-
-#ifdef DEBUG
-    {
-        size_t i;
-        lexeme_type lex;
-        printf("Input queue (postfix):");
-        fqueue_for_each(inp_queue_postfix, i, lex) {
-            switch (lex.token) {
-            case NUMBER_TOKEN:
-                printf(" %g", lex.metadata.num);
-                break;
-            case OP_TOKEN:
-                printf(" %c", decode_op(lex.metadata.op));
-                break;
-            default:
-                break;
-            }
-        }
-        putchar('\n');
-    }
-#endif
-
-    {
-        size_t i;
-        lexeme_type lex;
-        num_stack = op_stack; // repurposing the stack
-        fqueue_for_each(inp_queue_postfix, i, lex) {
-            switch (lex.token) {
-            case NUMBER_TOKEN:
-                lex_stack_push(num_stack, lex);
-                break;
-            case OP_TOKEN: {
-                double y = lex_stack_pop(num_stack).metadata.num;
-                double x = lex_stack_pop(num_stack).metadata.num;
-                switch (lex.metadata.op) {
-                case ADD_OP:
-                    lex_stack_push(num_stack, (lexeme_type){.metadata = {.num = x + y}});
-                    break;
-                case SUB_OP:
-                    lex_stack_push(num_stack, (lexeme_type){.metadata = {.num = x - y}});
-                    break;
-                case MUL_OP:
-                    lex_stack_push(num_stack, (lexeme_type){.metadata = {.num = x * y}});
-                    break;
-                case DIV_OP:
-                    lex_stack_push(num_stack, (lexeme_type){.metadata = {.num = x / y}});
-                    break;
-                case POW_OP:
-                    lex_stack_push(num_stack, (lexeme_type){.metadata = {.num = pow(x, y)}});
-                    break;
-                default:
-                    break;
-                }
-                break;
-            }
-            default:
-                break;
-            }
+        batch_options_type options = {.thread_count = thread_count,
+                                      .precision = precision,
+                                      .int_mode = int_mode,
+                                      .cache_capacity = cache_capacity,
+                                      .print_cache_stats = print_cache_stats};
+        return batch_eval_file(batch_path, &options) ? 0 : 1;
+    }
+
+    eval_state_type state;
+    eval_state_init(&state, true);
+    state.int_mode = int_mode;
+
+    eval_cache_type* cache_p = NULL;
+    if (cache_capacity > 0) {
+        cache_p = eval_cache_create(cache_capacity);
+        if (cache_p == NULL) {
+            fprintf(stderr, "%s\n", EVAL_OOM_ERROR_MSG);
+            return 1;
         }
     }
 
-    rtr_value = lex_stack_pop(num_stack).metadata.num;
-    RTR_VALUE_LAST = rtr_value;
-
-on_inp_error:
-    if (error_msg != NULL) {
-        fprintf(stderr, "%*c %s\n", (int)(error_index + 1), '^', error_msg);
-    }
-    if (op_stack != NULL) {
-        lex_stack_destroy(op_stack);
-    }
-    if (inp_queue_postfix != NULL) {
-        lex_queue_destroy(inp_queue_postfix);
-    }
-    if (inp_queue != NULL) {
-        lex_queue_destroy(inp_queue);
-    }
-    return rtr_value;
-
-on_oom_error:
-    fprintf(stderr, "Out of memory.\n");
-
-    if (op_stack != NULL) {
-        lex_stack_destroy(op_stack);
-    }
-    if (inp_queue_postfix != NULL) {
-        lex_queue_destroy(inp_queue_postfix);
-    }
-    if (inp_queue != NULL) {
-        lex_queue_destroy(inp_queue);
-    }
-
-    return rtr_value;
-}
-
-int main() {
     char* line_p = NULL;
     size_t n = 0;
     ssize_t len = 0;
 
     printf("Note:\nPress Ctrl+d to exit.\n\n");
-    printf("> ");
+    printf("%s", prompt);
 
     while (0 < (len = getline(&line_p, &n, stdin))) {
-        printf("%g\n", eval(line_p, len));
-        printf("> ");
+        double value = cache_p != NULL ? eval_cached(&state, cache_p, line_p, len) : eval(&state, line_p, len);
+        if (state.error_msg != NULL && state.error_index < 0) {
+            fprintf(stderr, "%s\n", state.error_msg);
+        } else if (state.error_msg != NULL) {
+            // under the offending character, after the prompt
+            fprintf(stderr, "%*c %s\n", (int)(state.error_index + 1 + prompt_len), '^', state.error_msg);
+        }
+        char buf[FORMAT_NUMBER_MAX_LEN + 1];
+        size_t buf_len = state.error_msg == NULL && state.last_value_is_int && precision < 0
+                             ? format_integer(state.last_int_value, buf)
+                             : format_number(value, precision, buf);
+        buf[buf_len++] = '\n';
+        fwrite(buf, 1, buf_len, stdout);
+        printf("%s", prompt);
     }
     free(line_p);
+
+    if (cache_p != NULL && print_cache_stats) {
+        eval_cache_stats_type stats = eval_cache_stats(cache_p);
+        fprintf(stderr, "cache: %zu hits, %zu misses, %zu evictions\n", stats.hits, stats.misses, stats.evictions);
+    }
+    eval_cache_destroy(cache_p);
     return 0;
 }
@@ -0,0 +1,250 @@
+/*
+    decimal to double conversion.
+
+    most literals are converted with Clinger's fast path (an exact mantissa times an exact power of ten), and the
+    rest with the Eisel-Lemire algorithm, which multiplies the mantissa by a 128-bit approximation of the power of
+    ten and only needs to give up when the product lies too close to a halfway point. literals with more than 19
+    significant digits, and the rare cases Eisel-Lemire gives up on, fall back to `strtod`.
+
+    sources:
+    - https://arxiv.org/abs/2101.11408 (Daniel Lemire, Number Parsing at a Gigabyte per Second)
+    - https://github.com/fastfloat/fast_float
+*/
+
+#include <ctype.h>   // isxdigit
+#include <stdbool.h> // bool, true, false
+#include <stdint.h>  // uint64_t, int64_t
+#include <stdlib.h>  // strtod, malloc, free
+#include <string.h>  // memcpy
+
+#include "parse_number.h"
+#include "pow5_table.h" // pow5_table, POW5_TABLE_*
+
+__extension__ typedef unsigned __int128 uint128_type;
+
+#define MANTISSA_EXPLICIT_BITS 52
+#define MINIMUM_EXPONENT (-1023)
+#define INFINITE_POWER 0x7FF
+#define MAX_DIGITS 19 // digits that always fit in a uint64_t
+
+static const double exact_powers_of_ten[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                                             1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+static inline double bits_to_double(uint64_t bits) {
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// floor(log2(10^q)) + 63, valid for q in [-1500, 1500]
+static inline int32_t power(int32_t q) {
+    return (((152170 + 65536) * q) >> 16) + 63;
+}
+
+// compute w * 10^q correctly rounded. returns false if the result could not be determined.
+static bool eisel_lemire(uint64_t w, int64_t q, double* value_p) {
+    if (w == 0 || q < POW5_TABLE_SMALLEST_POWER) {
+        *value_p = 0.;
+        return true;
+    }
+    if (q > POW5_TABLE_LARGEST_POWER) {
+        *value_p = bits_to_double((uint64_t)INFINITE_POWER << MANTISSA_EXPLICIT_BITS);
+        return true;
+    }
+
+    int lz = __builtin_clzll(w);
+    w <<= lz;
+
+    size_t index = 2 * (size_t)(q - POW5_TABLE_SMALLEST_POWER);
+    uint128_type first_product = (uint128_type)w * pow5_table[index];
+    uint64_t upper = (uint64_t)(first_product >> 64);
+    uint64_t lower = (uint64_t)first_product;
+
+    // only 55 bits of the product are needed. if the bits below them are all ones, a carry from the next 64 bits of
+    // the power may still reach them.
+    const uint64_t precision_mask = UINT64_MAX >> (MANTISSA_EXPLICIT_BITS + 3);
+    if ((upper & precision_mask) == precision_mask) {
+        uint128_type second_product = (uint128_type)w * pow5_table[index + 1];
+        uint64_t second_upper = (uint64_t)(second_product >> 64);
+        lower += second_upper;
+        if (second_upper > lower) {
+            upper++;
+        }
+        if (lower == UINT64_MAX && (q < -27 || q > 55)) {
+            return false;
+        }
+    }
+
+    int upperbit = (int)(upper >> 63);
+    int shift = upperbit + 64 - MANTISSA_EXPLICIT_BITS - 3;
+    uint64_t mantissa = upper >> shift;
+    int32_t power2 = power((int32_t)q) + upperbit - lz - MINIMUM_EXPONENT;
+
+    if (power2 <= 0) {
+        // subnormal
+        if (-power2 + 1 >= 64) {
+            *value_p = 0.;
+            return true;
+        }
+        mantissa >>= -power2 + 1;
+        mantissa += (mantissa & 1);
+        mantissa >>= 1;
+        power2 = mantissa < ((uint64_t)1 << MANTISSA_EXPLICIT_BITS) ? 0 : 1;
+        *value_p = bits_to_double(mantissa | ((uint64_t)power2 << MANTISSA_EXPLICIT_BITS));
+        return true;
+    }
+
+    // exactly halfway between two doubles: round to even
+    if (lower <= 1 && q >= -4 && q <= 23 && (mantissa & 3) == 1) {
+        if ((mantissa << shift) == upper) {
+            mantissa &= ~(uint64_t)1;
+        }
+    }
+
+    mantissa += (mantissa & 1);
+    mantissa >>= 1;
+    if (mantissa >= ((uint64_t)2 << MANTISSA_EXPLICIT_BITS)) {
+        mantissa = (uint64_t)1 << MANTISSA_EXPLICIT_BITS;
+        power2++;
+    }
+    mantissa &= ~((uint64_t)1 << MANTISSA_EXPLICIT_BITS);
+    if (power2 >= INFINITE_POWER) {
+        power2 = INFINITE_POWER;
+        mantissa = 0;
+    }
+    *value_p = bits_to_double(mantissa | ((uint64_t)power2 << MANTISSA_EXPLICIT_BITS));
+    return true;
+}
+
+static double parse_number_fallback(const char* str, size_t len) {
+    char local_buf[64];
+    char* buf = len < sizeof(local_buf) ? local_buf : malloc(len + 1);
+    if (buf == NULL) {
+        return 0.;
+    }
+    memcpy(buf, str, len);
+    buf[len] = '\0';
+    double value = strtod(buf, NULL);
+    if (buf != local_buf) {
+        free(buf);
+    }
+    return value;
+}
+
+#define is_digit(c) ((unsigned char)((c) - '0') < 10)
+
+static inline unsigned hex_digit_to_num(char c) {
+    return is_digit(c) ? (unsigned)(c - '0') : (unsigned)((c | 0x20) - 'a' + 10);
+}
+
+size_t parse_number(const char* str, size_t len, double* value_p, const char** error_msg_pp) {
+    *error_msg_pp = NULL;
+    *value_p = 0.;
+
+    size_t i = 0;
+    uint64_t w = 0;
+    size_t digit_count = 0; // significant digits of w
+
+    if (len >= 2 && str[0] == '0' && (str[1] == 'x' || str[1] == 'X')) {
+        for (i = 2; i < len && isxdigit((unsigned char)str[i]); i++) {
+            unsigned d = hex_digit_to_num(str[i]);
+            if (w == 0 && d == 0) {
+                continue;
+            }
+            w = (w << 4) | d;
+            digit_count++;
+        }
+        if (i == 2) {
+            *error_msg_pp = "No digits after '0x'.";
+            return 1;
+        }
+        // beyond 16 digits, w has overflowed and rounding needs every digit
+        *value_p = digit_count <= 16 ? (double)w : parse_number_fallback(str, i);
+        return i;
+    }
+
+    int64_t q = 0;
+
+    // leading zeros are not significant
+    while (i < len && str[i] == '0') {
+        i++;
+    }
+    size_t digits_begin = i;
+    while (i < len && is_digit(str[i])) {
+        w = 10 * w + (uint64_t)(str[i] - '0');
+        i++;
+    }
+    digit_count = i - digits_begin;
+
+    if (i < len && str[i] == '.') {
+        size_t point_index = i++;
+        if (digit_count == 0) {
+            while (i < len && str[i] == '0') {
+                i++;
+            }
+        }
+        size_t fraction_begin = i;
+        while (i < len && is_digit(str[i])) {
+            w = 10 * w + (uint64_t)(str[i] - '0');
+            i++;
+        }
+        if (i == point_index + 1) {
+            *error_msg_pp = "No digits after '.'.";
+            return point_index;
+        }
+        digit_count += i - fraction_begin;
+        q -= (int64_t)(i - point_index - 1);
+    }
+    if (i < len && (str[i] == 'e' || str[i] == 'E')) {
+        // an 'e' after the digits always starts an exponent, so it needs digits, after at most one sign
+        size_t j = i + 1;
+        bool negative = false;
+        if (j < len && (str[j] == '+' || str[j] == '-')) {
+            negative = str[j] == '-';
+            j++;
+        }
+        if (j == len || !is_digit(str[j])) {
+            *error_msg_pp = "No digits in exponent.";
+            return i;
+        }
+        int64_t e = 0;
+        for (; j < len && is_digit(str[j]); j++) {
+            if (e < 100000) {
+                e = 10 * e + (str[j] - '0');
+            }
+        }
+        q += negative ? -e : e;
+        i = j;
+    }
+
+    if (digit_count > MAX_DIGITS) {
+        // w has overflowed
+        *value_p = parse_number_fallback(str, i);
+    } else if (w <= ((uint64_t)1 << 53) && q >= -22 && q <= 22) {
+        *value_p = q < 0 ? (double)w / exact_powers_of_ten[-q] : (double)w * exact_powers_of_ten[q];
+    } else if (!eisel_lemire(w, q, value_p)) {
+        *value_p = parse_number_fallback(str, i);
+    }
+    return i;
+}
+
+bool parse_integer(const char* str, size_t len, int64_t* value_p) {
+    int64_t value = 0;
+    if (len > 2 && str[0] == '0' && (str[1] == 'x' || str[1] == 'X')) {
+        for (size_t i = 2; i < len; i++) {
+            if (!isxdigit((unsigned char)str[i]) || value > (INT64_MAX >> 4)) {
+                return false;
+            }
+            value = (value << 4) | hex_digit_to_num(str[i]);
+        }
+    } else {
+        for (size_t i = 0; i < len; i++) {
+            if (!is_digit(str[i]) || __builtin_mul_overflow(value, 10, &value) ||
+                __builtin_add_overflow(value, str[i] - '0', &value)) {
+                return false;
+            }
+        }
+    }
+    *value_p = value;
+    return len > 0;
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <stdbool.h> // bool
+#include <stddef.h>  // size_t
+#include <stdint.h>  // int64_t
+
+// parse the number literal at the start of `str`: a decimal with optional fraction and exponent (`1.5e-3`), or a
+// hexadecimal integer (`0x1F`). the result is correctly rounded.
+//
+// returns the number of characters read. on malformed input `*error_msg_pp` is set and the offset of the offending
+// character is returned instead.
+size_t parse_number(const char* str, size_t len, double* value_p, const char** error_msg_pp);
+
+// parse `str[0..len)` exactly as a decimal or hexadecimal integer literal. returns false if it is not one or does not fit
+// in an int64_t.
+bool parse_integer(const char* str, size_t len, int64_t* value_p);
@@ -0,0 +1,105 @@
+/*
+    bump allocator conforming to allocator function types.
+
+    memory is handed out from a list of blocks, and is only returned all at once by `arena_allocator_release`. the last
+    allocation can be grown in place or rolled back. pass NULL as the deallocate function to a `strmap`, so the map does
+    not walk its nodes to free them.
+*/
+
+#pragma once
+
+#include <stdalign.h> // alignas
+#include <stddef.h>   // max_align_t
+#include <stdint.h>   // uintptr_t, SIZE_MAX
+#include <stdlib.h>   // malloc, free, size_t
+#include <string.h>   // memcpy
+
+#define ARENA_ALLOCATOR_DEFAULT_BLOCK_SIZE (1 << 16)
+
+typedef struct arena_allocator_block_type {
+    struct arena_allocator_block_type* prev_p;
+    size_t size;
+    size_t used;
+    alignas(max_align_t) unsigned char data[];
+} arena_allocator_block_type;
+
+typedef struct {
+    arena_allocator_block_type* block_p; // current block, linked to the previous ones
+    size_t block_size;
+    void* last_p; // last allocation, which may be grown in place or rolled back
+} arena_allocator_type;
+
+static inline void arena_allocator_init(arena_allocator_type* arena_p, size_t block_size) {
+    *arena_p = (arena_allocator_type){.block_p = NULL, .block_size = block_size, .last_p = NULL};
+}
+
+static inline void arena_allocator_release(arena_allocator_type* arena_p) {
+    arena_allocator_block_type* block_p = arena_p->block_p;
+    while (block_p != NULL) {
+        arena_allocator_block_type* prev_p = block_p->prev_p;
+        free(block_p);
+        block_p = prev_p;
+    }
+    arena_p->block_p = NULL;
+    arena_p->last_p = NULL;
+}
+
+static inline void* arena_allocate(void* allocator_struct_p, size_t alignment, size_t size) {
+    arena_allocator_type* arena_p = allocator_struct_p;
+    arena_allocator_block_type* block_p = arena_p->block_p;
+
+    if (block_p != NULL) {
+        uintptr_t begin = (uintptr_t)&block_p->data[block_p->used];
+        size_t padding = (alignment - (begin & (alignment - 1))) & (alignment - 1);
+        if (padding + size <= block_p->size - block_p->used) {
+            block_p->used += padding + size;
+            arena_p->last_p = (void*)(begin + padding);
+            return arena_p->last_p;
+        }
+    }
+
+    // start a new block. data is aligned to max_align_t, so no padding is needed.
+    size_t block_size = size > arena_p->block_size ? size : arena_p->block_size;
+    if (block_size > SIZE_MAX - sizeof(arena_allocator_block_type)) {
+        return NULL;
+    }
+    block_p = malloc(sizeof(arena_allocator_block_type) + block_size);
+    if (block_p == NULL) {
+        return NULL;
+    }
+    block_p->prev_p = arena_p->block_p;
+    block_p->size = block_size;
+    block_p->used = size;
+    arena_p->block_p = block_p;
+    arena_p->last_p = block_p->data;
+    return arena_p->last_p;
+}
+
+static inline void* arena_reallocate(void* allocator_struct_p, void* ptr, size_t alignment, size_t old_size, size_t new_size) {
+    arena_allocator_type* arena_p = allocator_struct_p;
+    arena_allocator_block_type* block_p = arena_p->block_p;
+
+    // grow or shrink the last allocation in place
+    if (ptr != NULL && ptr == arena_p->last_p) {
+        size_t offset = (size_t)((unsigned char*)ptr - block_p->data);
+        if (new_size <= block_p->size - offset) {
+            block_p->used = offset + new_size;
+            return ptr;
+        }
+    }
+    void* new_ptr = arena_allocate(allocator_struct_p, alignment, new_size);
+    if (new_ptr != NULL && ptr != NULL) {
+        memcpy(new_ptr, ptr, old_size < new_size ? old_size : new_size);
+    }
+    return new_ptr;
+}
+
+static inline void arena_deallocate(void* allocator_struct_p, void* ptr) {
+    arena_allocator_type* arena_p = allocator_struct_p;
+
+    // only the last allocation can be given back
+    if (ptr != NULL && ptr == arena_p->last_p) {
+        arena_p->block_p->used = (size_t)((unsigned char*)ptr - arena_p->block_p->data);
+        arena_p->last_p = NULL;
+    }
+}
@@ -0,0 +1,189 @@
+/*
+    stress strmap_concurrent with writers and readers sharing one map.
+
+    usage: ./check_concurrent [WRITERS [READERS [WRITES [KEYS]]]]
+
+    WRITERS threads (default 3) each do WRITES random sets and deletes (default 200000) of KEYS keys (default 20000), so
+    values are replaced and removed nodes are retired all the time, and with many keys the table grows. READERS threads
+    (default 3) look keys up while that happens, and hold on to the values they read while they yield, before checking
+    that each still belongs to its key. a value freed too early then shows up as a wrong value, or as a use after free
+    under ASan. few keys make that likely: readers then often hold the very node a writer replaces. once the writers are
+    done, the count is checked against a lookup of every key.
+
+    build it with `make check` for ASan/UBSan and with `make check-tsan` for TSan.
+*/
+
+#include <pthread.h>   // pthread_*
+#include <sched.h>     // sched_yield
+#include <stdatomic.h> // _Atomic
+#include <stdbool.h>   // bool, true, false
+#include <stdio.h>     // printf, fprintf, snprintf
+#include <stdlib.h>    // rand_r, strtoul
+#include <string.h>    // strncmp, strlen
+
+#include "strmap_concurrent.h"
+
+#define THREADS_MAX 64
+#define HELD_MAX 64 // values a reader holds before checking them
+#define KEY_LEN_MAX 32
+
+typedef struct {
+    strmap_concurrent_type* map_p;
+    unsigned seed;
+    size_t write_count;
+    unsigned key_count;
+    _Atomic bool* done_p;
+    size_t hit_count;
+    bool failed;
+} worker_type;
+
+static void make_key(char* key_p, unsigned x) {
+    snprintf(key_p, KEY_LEN_MAX, "k%u", x);
+}
+
+// values are the key, a ':' and the number of the write.
+static bool value_matches(const char* key_p, const char* value_p) {
+    size_t key_len = strlen(key_p);
+    return strncmp(value_p, key_p, key_len) == 0 && value_p[key_len] == ':';
+}
+
+static void* writer(void* arg_p) {
+    worker_type* worker_p = arg_p;
+    strmap_concurrent_thread_type* thread_p = strmap_concurrent_thread_register(worker_p->map_p);
+    if (thread_p == NULL) {
+        worker_p->failed = true;
+        return NULL;
+    }
+    char key[KEY_LEN_MAX];
+    char value[2 * KEY_LEN_MAX];
+    for (size_t i = 0; i < worker_p->write_count; i++) {
+        unsigned x = (unsigned)rand_r(&worker_p->seed) % worker_p->key_count;
+        make_key(key, x);
+        if (rand_r(&worker_p->seed) % 3 != 0) {
+            snprintf(value, sizeof(value), "%s:%zu", key, i);
+            if (!strmap_concurrent_set(thread_p, key, value)) {
+                fprintf(stderr, "out of memory\n");
+                worker_p->failed = true;
+                break;
+            }
+        } else {
+            strmap_concurrent_del(thread_p, key);
+        }
+    }
+    strmap_concurrent_thread_unregister(thread_p);
+    return NULL;
+}
+
+static void* reader(void* arg_p) {
+    worker_type* worker_p = arg_p;
+    strmap_concurrent_thread_type* thread_p = strmap_concurrent_thread_register(worker_p->map_p);
+    if (thread_p == NULL) {
+        worker_p->failed = true;
+        return NULL;
+    }
+    char keys[HELD_MAX][KEY_LEN_MAX];
+    const char* values_p[HELD_MAX];
+    while (!worker_p->failed && !*worker_p->done_p) {
+        strmap_concurrent_enter(thread_p);
+        for (size_t i = 0; i < HELD_MAX; i++) {
+            make_key(keys[i], (unsigned)rand_r(&worker_p->seed) % worker_p->key_count);
+            values_p[i] = strmap_concurrent_get(thread_p, keys[i]);
+        }
+        // let the writers retire what was read, and try to free it
+        sched_yield();
+        for (size_t i = 0; i < HELD_MAX; i++) {
+            if (values_p[i] == NULL) {
+                continue;
+            }
+            worker_p->hit_count++;
+            if (!value_matches(keys[i], values_p[i])) {
+                fprintf(stderr, "wrong value for %s\n", keys[i]);
+                worker_p->failed = true;
+                break;
+            }
+        }
+        strmap_concurrent_leave(thread_p);
+    }
+    strmap_concurrent_thread_unregister(thread_p);
+    return NULL;
+}
+
+// every key present must have a matching value, and their number must be the count.
+static bool check_final(strmap_concurrent_type* map_p, unsigned key_count) {
+    strmap_concurrent_thread_type* thread_p = strmap_concurrent_thread_register(map_p);
+    if (thread_p == NULL) {
+        return false;
+    }
+    bool res = true;
+    size_t count = 0;
+    char key[KEY_LEN_MAX];
+    strmap_concurrent_enter(thread_p);
+    for (unsigned x = 0; x < key_count; x++) {
+        make_key(key, x);
+        const char* value_p = strmap_concurrent_get(thread_p, key);
+        if (value_p == NULL) {
+            continue;
+        }
+        count++;
+        if (!value_matches(key, value_p)) {
+            fprintf(stderr, "wrong value for %s\n", key);
+            res = false;
+        }
+    }
+    strmap_concurrent_leave(thread_p);
+    strmap_concurrent_thread_unregister(thread_p);
+    if (count != strmap_concurrent_get_count(map_p)) {
+        fprintf(stderr, "%zu keys found, but the count is %zu\n", count, strmap_concurrent_get_count(map_p));
+        res = false;
+    }
+    return res;
+}
+
+int main(int argc, char** argv) {
+    size_t writer_count = argc > 1 ? strtoul(argv[1], NULL, 10) : 3;
+    size_t reader_count = argc > 2 ? strtoul(argv[2], NULL, 10) : 3;
+    size_t write_count = argc > 3 ? strtoul(argv[3], NULL, 10) : 200000;
+    unsigned key_count = argc > 4 ? (unsigned)strtoul(argv[4], NULL, 10) : 20000;
+    if (writer_count + reader_count > THREADS_MAX || key_count == 0) {
+        fprintf(stderr, "at most %d threads and at least one key\n", THREADS_MAX);
+        return 1;
+    }
+
+    strmap_concurrent_type* map_p = strmap_concurrent_create();
+    if (map_p == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    _Atomic bool done = false;
+    worker_type workers[THREADS_MAX];
+    pthread_t threads[THREADS_MAX];
+    size_t started = 0;
+    for (size_t i = 0; i < writer_count + reader_count; i++) {
+        workers[i] = (worker_type){
+            .map_p = map_p, .seed = (unsigned)(2 * i + 1), .write_count = write_count, .key_count = key_count, .done_p = &done};
+        bool is_writer = i >= reader_count;
+        if (pthread_create(&threads[i], NULL, is_writer ? writer : reader, &workers[i]) != 0) {
+            break;
+        }
+        started++;
+    }
+    for (size_t i = reader_count; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    done = true;
+    for (size_t i = 0; i < started && i < reader_count; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    bool res = started == writer_count + reader_count;
+    size_t hit_count = 0;
+    for (size_t i = 0; i < started; i++) {
+        res = res && !workers[i].failed;
+        hit_count += workers[i].hit_count;
+    }
+    res = res && check_final(map_p, key_count);
+    printf("%s: %zu writers, %zu readers, %u keys, %zu values read, %zu keys left\n", res ? "ok" : "failed", writer_count,
+           reader_count, key_count, hit_count, strmap_concurrent_get_count(map_p));
+    strmap_concurrent_destroy(map_p);
+    return res ? 0 : 1;
+}
@@ -0,0 +1,167 @@
+#include <fcntl.h>   // open, O_RDONLY
+#include <stdbool.h> // bool, true, false
+#include <stdint.h>  // uint32_t
+#include <string.h>  // memchr, memmove
+
+#include <sys/mman.h> // mmap, munmap, madvise
+#include <sys/stat.h> // fstat
+#include <unistd.h>   // close, sysconf
+
+#if defined(__SSE2__)
+#include <emmintrin.h> // _mm_*
+#endif
+
+#include "csv.h"
+
+bool csv_reader_open(csv_reader_type* reader_p, const char* path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return false;
+    }
+    size_t size = (size_t)st.st_size;
+    size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+
+    // reserve one byte more than the file, so the last field can be null terminated too. past the end of the file,
+    // its last page reads as zeros, and any further page is anonymous memory.
+    size_t map_size = (size + 1 + page_size - 1) / page_size * page_size;
+    char* data_p = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (data_p == MAP_FAILED) {
+        close(fd);
+        return false;
+    }
+    if (size > 0 && mmap(data_p, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        munmap(data_p, map_size);
+        close(fd);
+        return false;
+    }
+    close(fd);
+    madvise(data_p, map_size, MADV_SEQUENTIAL);
+
+    *reader_p = (csv_reader_type){.data_p = data_p, .size = size, .map_size = map_size, .pos = 0};
+    return true;
+}
+
+void csv_reader_close(csv_reader_type* reader_p) {
+    munmap(reader_p->data_p, reader_p->map_size);
+    *reader_p = (csv_reader_type){0};
+}
+
+static inline bool csv_is_special(char c) {
+    return c == ',' || c == '"' || c == '\n' || c == '\r';
+}
+
+// first delimiter, quote or line break from `p` on, or `end_p`.
+static inline char* csv_find_special(char* p, char* end_p) {
+#if defined(__SSE2__)
+    const __m128i comma = _mm_set1_epi8(',');
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i lf = _mm_set1_epi8('\n');
+    const __m128i cr = _mm_set1_epi8('\r');
+    while (end_p - p >= 16) {
+        __m128i chunk = _mm_loadu_si128((const __m128i*)p);
+        __m128i eq = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, comma), _mm_cmpeq_epi8(chunk, quote)),
+                                  _mm_or_si128(_mm_cmpeq_epi8(chunk, lf), _mm_cmpeq_epi8(chunk, cr)));
+        uint32_t mask = (uint32_t)_mm_movemask_epi8(eq);
+        if (mask != 0) {
+            return p + __builtin_ctz(mask);
+        }
+        p += 16;
+    }
+#endif
+    while (p < end_p && !csv_is_special(*p)) {
+        p++;
+    }
+    return p;
+}
+
+// move `len` bytes from `p` to `out_p`, which is not after it. nothing moves until a field has unescaped a quote.
+static inline char* csv_shift(char* out_p, const char* p, size_t len) {
+    if (out_p != p) {
+        memmove(out_p, p, len);
+    }
+    return out_p + len;
+}
+
+bool csv_reader_next(csv_reader_type* reader_p, csv_field_type* fields_p, size_t field_max, size_t* field_count_p) {
+    char* p = &reader_p->data_p[reader_p->pos];
+    char* end_p = &reader_p->data_p[reader_p->size];
+    if (p >= end_p) {
+        return false;
+    }
+    size_t field_count = 0;
+
+    // an empty line is a record without fields
+    if (*p == '\r' && p + 1 < end_p && p[1] == '\n') {
+        reader_p->pos += 2;
+        *field_count_p = 0;
+        return true;
+    }
+    if (*p == '\r' || *p == '\n') {
+        reader_p->pos += 1;
+        *field_count_p = 0;
+        return true;
+    }
+    while (true) {
+        char* begin_p = p;
+        char* out_p = p;
+
+        // a quote only starts a quoted part at the beginning of the field. elsewhere it is taken as is.
+        bool quoted = p < end_p && *p == '"';
+        if (quoted) {
+            p++;
+        }
+        while (true) {
+            if (quoted) {
+                char* quote_p = memchr(p, '"', (size_t)(end_p - p));
+                if (quote_p == NULL) {
+                    // unterminated, so the field runs to the end of the input
+                    out_p = csv_shift(out_p, p, (size_t)(end_p - p));
+                    p = end_p;
+                    break;
+                }
+                out_p = csv_shift(out_p, p, (size_t)(quote_p - p));
+                p = quote_p + 1;
+                if (p < end_p && *p == '"') {
+                    *out_p++ = '"';
+                    p++;
+                } else {
+                    quoted = false;
+                }
+            } else {
+                char* special_p = csv_find_special(p, end_p);
+                out_p = csv_shift(out_p, p, (size_t)(special_p - p));
+                p = special_p;
+                if (p == end_p || *p != '"') {
+                    break;
+                }
+                *out_p++ = '"';
+                p++;
+            }
+        }
+        char terminator = p < end_p ? *p : '\0';
+        *out_p = '\0';
+        if (field_count < field_max) {
+            fields_p[field_count] = (csv_field_type){.str_p = begin_p, .len = (size_t)(out_p - begin_p)};
+        }
+        field_count++;
+
+        if (terminator == ',') {
+            p++;
+            continue;
+        }
+        if (terminator == '\r' && p + 1 < end_p && p[1] == '\n') {
+            p += 2;
+        } else if (terminator == '\r' || terminator == '\n') {
+            p++;
+        }
+        break;
+    }
+    reader_p->pos = (size_t)(p - reader_p->data_p);
+    *field_count_p = field_count;
+    return true;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <stdbool.h> // bool
+#include <stddef.h>  // size_t
+
+// streaming RFC 4180 reader over a file mapped copy-on-write.
+//
+// fields are returned as slices of the mapping, so no line buffer limits their length and nothing is copied. quoted
+// fields may hold delimiters, newlines and escaped quotes (""), which are unescaped in place. every field is null
+// terminated in place as well, over the delimiter that ended it, and stays valid until the reader is closed. the file
+// itself is never written to.
+typedef struct {
+    char* data_p;
+    size_t size;
+    size_t map_size;
+    size_t pos;
+} csv_reader_type;
+
+typedef struct {
+    char* str_p; // null-terminated
+    size_t len;
+} csv_field_type;
+
+bool csv_reader_open(csv_reader_type* reader_p, const char* path);
+
+void csv_reader_close(csv_reader_type* reader_p);
+
+// read the next record, with lines ending in \n or \r\n. an empty line has no fields. the first `field_max` fields are
+// stored, and the number of fields in the record is set in `field_count_p`. returns false at the end of the input.
+bool csv_reader_next(csv_reader_type* reader_p, csv_field_type* fields_p, size_t field_max, size_t* field_count_p);
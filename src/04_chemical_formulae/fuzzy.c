@@ -0,0 +1,246 @@
+#include <stdbool.h> // bool, true, false
+#include <stdint.h>  // int64_t, uint64_t
+#include <stdlib.h>  // malloc, calloc, free, size_t
+#include <string.h>  // strlen
+
+#include "fuzzy.h"
+
+#define abs_diff(x, y) ((x) >= (y) ? (x) - (y) : (y) - (x))
+
+#define HIGH_BIT ((uint64_t)1 << 63)
+
+bool fuzzy_pattern_init(fuzzy_pattern_type* pattern_p, const char* query_p) {
+    pattern_p->len = strlen(query_p);
+    pattern_p->word_count = (pattern_p->len + 63) / 64;
+    pattern_p->masks_p = calloc(256 * (pattern_p->word_count > 0 ? pattern_p->word_count : 1), sizeof(uint64_t));
+    if (pattern_p->masks_p == NULL) {
+        return false;
+    }
+    for (size_t i = 0; i < pattern_p->len; i++) {
+        pattern_p->masks_p[(unsigned char)query_p[i] * pattern_p->word_count + i / 64] |= (uint64_t)1 << (i % 64);
+    }
+    return true;
+}
+
+void fuzzy_pattern_destroy(fuzzy_pattern_type* pattern_p) {
+    free(pattern_p->masks_p);
+    pattern_p->masks_p = NULL;
+}
+
+static inline const uint64_t* pattern_masks(const fuzzy_pattern_type* pattern_p, char c) {
+    return &pattern_p->masks_p[(unsigned char)c * pattern_p->word_count];
+}
+
+// the bits of the last word that belong to the query
+static inline uint64_t last_word_mask(size_t len) {
+    return len % 64 == 0 ? ~(uint64_t)0 : ((uint64_t)1 << (len % 64)) - 1;
+}
+
+// Allison-Dix / Hyyrö: a 0 bit in V marks a row where the LCS grows. every character of `str` advances all rows at
+// once, with the carry of the addition rippling through the words.
+size_t fuzzy_lcs(const fuzzy_pattern_type* pattern_p, const char* str, size_t len, uint64_t* scratch_p) {
+    size_t word_count = pattern_p->word_count;
+    if (word_count == 0) {
+        return 0;
+    }
+
+    if (word_count == 1) {
+        uint64_t v = ~(uint64_t)0;
+        for (size_t j = 0; j < len; j++) {
+            uint64_t u = v & pattern_p->masks_p[(unsigned char)str[j]];
+            v = (v + u) | (v - u);
+        }
+        return (size_t)__builtin_popcountll(~v & last_word_mask(pattern_p->len));
+    }
+
+    uint64_t* v_p = scratch_p;
+    for (size_t w = 0; w < word_count; w++) {
+        v_p[w] = ~(uint64_t)0;
+    }
+    for (size_t j = 0; j < len; j++) {
+        const uint64_t* masks_p = pattern_masks(pattern_p, str[j]);
+        uint64_t carry = 0;
+        for (size_t w = 0; w < word_count; w++) {
+            uint64_t u = v_p[w] & masks_p[w];
+            uint64_t sum = v_p[w] + carry;
+            carry = sum < carry;
+            sum += u;
+            carry |= sum < u;
+            v_p[w] = sum | (v_p[w] - u);
+        }
+    }
+    size_t lcs = 0;
+    for (size_t w = 0; w + 1 < word_count; w++) {
+        lcs += (size_t)__builtin_popcountll(~v_p[w]);
+    }
+    return lcs + (size_t)__builtin_popcountll(~v_p[word_count - 1] & last_word_mask(pattern_p->len));
+}
+
+// one column step of Myers' algorithm for a 64-row block. `h_in` is the difference along the top edge of the block,
+// and the difference along its edge at `high_bit` is returned.
+// https://doi.org/10.1145/316542.316550, blocks as in edlib
+static inline int myers_advance_block(uint64_t* pv_p, uint64_t* mv_p, uint64_t eq, int h_in, uint64_t high_bit) {
+    uint64_t pv = *pv_p;
+    uint64_t mv = *mv_p;
+    uint64_t xv = eq | mv;
+    if (h_in < 0) {
+        eq |= 1;
+    }
+    uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+    uint64_t ph = mv | ~(xh | pv);
+    uint64_t mh = pv & xh;
+
+    int h_out = (ph & high_bit) != 0 ? 1 : (mh & high_bit) != 0 ? -1 : 0;
+
+    ph <<= 1;
+    mh <<= 1;
+    if (h_in < 0) {
+        mh |= 1;
+    } else if (h_in > 0) {
+        ph |= 1;
+    }
+    *pv_p = mh | ~(xv | ph);
+    *mv_p = ph & xv;
+    return h_out;
+}
+
+size_t fuzzy_levenshtein(const fuzzy_pattern_type* pattern_p, const char* str, size_t len, uint64_t* scratch_p) {
+    size_t word_count = pattern_p->word_count;
+    if (word_count == 0) {
+        return len;
+    }
+    size_t distance = pattern_p->len;
+    uint64_t last_bit = (uint64_t)1 << ((pattern_p->len - 1) % 64);
+
+    if (word_count == 1) {
+        uint64_t pv = ~(uint64_t)0;
+        uint64_t mv = 0;
+        for (size_t j = 0; j < len; j++) {
+            // the first row is the distance to the empty prefix, growing by one per character
+            distance += myers_advance_block(&pv, &mv, pattern_p->masks_p[(unsigned char)str[j]], 1, last_bit);
+        }
+        return distance;
+    }
+
+    uint64_t* pv_p = scratch_p;
+    uint64_t* mv_p = scratch_p + word_count;
+    for (size_t w = 0; w < word_count; w++) {
+        pv_p[w] = ~(uint64_t)0;
+        mv_p[w] = 0;
+    }
+    for (size_t j = 0; j < len; j++) {
+        const uint64_t* masks_p = pattern_masks(pattern_p, str[j]);
+        int h = 1;
+        for (size_t w = 0; w + 1 < word_count; w++) {
+            h = myers_advance_block(&pv_p[w], &mv_p[w], masks_p[w], h, HIGH_BIT);
+        }
+        distance += myers_advance_block(&pv_p[word_count - 1], &mv_p[word_count - 1], masks_p[word_count - 1], h, last_bit);
+    }
+    return distance;
+}
+
+bool fuzzy_is_better(const fuzzy_match_type* a_p, const fuzzy_match_type* b_p) {
+    return a_p->score != b_p->score ? a_p->score > b_p->score : a_p->len_diff < b_p->len_diff;
+}
+
+static inline void swap(fuzzy_match_type* a_p, fuzzy_match_type* b_p) {
+    fuzzy_match_type tmp = *a_p;
+    *a_p = *b_p;
+    *b_p = tmp;
+}
+
+// the heap keeps the worst match at the root, so it is the one replaced by a better key.
+static void heap_sift_up(fuzzy_match_type* heap_p, size_t index) {
+    while (index > 0) {
+        size_t parent = (index - 1) / 2;
+        if (!fuzzy_is_better(&heap_p[parent], &heap_p[index])) {
+            break;
+        }
+        swap(&heap_p[parent], &heap_p[index]);
+        index = parent;
+    }
+}
+
+static void heap_sift_down(fuzzy_match_type* heap_p, size_t size, size_t index) {
+    while (true) {
+        size_t worst = index;
+        size_t left = 2 * index + 1;
+        size_t right = left + 1;
+        if (left < size && fuzzy_is_better(&heap_p[worst], &heap_p[left])) {
+            worst = left;
+        }
+        if (right < size && fuzzy_is_better(&heap_p[worst], &heap_p[right])) {
+            worst = right;
+        }
+        if (worst == index) {
+            break;
+        }
+        swap(&heap_p[index], &heap_p[worst]);
+        index = worst;
+    }
+}
+
+int64_t fuzzy_score(fuzzy_metric_type metric, const fuzzy_pattern_type* pattern_p, const char* str, size_t len,
+                    uint64_t* scratch_p) {
+    switch (metric) {
+    case FUZZY_METRIC_LCS:
+        return (int64_t)fuzzy_lcs(pattern_p, str, len, scratch_p);
+    case FUZZY_METRIC_LEVENSHTEIN:
+        return -(int64_t)fuzzy_levenshtein(pattern_p, str, len, scratch_p);
+    }
+    return 0;
+}
+
+void fuzzy_top_k_push(fuzzy_match_type* heap_p, size_t* size_p, size_t k, const fuzzy_match_type* match_p) {
+    if (*size_p < k) {
+        heap_p[*size_p] = *match_p;
+        heap_sift_up(heap_p, (*size_p)++);
+    } else if (k > 0 && fuzzy_is_better(match_p, &heap_p[0])) {
+        heap_p[0] = *match_p;
+        heap_sift_down(heap_p, *size_p, 0);
+    }
+}
+
+void fuzzy_top_k_sort(fuzzy_match_type* heap_p, size_t size) {
+    // move the worst remaining match to the back until the heap is empty, so the best match ends up first
+    for (size_t end = size; end > 1; end--) {
+        swap(&heap_p[0], &heap_p[end - 1]);
+        heap_sift_down(heap_p, end - 1, 0);
+    }
+}
+
+void fuzzy_top_k_scan(const fuzzy_pattern_type* pattern_p, fuzzy_metric_type metric, const char* const* keys_pp,
+                      size_t count, size_t k, fuzzy_match_type* heap_p, size_t* size_p, uint64_t* scratch_p) {
+    for (size_t i = 0; i < count; i++) {
+        size_t m = strlen(keys_pp[i]);
+        fuzzy_match_type match = {
+            .key_p = keys_pp[i],
+            .score = fuzzy_score(metric, pattern_p, keys_pp[i], m, scratch_p),
+            .len_diff = abs_diff(m, pattern_p->len),
+        };
+        fuzzy_top_k_push(heap_p, size_p, k, &match);
+    }
+}
+
+bool fuzzy_top_k(const char* query_p, fuzzy_metric_type metric, const char* const* keys_pp, size_t count, size_t k,
+                 fuzzy_match_type* matches_p, size_t* match_count_p) {
+    fuzzy_pattern_type pattern;
+    if (!fuzzy_pattern_init(&pattern, query_p)) {
+        return false;
+    }
+    uint64_t* scratch_p = malloc(sizeof(uint64_t) * (fuzzy_scratch_words(&pattern) + 1));
+    if (scratch_p == NULL) {
+        fuzzy_pattern_destroy(&pattern);
+        return false;
+    }
+
+    size_t size = 0;
+    fuzzy_top_k_scan(&pattern, metric, keys_pp, count, k, matches_p, &size, scratch_p);
+    free(scratch_p);
+    fuzzy_pattern_destroy(&pattern);
+
+    fuzzy_top_k_sort(matches_p, size);
+    *match_count_p = size;
+
+    return true;
+}
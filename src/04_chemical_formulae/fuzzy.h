@@ -0,0 +1,60 @@
+#pragma once
+
+#include <stdbool.h> // bool
+#include <stddef.h>  // size_t
+#include <stdint.h>  // int64_t, uint64_t
+
+typedef enum {
+    FUZZY_METRIC_LCS,         // longest common subsequence, higher is more similar
+    FUZZY_METRIC_LEVENSHTEIN, // edit distance, lower is more similar
+} fuzzy_metric_type;
+
+// a query prepared for the bit-parallel kernels. bit i of word w of the mask of a character is set if the character
+// is at position 64 * w + i of the query. the masks are built once and reused for every key.
+typedef struct {
+    size_t len;
+    size_t word_count; // 64-bit words per mask
+    uint64_t* masks_p; // 256 masks of `word_count` words each, indexed by unsigned char
+} fuzzy_pattern_type;
+
+typedef struct {
+    const char* key_p;
+    int64_t score;   // higher is more similar: the LCS, or the negated edit distance
+    size_t len_diff; // difference in length to the query, breaking ties in score
+} fuzzy_match_type;
+
+bool fuzzy_pattern_init(fuzzy_pattern_type* pattern_p, const char* query_p);
+
+void fuzzy_pattern_destroy(fuzzy_pattern_type* pattern_p);
+
+// words of scratch needed by the kernels for queries longer than 64 characters.
+#define fuzzy_scratch_words(pattern_p) (2 * (pattern_p)->word_count)
+
+// length of the longest common subsequence of the query and `str`.
+size_t fuzzy_lcs(const fuzzy_pattern_type* pattern_p, const char* str, size_t len, uint64_t* scratch_p);
+
+// Levenshtein distance between the query and `str`.
+size_t fuzzy_levenshtein(const fuzzy_pattern_type* pattern_p, const char* str, size_t len, uint64_t* scratch_p);
+
+// the score of `str` against the query under `metric`.
+int64_t fuzzy_score(fuzzy_metric_type metric, const fuzzy_pattern_type* pattern_p, const char* str, size_t len,
+                    uint64_t* scratch_p);
+
+// whether `a_p` ranks before `b_p`: a higher score, or the same score and a smaller difference in length.
+bool fuzzy_is_better(const fuzzy_match_type* a_p, const fuzzy_match_type* b_p);
+
+// add a match to a heap of at most `k` matches, currently holding `*size_p`. the root is the worst match kept, so it
+// is the one replaced by a better match.
+void fuzzy_top_k_push(fuzzy_match_type* heap_p, size_t* size_p, size_t k, const fuzzy_match_type* match_p);
+
+// sort a heap filled by `fuzzy_top_k_push`, most similar first.
+void fuzzy_top_k_sort(fuzzy_match_type* heap_p, size_t size);
+
+// score every key once against the pattern, and add it to a heap as `fuzzy_top_k_push`.
+void fuzzy_top_k_scan(const fuzzy_pattern_type* pattern_p, fuzzy_metric_type metric, const char* const* keys_pp,
+                      size_t count, size_t k, fuzzy_match_type* heap_p, size_t* size_p, uint64_t* scratch_p);
+
+// score every key once against the query, and write the `k` most similar keys to `matches_p`, most similar first.
+// `*match_count_p` is set to the number of matches written, at most `k`.
+bool fuzzy_top_k(const char* query_p, fuzzy_metric_type metric, const char* const* keys_pp, size_t count, size_t k,
+                 fuzzy_match_type* matches_p, size_t* match_count_p);
@@ -0,0 +1,266 @@
+#include <stdbool.h> // bool, true, false
+#include <stdint.h>  // int64_t, uint32_t, uint64_t, UINT32_MAX
+#include <stdlib.h>  // malloc, calloc, free, size_t
+#include <string.h>  // strlen
+
+#include "fuzzy.h" // fuzzy_pattern_*, fuzzy_score, fuzzy_is_better, fuzzy_top_k_*
+#include "fuzzy_index.h"
+
+#define GRAM_COUNT (1 << 16)
+
+#define min(x, y) ((x) < (y) ? (x) : (y))
+#define max(x, y) ((x) > (y) ? (x) : (y))
+#define abs_diff(x, y) ((x) >= (y) ? (x) - (y) : (y) - (x))
+
+static inline uint32_t gram_at(const char* str, size_t i) {
+    return (uint32_t)(unsigned char)str[i] << 8 | (unsigned char)str[i + 1];
+}
+
+static int cmp_gram(const void* a_p, const void* b_p) {
+    uint32_t a = *(const uint32_t*)a_p;
+    uint32_t b = *(const uint32_t*)b_p;
+    return (a > b) - (a < b);
+}
+
+// write the bigrams of `str` sorted to `grams_p`, and return how many there are.
+static size_t sorted_grams(const char* str, size_t len, uint32_t* grams_p) {
+    if (len < 2) {
+        return 0;
+    }
+    for (size_t i = 0; i + 1 < len; i++) {
+        grams_p[i] = gram_at(str, i);
+    }
+    qsort(grams_p, len - 1, sizeof(uint32_t), cmp_gram);
+    return len - 1;
+}
+
+bool fuzzy_index_init(fuzzy_index_type* index_p, const char* const* keys_pp, size_t count) {
+    *index_p = (fuzzy_index_type){.key_count = count, .keys_pp = keys_pp};
+    if (count > UINT32_MAX) {
+        return false;
+    }
+
+    uint32_t* grams_p = NULL;
+    index_p->lens_p = malloc(sizeof(uint32_t) * (count + 1));
+    index_p->gram_offsets_p = calloc(GRAM_COUNT + 1, sizeof(size_t));
+    if (index_p->lens_p == NULL || index_p->gram_offsets_p == NULL) {
+        goto error;
+    }
+    for (size_t i = 0; i < count; i++) {
+        size_t len = strlen(keys_pp[i]);
+        if (len > UINT32_MAX) {
+            goto error;
+        }
+        index_p->lens_p[i] = (uint32_t)len;
+        index_p->max_len = max(index_p->max_len, len);
+    }
+    grams_p = malloc(sizeof(uint32_t) * (index_p->max_len + 1));
+    index_p->len_offsets_p = calloc(index_p->max_len + 2, sizeof(size_t));
+    index_p->len_keys_p = malloc(sizeof(uint32_t) * (count + 1));
+    if (grams_p == NULL || index_p->len_offsets_p == NULL || index_p->len_keys_p == NULL) {
+        goto error;
+    }
+
+    // count the postings of every bigram, one per distinct bigram of a key, then fill them in a second pass
+    for (size_t i = 0; i < count; i++) {
+        size_t gram_count = sorted_grams(keys_pp[i], index_p->lens_p[i], grams_p);
+        for (size_t j = 0; j < gram_count; j++) {
+            index_p->gram_offsets_p[grams_p[j] + 1] += j == 0 || grams_p[j] != grams_p[j - 1];
+        }
+        index_p->len_offsets_p[index_p->lens_p[i] + 1]++;
+    }
+    for (size_t g = 0; g < GRAM_COUNT; g++) {
+        index_p->gram_offsets_p[g + 1] += index_p->gram_offsets_p[g];
+    }
+    for (size_t l = 0; l <= index_p->max_len; l++) {
+        index_p->len_offsets_p[l + 1] += index_p->len_offsets_p[l];
+    }
+
+    index_p->postings_p = malloc(sizeof(fuzzy_index_posting_type) * (index_p->gram_offsets_p[GRAM_COUNT] + 1));
+    size_t* gram_fill_p = malloc(sizeof(size_t) * GRAM_COUNT);
+    size_t* len_fill_p = malloc(sizeof(size_t) * (index_p->max_len + 1));
+    if (index_p->postings_p == NULL || gram_fill_p == NULL || len_fill_p == NULL) {
+        free(gram_fill_p);
+        free(len_fill_p);
+        goto error;
+    }
+    memcpy(gram_fill_p, index_p->gram_offsets_p, sizeof(size_t) * GRAM_COUNT);
+    memcpy(len_fill_p, index_p->len_offsets_p, sizeof(size_t) * (index_p->max_len + 1));
+    for (size_t i = 0; i < count; i++) {
+        size_t gram_count = sorted_grams(keys_pp[i], index_p->lens_p[i], grams_p);
+        for (size_t j = 0; j < gram_count;) {
+            size_t run = 1;
+            while (j + run < gram_count && grams_p[j + run] == grams_p[j]) {
+                run++;
+            }
+            index_p->postings_p[gram_fill_p[grams_p[j]]++] = (fuzzy_index_posting_type){.key = (uint32_t)i, .count = (uint32_t)run};
+            j += run;
+        }
+        index_p->len_keys_p[len_fill_p[index_p->lens_p[i]]++] = (uint32_t)i;
+    }
+    free(gram_fill_p);
+    free(len_fill_p);
+    free(grams_p);
+    return true;
+
+error:
+    free(grams_p);
+    fuzzy_index_destroy(index_p);
+    return false;
+}
+
+void fuzzy_index_destroy(fuzzy_index_type* index_p) {
+    free(index_p->lens_p);
+    free(index_p->gram_offsets_p);
+    free(index_p->postings_p);
+    free(index_p->len_offsets_p);
+    free(index_p->len_keys_p);
+    *index_p = (fuzzy_index_type){0};
+}
+
+// rank of the best score a key of length `m` sharing `shared` bigrams with a query of length `n` may have. rank 0 is
+// the best score possible, and every rank after it is one worse.
+static size_t score_rank(fuzzy_metric_type metric, size_t n, size_t m, size_t shared) {
+    size_t grams = max(n, m) > 0 ? max(n, m) - 1 : 0;
+    size_t distance_bound = max(abs_diff(n, m), grams > shared ? (grams - shared + 1) / 2 : 0);
+    switch (metric) {
+    case FUZZY_METRIC_LCS:
+        // LCS = (n + m - indel distance) / 2, and the indel distance is at least the edit distance
+        return n - min(min(n, m), (n + m - min(distance_bound, n + m)) / 2);
+    case FUZZY_METRIC_LEVENSHTEIN:
+        return distance_bound;
+    }
+    return 0;
+}
+
+static inline int64_t rank_score(fuzzy_metric_type metric, size_t n, size_t rank) {
+    return metric == FUZZY_METRIC_LCS ? (int64_t)(n - rank) : -(int64_t)rank;
+}
+
+typedef struct {
+    const fuzzy_index_type* index_p;
+    fuzzy_metric_type metric;
+    const fuzzy_pattern_type* pattern_p;
+    uint64_t* scratch_p;
+    size_t k;
+    fuzzy_match_type* matches_p;
+    size_t size;
+} query_type;
+
+static void score_key(query_type* query_p, uint32_t key, size_t rank) {
+    size_t n = query_p->pattern_p->len;
+    size_t m = query_p->index_p->lens_p[key];
+    fuzzy_match_type match = {.key_p = query_p->index_p->keys_pp[key], .score = rank_score(query_p->metric, n, rank), .len_diff = abs_diff(n, m)};
+    // the bound is the best case, so a key that could not rank before the worst kept even then is skipped
+    if (query_p->size == query_p->k && !fuzzy_is_better(&match, &query_p->matches_p[0])) {
+        return;
+    }
+    match.score = fuzzy_score(query_p->metric, query_p->pattern_p, match.key_p, m, query_p->scratch_p);
+    fuzzy_top_k_push(query_p->matches_p, &query_p->size, query_p->k, &match);
+}
+
+bool fuzzy_index_top_k(const fuzzy_index_type* index_p, const char* query_p, fuzzy_metric_type metric, size_t k,
+                       fuzzy_match_type* matches_p, size_t* match_count_p) {
+    // the LCS favours long keys, which the bigram bound can hardly rule out. ranking the keys then costs more than
+    // scoring them in order.
+    if (metric == FUZZY_METRIC_LCS) {
+        return fuzzy_top_k(query_p, metric, index_p->keys_pp, index_p->key_count, k, matches_p, match_count_p);
+    }
+    *match_count_p = 0;
+    if (k == 0) {
+        return true;
+    }
+
+    bool res = false;
+    uint32_t* shared_p = NULL;
+    uint32_t* touched_p = NULL;
+    uint32_t* order_p = NULL;
+    size_t* rank_offsets_p = NULL;
+    uint32_t* grams_p = NULL;
+    uint64_t* scratch_p = NULL;
+    fuzzy_pattern_type pattern;
+    if (!fuzzy_pattern_init(&pattern, query_p)) {
+        return false;
+    }
+    size_t n = pattern.len;
+    size_t rank_count = n + index_p->max_len + 2;
+
+    shared_p = calloc(index_p->key_count + 1, sizeof(uint32_t));
+    touched_p = malloc(sizeof(uint32_t) * (index_p->key_count + 1));
+    order_p = malloc(sizeof(uint32_t) * (index_p->key_count + 1));
+    rank_offsets_p = calloc(rank_count + 2, sizeof(size_t));
+    grams_p = malloc(sizeof(uint32_t) * (n + 1));
+    scratch_p = malloc(sizeof(uint64_t) * (fuzzy_scratch_words(&pattern) + 1));
+    if (shared_p == NULL || touched_p == NULL || order_p == NULL || rank_offsets_p == NULL || grams_p == NULL ||
+        scratch_p == NULL) {
+        goto cleanup;
+    }
+
+    // count the bigrams shared with every key that shares any
+    size_t touched_count = 0;
+    size_t gram_count = sorted_grams(query_p, n, grams_p);
+    for (size_t j = 0; j < gram_count;) {
+        size_t run = 1;
+        while (j + run < gram_count && grams_p[j + run] == grams_p[j]) {
+            run++;
+        }
+        const fuzzy_index_posting_type* posting_p = &index_p->postings_p[index_p->gram_offsets_p[grams_p[j]]];
+        const fuzzy_index_posting_type* end_p = &index_p->postings_p[index_p->gram_offsets_p[grams_p[j] + 1]];
+        for (; posting_p < end_p; posting_p++) {
+            if (shared_p[posting_p->key] == 0) {
+                touched_p[touched_count++] = posting_p->key;
+            }
+            shared_p[posting_p->key] += (uint32_t)min(run, posting_p->count);
+        }
+        j += run;
+    }
+
+    // sort those keys by rank. counts are shifted by two, so after filling, keys of rank r are from
+    // rank_offsets_p[r] up to rank_offsets_p[r + 1].
+    for (size_t i = 0; i < touched_count; i++) {
+        uint32_t key = touched_p[i];
+        rank_offsets_p[score_rank(metric, n, index_p->lens_p[key], shared_p[key]) + 2]++;
+    }
+    for (size_t r = 0; r < rank_count; r++) {
+        rank_offsets_p[r + 2] += rank_offsets_p[r + 1];
+    }
+    for (size_t i = 0; i < touched_count; i++) {
+        uint32_t key = touched_p[i];
+        order_p[rank_offsets_p[score_rank(metric, n, index_p->lens_p[key], shared_p[key]) + 1]++] = key;
+    }
+
+    // score in order of rank. the other keys of a length share the rank of sharing no bigram.
+    query_type query = {
+        .index_p = index_p, .metric = metric, .pattern_p = &pattern, .scratch_p = scratch_p, .k = k, .matches_p = matches_p};
+    for (size_t rank = 0; rank < rank_count; rank++) {
+        if (query.size == k && rank_score(metric, n, rank) < matches_p[0].score) {
+            break;
+        }
+        for (size_t i = rank_offsets_p[rank]; i < rank_offsets_p[rank + 1]; i++) {
+            score_key(&query, order_p[i], rank);
+        }
+        for (size_t l = 0; l <= index_p->max_len; l++) {
+            if (score_rank(metric, n, l, 0) != rank) {
+                continue;
+            }
+            for (size_t i = index_p->len_offsets_p[l]; i < index_p->len_offsets_p[l + 1]; i++) {
+                if (shared_p[index_p->len_keys_p[i]] == 0) {
+                    score_key(&query, index_p->len_keys_p[i], rank);
+                }
+            }
+        }
+    }
+    fuzzy_top_k_sort(matches_p, query.size);
+    *match_count_p = query.size;
+    res = true;
+
+cleanup:
+    free(shared_p);
+    free(touched_p);
+    free(order_p);
+    free(rank_offsets_p);
+    free(grams_p);
+    free(scratch_p);
+    fuzzy_pattern_destroy(&pattern);
+    return res;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stdbool.h> // bool
+#include <stddef.h>  // size_t
+#include <stdint.h>  // uint32_t
+
+#include "fuzzy.h" // fuzzy_metric_type, fuzzy_match_type
+
+// inverted index from every bigram (pair of adjacent bytes) to the keys containing it, built once.
+//
+// a query counts the bigrams it shares with every key through the postings of its own bigrams. each edit destroys at
+// most two bigrams, so a key of length m sharing s bigrams with a query of length n is at least
+// (max(n, m) - 1 - s) / 2 edits away, and at least |n - m|. this bounds the edit distance, and through the indel
+// distance n + m - 2 * LCS also the LCS. keys are scored in order of their bound, and the search ends once no bound can
+// reach the top k. keys sharing no bigram only have a bound from their length, so they are kept grouped by length.
+// the bound on the LCS is too weak to pay off, so LCS queries score every key.
+typedef struct {
+    uint32_t key;
+    uint32_t count; // occurrences of the bigram in the key
+} fuzzy_index_posting_type;
+
+typedef struct {
+    size_t key_count;
+    const char* const* keys_pp; // not copied
+    uint32_t* lens_p;
+    size_t* gram_offsets_p; // postings of bigram g are gram_offsets_p[g] up to gram_offsets_p[g + 1]
+    fuzzy_index_posting_type* postings_p;
+    size_t max_len;
+    size_t* len_offsets_p; // keys of length l are len_keys_p[len_offsets_p[l]] up to len_keys_p[len_offsets_p[l + 1]]
+    uint32_t* len_keys_p;
+} fuzzy_index_type;
+
+bool fuzzy_index_init(fuzzy_index_type* index_p, const char* const* keys_pp, size_t count);
+
+void fuzzy_index_destroy(fuzzy_index_type* index_p);
+
+// as `fuzzy_top_k` over the indexed keys. the scores are the same, only keys tied in both score and length difference
+// may be chosen differently. the index is not modified, so queries may run concurrently.
+bool fuzzy_index_top_k(const fuzzy_index_type* index_p, const char* query_p, fuzzy_metric_type metric, size_t k,
+                       fuzzy_match_type* matches_p, size_t* match_count_p);
@@ -0,0 +1,210 @@
+#include <pthread.h> // pthread_*
+#include <stdbool.h> // bool, true, false
+#include <stdint.h>  // uint64_t
+#include <stdlib.h>  // malloc, calloc, realloc, free, size_t
+
+#include "fuzzy.h" // fuzzy_pattern_*, fuzzy_top_k_*
+#include "fuzzy_pool.h"
+
+// keys below this are scored on the calling thread, and no partition gets fewer
+#define FUZZY_POOL_MIN_PARTITION_SIZE 4096
+
+// partitions per worker, so a worker held up by long keys does not hold up the query
+#define FUZZY_POOL_PARTITIONS_PER_THREAD 4
+
+typedef struct fuzzy_pool_query_type fuzzy_pool_query_type;
+
+typedef struct fuzzy_pool_task_type {
+    fuzzy_pool_query_type* query_p;
+    size_t begin;
+    size_t end;
+    fuzzy_match_type* heap_p; // top k of the partition
+    size_t size;
+    struct fuzzy_pool_task_type* next_p; // in the queue
+} fuzzy_pool_task_type;
+
+struct fuzzy_pool_query_type {
+    const fuzzy_pattern_type* pattern_p;
+    fuzzy_metric_type metric;
+    const char* const* keys_pp;
+    size_t k;
+    size_t remaining_count; // tasks not finished, guarded by the pool mutex
+    bool oom;
+    pthread_cond_t done_cond;
+};
+
+struct fuzzy_pool_type {
+    pthread_mutex_t mutex;
+    pthread_cond_t work_cond;
+    fuzzy_pool_task_type* head_p; // queued tasks
+    fuzzy_pool_task_type* tail_p;
+    bool stopping;
+
+    size_t thread_count;
+    pthread_t threads[];
+};
+
+static void* fuzzy_pool_worker_run(void* arg) {
+    fuzzy_pool_type* pool_p = arg;
+
+    // scratch for long queries, kept across tasks
+    uint64_t* scratch_p = NULL;
+    size_t scratch_capacity = 0;
+
+    pthread_mutex_lock(&pool_p->mutex);
+    while (true) {
+        while (pool_p->head_p == NULL && !pool_p->stopping) {
+            pthread_cond_wait(&pool_p->work_cond, &pool_p->mutex);
+        }
+        if (pool_p->head_p == NULL) {
+            break;
+        }
+        fuzzy_pool_task_type* task_p = pool_p->head_p;
+        pool_p->head_p = task_p->next_p;
+        pthread_mutex_unlock(&pool_p->mutex);
+
+        fuzzy_pool_query_type* query_p = task_p->query_p;
+        size_t scratch_words = fuzzy_scratch_words(query_p->pattern_p) + 1;
+        bool oom = false;
+        if (scratch_words > scratch_capacity) {
+            uint64_t* new_scratch_p = realloc(scratch_p, sizeof(uint64_t) * scratch_words);
+            if (new_scratch_p != NULL) {
+                scratch_p = new_scratch_p;
+                scratch_capacity = scratch_words;
+            } else {
+                oom = true;
+            }
+        }
+        if (!oom) {
+            fuzzy_top_k_scan(query_p->pattern_p, query_p->metric, &query_p->keys_pp[task_p->begin], task_p->end - task_p->begin,
+                             query_p->k, task_p->heap_p, &task_p->size, scratch_p);
+        }
+
+        pthread_mutex_lock(&pool_p->mutex);
+        query_p->oom |= oom;
+        if (--query_p->remaining_count == 0) {
+            pthread_cond_signal(&query_p->done_cond);
+        }
+    }
+    pthread_mutex_unlock(&pool_p->mutex);
+
+    free(scratch_p);
+    return NULL;
+}
+
+fuzzy_pool_type* fuzzy_pool_create(size_t thread_count) {
+    if (thread_count <= 1) {
+        thread_count = 0;
+    }
+    fuzzy_pool_type* pool_p = malloc(sizeof(fuzzy_pool_type) + sizeof(pthread_t) * thread_count);
+    if (pool_p == NULL) {
+        return NULL;
+    }
+    pool_p->head_p = NULL;
+    pool_p->tail_p = NULL;
+    pool_p->stopping = false;
+    pool_p->thread_count = 0;
+    if (pthread_mutex_init(&pool_p->mutex, NULL) != 0) {
+        free(pool_p);
+        return NULL;
+    }
+    if (pthread_cond_init(&pool_p->work_cond, NULL) != 0) {
+        pthread_mutex_destroy(&pool_p->mutex);
+        free(pool_p);
+        return NULL;
+    }
+    // with fewer workers than asked, the pool still works
+    for (; pool_p->thread_count < thread_count; pool_p->thread_count++) {
+        if (pthread_create(&pool_p->threads[pool_p->thread_count], NULL, fuzzy_pool_worker_run, pool_p) != 0) {
+            break;
+        }
+    }
+    return pool_p;
+}
+
+void fuzzy_pool_destroy(fuzzy_pool_type* pool_p) {
+    pthread_mutex_lock(&pool_p->mutex);
+    pool_p->stopping = true;
+    pthread_cond_broadcast(&pool_p->work_cond);
+    pthread_mutex_unlock(&pool_p->mutex);
+
+    for (size_t i = 0; i < pool_p->thread_count; i++) {
+        pthread_join(pool_p->threads[i], NULL);
+    }
+    pthread_cond_destroy(&pool_p->work_cond);
+    pthread_mutex_destroy(&pool_p->mutex);
+    free(pool_p);
+}
+
+bool fuzzy_pool_top_k(fuzzy_pool_type* pool_p, const char* query_p, fuzzy_metric_type metric, const char* const* keys_pp,
+                      size_t count, size_t k, fuzzy_match_type* matches_p, size_t* match_count_p) {
+    size_t task_count = count / FUZZY_POOL_MIN_PARTITION_SIZE;
+    if (task_count > pool_p->thread_count * FUZZY_POOL_PARTITIONS_PER_THREAD) {
+        task_count = pool_p->thread_count * FUZZY_POOL_PARTITIONS_PER_THREAD;
+    }
+    if (task_count <= 1 || k == 0) {
+        return fuzzy_top_k(query_p, metric, keys_pp, count, k, matches_p, match_count_p);
+    }
+
+    bool res = false;
+    fuzzy_pool_task_type* tasks_p = NULL;
+    fuzzy_match_type* heaps_p = NULL;
+    fuzzy_pattern_type pattern;
+    if (!fuzzy_pattern_init(&pattern, query_p)) {
+        return false;
+    }
+    tasks_p = calloc(task_count, sizeof(fuzzy_pool_task_type));
+    heaps_p = malloc(sizeof(fuzzy_match_type) * task_count * k);
+    if (tasks_p == NULL || heaps_p == NULL) {
+        goto cleanup;
+    }
+
+    fuzzy_pool_query_type query = {
+        .pattern_p = &pattern, .metric = metric, .keys_pp = keys_pp, .k = k, .remaining_count = task_count, .oom = false};
+    if (pthread_cond_init(&query.done_cond, NULL) != 0) {
+        goto cleanup;
+    }
+    for (size_t i = 0; i < task_count; i++) {
+        tasks_p[i] = (fuzzy_pool_task_type){
+            .query_p = &query,
+            .begin = count * i / task_count,
+            .end = count * (i + 1) / task_count,
+            .heap_p = &heaps_p[i * k],
+            .size = 0,
+            .next_p = i + 1 < task_count ? &tasks_p[i + 1] : NULL,
+        };
+    }
+
+    pthread_mutex_lock(&pool_p->mutex);
+    if (pool_p->head_p == NULL) {
+        pool_p->head_p = &tasks_p[0];
+    } else {
+        pool_p->tail_p->next_p = &tasks_p[0];
+    }
+    pool_p->tail_p = &tasks_p[task_count - 1];
+    pthread_cond_broadcast(&pool_p->work_cond);
+    while (query.remaining_count > 0) {
+        pthread_cond_wait(&query.done_cond, &pool_p->mutex);
+    }
+    pthread_mutex_unlock(&pool_p->mutex);
+    pthread_cond_destroy(&query.done_cond);
+
+    // merge the top k of every partition
+    if (!query.oom) {
+        size_t size = 0;
+        for (size_t i = 0; i < task_count; i++) {
+            for (size_t j = 0; j < tasks_p[i].size; j++) {
+                fuzzy_top_k_push(matches_p, &size, k, &tasks_p[i].heap_p[j]);
+            }
+        }
+        fuzzy_top_k_sort(matches_p, size);
+        *match_count_p = size;
+        res = true;
+    }
+
+cleanup:
+    free(tasks_p);
+    free(heaps_p);
+    fuzzy_pattern_destroy(&pattern);
+    return res;
+}
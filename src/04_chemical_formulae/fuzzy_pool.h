@@ -0,0 +1,21 @@
+#pragma once
+
+#include <stdbool.h> // bool
+#include <stddef.h>  // size_t
+
+#include "fuzzy.h" // fuzzy_metric_type, fuzzy_match_type
+
+// pool of worker threads scoring fuzzy queries. a query is split into partitions of the keys, every partition is scored
+// by a worker into its own top k, and the caller merges them. any number of threads may submit queries at the same
+// time: their partitions share one queue.
+typedef struct fuzzy_pool_type fuzzy_pool_type;
+
+// start `thread_count` workers. with one thread or less, queries are scored on the calling thread.
+fuzzy_pool_type* fuzzy_pool_create(size_t thread_count);
+
+// stop the workers. no query may be running.
+void fuzzy_pool_destroy(fuzzy_pool_type* pool_p);
+
+// as `fuzzy_top_k`, scored by the workers.
+bool fuzzy_pool_top_k(fuzzy_pool_type* pool_p, const char* query_p, fuzzy_metric_type metric, const char* const* keys_pp,
+                      size_t count, size_t k, fuzzy_match_type* matches_p, size_t* match_count_p);
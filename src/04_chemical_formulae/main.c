@@ -1,149 +1,399 @@
+#include <errno.h>   // errno
 #include <stdbool.h> // bool, true, false
-#include <stdint.h>  // uint64_t
-#include <stdio.h>   // getline, printf, sprintf, stdin, fopen, fclose, FILE, fgets
-#include <stdlib.h>  // NULL, free, qsort, size_t, ssize_t
-#include <string.h>  // memset, strlen, strnlen, strcspn
-
-#include "strmap.h" // strmap_*
-
-#define max(x, y) ((x) > (y) ? (x) : (y))
-
-#define line_len_max 150
-static uint64_t result[line_len_max][line_len_max];
-
-uint64_t longest_common_subsequence(const char* str1, size_t n, const char* str2, size_t m) {
-    // https://en.wikibooks.org/wiki/Algorithm_Implementation/Strings/Longest_common_subsequence
-    memset(result, 0, sizeof(result));
-    for (size_t i = 1; i <= n; i++) {
-        for (size_t j = 1; j <= m; j++) {
-            if (str1[i - 1] == str2[j - 1]) {
-                result[i][j] = result[i - 1][j - 1] + 1;
-            } else {
-                result[i][j] = max(result[i - 1][j], result[i][j - 1]);
-            }
-        }
-    }
-    return result[n][m];
-}
+#include <stdio.h>   // getline, printf, fprintf, snprintf, fopen, fread, stdin, stdout, stderr
+#include <stdlib.h>  // NULL, malloc, free, realloc, strtoul, system, size_t, ssize_t
+#include <string.h>  // strcmp, strlen, strerror, memchr, memmove
+#include <time.h>    // clock_gettime
+#include <unistd.h>  // sysconf
 
-#define abs_diff(x, y) ((x) >= (y) ? (x) - (y) : (y) - (x))
+#include "arena_allocator.h" // arena_allocator_*, arena_allocate, arena_reallocate
+#include "csv.h"             // csv_reader_*, csv_field_type
+#include "fuzzy.h"           // fuzzy_match_type, fuzzy_metric_type
+#include "fuzzy_index.h"     // fuzzy_index_*
+#include "fuzzy_pool.h"      // fuzzy_pool_*
+#include "query_cache.h"     // query_cache_*
+#include "snapshot.h"        // snapshot_*
+#include "strmap.h"          // strmap_*
+#include "strmap_frozen.h"   // strmap_freeze, strmap_frozen_*
+#include "write_buffer.h"    // write_buffer_*
 
-static char* cmp_custom_usr_inp_p = NULL;
-int cmp_custom(const void* s1, const void* s2) {
-    size_t n = strlen(cmp_custom_usr_inp_p);
-    size_t m1 = strlen(*(char**)s1);
-    size_t m2 = strlen(*(char**)s2);
+#define matches_shown 5
+#define cache_capacity_default 1024
 
-    uint64_t lcs1 = longest_common_subsequence(cmp_custom_usr_inp_p, n, *(char**)s1, m1);
-    uint64_t lcs2 = longest_common_subsequence(cmp_custom_usr_inp_p, n, *(char**)s2, m2);
+// input read at once in batch mode. a longer line grows the buffer.
+#define batch_block_size (1 << 16)
 
-    if (lcs1 != lcs2) {
-        return -(lcs1 < lcs2) + (lcs1 > lcs2);
-    }
+static void print_usage(const char* prog_name) {
+    fprintf(stderr,
+            "Usage: %s [--metric lcs|levenshtein] [--threads N] [--cache N] [--batch FILE] [--compile FILE | --snapshot FILE]\n",
+            prog_name);
+}
+
+typedef struct {
+    const strmap_frozen_type* frozen_p;
+    const snapshot_type* snapshot_p;
+    const char** keys_arr_pp;
+    size_t count;
+    fuzzy_metric_type metric;
+    size_t thread_count;
+
+    // the index and the pool that narrow down fuzzy queries are only set up for the first query that needs them, so
+    // exact lookups start right away
+    fuzzy_index_type index;
+    bool index_ready;
+    fuzzy_pool_type* pool_p;
+    query_cache_type* cache_p; // NULL if disabled
 
-    size_t diff1 = abs_diff(m1, n);
-    size_t diff2 = abs_diff(m2, n);
+    size_t exact_count;
+    size_t fuzzy_count;
+} query_context_type;
 
-    return -(diff2 < diff1) + (diff2 > diff1);
+// value of `key_p` from the snapshot if one is open, otherwise from the frozen map.
+static const char* lookup(const query_context_type* ctx_p, const char* key_p) {
+    return ctx_p->snapshot_p != NULL ? snapshot_get(ctx_p->snapshot_p, key_p) : strmap_frozen_get(ctx_p->frozen_p, key_p);
 }
 
-int main(void) {
+static bool write_answer(write_buffer_type* wb_p, const char* key_p, const char* value_p) {
+    return write_buffer_write_str(wb_p, " -> ") && write_buffer_write_str(wb_p, key_p) &&
+           write_buffer_write_str(wb_p, " (") && write_buffer_write_str(wb_p, value_p) &&
+           write_buffer_write_str(wb_p, ")\n");
+}
 
-    // prepare stuff:
+// the most similar keys to a query that is not a key, from the cache if it was asked recently.
+static bool fuzzy_matches(query_context_type* ctx_p, const char* query_p, fuzzy_match_type* matches_p,
+                          size_t* match_count_p) {
+    if (ctx_p->cache_p != NULL && query_cache_get(ctx_p->cache_p, query_p, matches_p, match_count_p)) {
+        return true;
+    }
+    bool found;
+    if (ctx_p->metric == FUZZY_METRIC_LEVENSHTEIN) {
+        if (!ctx_p->index_ready && !fuzzy_index_init(&ctx_p->index, ctx_p->keys_arr_pp, ctx_p->count)) {
+            return false;
+        }
+        ctx_p->index_ready = true;
+        found = fuzzy_index_top_k(&ctx_p->index, query_p, ctx_p->metric, matches_shown, matches_p, match_count_p);
+    } else {
+        if (ctx_p->pool_p == NULL && (ctx_p->pool_p = fuzzy_pool_create(ctx_p->thread_count)) == NULL) {
+            return false;
+        }
+        found = fuzzy_pool_top_k(ctx_p->pool_p, query_p, ctx_p->metric, ctx_p->keys_arr_pp, ctx_p->count, matches_shown,
+                                 matches_p, match_count_p);
+    }
+    if (found && ctx_p->cache_p != NULL) {
+        query_cache_put(ctx_p->cache_p, query_p, matches_p, *match_count_p);
+    }
+    return found;
+}
 
-    printf("Please wait...\n");
-    int status = system("python get_data.py");
-    if (status != 0) {
-        return 1;
+// write the value of a key, or the most similar keys and their values.
+static bool answer_query(query_context_type* ctx_p, const char* query_p, write_buffer_type* wb_p) {
+    const char* value_p = lookup(ctx_p, query_p);
+    if (value_p != NULL) {
+        ctx_p->exact_count++;
+        return write_answer(wb_p, query_p, value_p);
+    }
+    ctx_p->fuzzy_count++;
+    fuzzy_match_type matches[matches_shown];
+    size_t match_count = 0;
+    if (!fuzzy_matches(ctx_p, query_p, matches, &match_count)) {
+        return false;
     }
+    for (size_t i = 0; i < match_count; i++) {
+        if (!write_answer(wb_p, matches[i].key_p, lookup(ctx_p, matches[i].key_p))) {
+            return false;
+        }
+    }
+    return true;
+}
 
-    FILE* fp = fopen("data.csv", "r");
+// answer every line of the file at `path`, read a block at a time.
+static bool answer_batch(query_context_type* ctx_p, const char* path, write_buffer_type* wb_p) {
+    FILE* fp = fopen(path, "rb");
     if (fp == NULL) {
-        return 1;
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return false;
     }
-    strmap_type* strmap_p = strmap_create();
-    if (!strmap_p) {
-        return 1;
+    size_t capacity = batch_block_size;
+    char* buf = malloc(capacity + 1); // room to terminate a last line without a newline
+    size_t len = 0;
+    bool eof = false;
+    bool res = false;
+    if (buf == NULL) {
+        goto cleanup;
     }
+    while (!eof) {
+        if (len == capacity) {
+            char* new_buf = realloc(buf, 2 * capacity + 1);
+            if (new_buf == NULL) {
+                goto cleanup;
+            }
+            buf = new_buf;
+            capacity *= 2;
+        }
+        size_t read_count = fread(&buf[len], 1, capacity - len, fp);
+        if (read_count < capacity - len) {
+            if (ferror(fp)) {
+                fprintf(stderr, "%s: %s\n", path, strerror(errno));
+                goto cleanup;
+            }
+            eof = true;
+        }
+        len += read_count;
 
-    // read from file and store data as keys and values in strmap:
-    char buf[line_len_max];
-    fgets(buf, line_len_max, fp); // skip first line
-    while (true) {
-        if (fgets(buf, line_len_max, fp) == NULL) {
-            break;
+        // the last line of the block is kept for the next block, unless the file ends
+        char* line_p = buf;
+        char* end_p = &buf[len];
+        while (line_p < end_p) {
+            char* newline_p = memchr(line_p, '\n', (size_t)(end_p - line_p));
+            if (newline_p == NULL && !eof) {
+                break;
+            }
+            newline_p = newline_p != NULL ? newline_p : end_p;
+            *newline_p = '\0';
+            if (!answer_query(ctx_p, line_p, wb_p)) {
+                goto cleanup;
+            }
+            line_p = newline_p + 1;
         }
-        size_t n = strnlen(buf, 150);
-        buf[n - 1] = '\0'; // remove newline
+        len = line_p < end_p ? (size_t)(end_p - line_p) : 0;
+        memmove(buf, line_p, len);
+    }
+    res = true;
 
-        size_t i = strcspn(buf, ",");
-        buf[i] = '\0';
+cleanup:
+    free(buf);
+    fclose(fp);
+    return res;
+}
 
-        size_t j;
-        if (buf[i + 1] != '\"') {
-            j = i + 1 + strcspn(&buf[i + 1], ",");
-            buf[j] = '\0';
-        } else {
-            j = i + 2 + strcspn(&buf[i + 2], "\"") + 1;
-            buf[j - 1] = '\0';
-            buf[j] = '\0';
-            i += 1;
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static bool load_csv(strmap_type* strmap_p) {
+    fprintf(stderr, "Please wait...\n");
+    int status = system("python get_data.py");
+    if (status != 0) {
+        return false;
+    }
+
+    csv_reader_type reader;
+    if (!csv_reader_open(&reader, "data.csv")) {
+        return false;
+    }
+    // keys are read in place from the file. values are built in an arena, and only live until they are inserted:
+    arena_allocator_type values_arena;
+    arena_allocator_init(&values_arena, ARENA_ALLOCATOR_DEFAULT_BLOCK_SIZE);
+    const char** keys_pp = NULL;
+    const char** values_pp = NULL;
+    size_t count = 0;
+    size_t capacity = 0;
+    bool res = false;
+
+    // read the rows of formula, synonym and cas number. the first row holds the column names:
+    csv_field_type fields[3];
+    size_t field_count;
+    bool is_header = true;
+    while (csv_reader_next(&reader, fields, 3, &field_count)) {
+        if (is_header || field_count < 2) {
+            is_header = false;
+            continue;
+        }
+        const csv_field_type* formula_p = &fields[0];
+        const csv_field_type* synonym_p = &fields[1];
+        const csv_field_type* cas_p = field_count > 2 ? &fields[2] : &(csv_field_type){.str_p = "", .len = 0};
+
+        if (count == capacity) {
+            capacity = capacity == 0 ? 1024 : 2 * capacity;
+            const char** new_keys_pp = realloc(keys_pp, sizeof(char*) * capacity);
+            if (new_keys_pp == NULL) {
+                goto cleanup;
+            }
+            keys_pp = new_keys_pp;
+            const char** new_values_pp = realloc(values_pp, sizeof(char*) * capacity);
+            if (new_values_pp == NULL) {
+                goto cleanup;
+            }
+            values_pp = new_values_pp;
+        }
+        const char* cas_prefix = cas_p->len != 0 ? ", CAS: " : "";
+        size_t value_size = formula_p->len + strlen(cas_prefix) + cas_p->len + 1;
+        char* value_p = arena_allocate(&values_arena, 1, value_size);
+        if (value_p == NULL) {
+            goto cleanup;
         }
-        char* formula_str = &buf[0];
-        char* synonym_str = &buf[i + 1];
-        char* cas_str = &buf[j + 1];
+        snprintf(value_p, value_size, "%s%s%s", formula_p->str_p, cas_prefix, cas_p->str_p);
 
-        char buf1[line_len_max * 2];
-        sprintf(buf1, "%s%s%s", formula_str, *cas_str != '\0' ? ", CAS: " : "", cas_str);
-        strmap_set(strmap_p,
-                   synonym_str, // key
-                   buf1         // value
-        );
+        keys_pp[count] = synonym_p->str_p;
+        values_pp[count] = value_p;
+        count++;
     }
+    res = count == 0 || strmap_set_all(strmap_p, keys_pp, values_pp, count);
 
-    // create an array of key references:
-    size_t count = strmap_get_count(strmap_p);
-    char** keys_arr_pp = malloc(sizeof(char*) * count);
-    {
-        size_t keys_arr_index = 0;
+cleanup:
+    free(keys_pp);
+    free(values_pp);
+    arena_allocator_release(&values_arena);
+    csv_reader_close(&reader);
+    return res;
+}
 
-        // required for iterating strmap:
-        size_t list_index;
-        strmap_node_type* next_p = NULL;
-        char* key_p = NULL;
-        char* value_p = NULL;
+int main(int argc, char** argv) {
+    fuzzy_metric_type metric = FUZZY_METRIC_LCS;
+    size_t thread_count = 0;
+    const char* compile_path = NULL;
+    const char* snapshot_path = NULL;
+    const char* batch_path = NULL;
+    size_t cache_capacity = cache_capacity_default;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--metric") == 0 && i + 1 < argc && strcmp(argv[i + 1], "lcs") == 0) {
+            metric = FUZZY_METRIC_LCS;
+            i++;
+        } else if (strcmp(argv[i], "--metric") == 0 && i + 1 < argc && strcmp(argv[i + 1], "levenshtein") == 0) {
+            metric = FUZZY_METRIC_LEVENSHTEIN;
+            i++;
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            thread_count = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--compile") == 0 && i + 1 < argc && snapshot_path == NULL) {
+            compile_path = argv[++i];
+        } else if (strcmp(argv[i], "--snapshot") == 0 && i + 1 < argc && compile_path == NULL) {
+            snapshot_path = argv[++i];
+        } else if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc) {
+            batch_path = argv[++i];
+        } else if (strcmp(argv[i], "--cache") == 0 && i + 1 < argc) {
+            cache_capacity = strtoul(argv[++i], NULL, 10);
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
 
-        (void)(value_p);
+    // prepare stuff:
 
-        strmap_for_each(strmap_p, list_index, next_p, key_p, value_p) {
-            keys_arr_pp[keys_arr_index++] = key_p; // store reference
+    strmap_frozen_type* frozen_p = NULL;
+    snapshot_type snapshot;
+    const snapshot_type* snapshot_p = NULL;
+    size_t count;
+    if (snapshot_path != NULL) {
+        // a snapshot is mapped as is, without running the script or parsing the csv:
+        if (!snapshot_open(&snapshot, snapshot_path)) {
+            fprintf(stderr, "Could not open snapshot %s\n", snapshot_path);
+            return 1;
+        }
+        snapshot_p = &snapshot;
+        count = snapshot_get_count(snapshot_p);
+    } else {
+        // the map is only built to be frozen or written, so its nodes are freed with the arena all at once:
+        arena_allocator_type arena;
+        arena_allocator_init(&arena, ARENA_ALLOCATOR_DEFAULT_BLOCK_SIZE);
+        strmap_type* strmap_p = NULL;
+        if (!strmap_init(&strmap_p, &arena, arena_allocate, arena_reallocate, NULL) || !load_csv(strmap_p)) {
+            arena_allocator_release(&arena);
+            return 1;
+        }
+#ifdef STRMAP_STATS
+        strmap_stats_print_json(strmap_p, stderr);
+#endif
+        bool res;
+        if (compile_path != NULL) {
+            res = snapshot_write(compile_path, strmap_p);
+            if (!res) {
+                fprintf(stderr, "Could not write snapshot %s\n", compile_path);
+            }
+        } else {
+            // the map is not changed after loading, so lookups go to a frozen copy:
+            frozen_p = strmap_freeze(strmap_p);
+            res = frozen_p != NULL;
+        }
+        strmap_destroy(strmap_p);
+        arena_allocator_release(&arena);
+        if (compile_path != NULL || !res) {
+            return res ? 0 : 1;
         }
+        count = strmap_frozen_get_count(frozen_p);
+    }
+
+    // create an array of key references:
+    const char** keys_arr_pp = malloc(sizeof(char*) * (count > 0 ? count : 1));
+    if (keys_arr_pp == NULL) {
+        return 1;
+    }
+    for (size_t i = 0; i < count; i++) {
+        keys_arr_pp[i] = snapshot_p != NULL ? snapshot_key(snapshot_p, i) : strmap_frozen_key(frozen_p, i);
+    }
+    if (thread_count == 0) {
+        long online_count = sysconf(_SC_NPROCESSORS_ONLN);
+        thread_count = online_count > 0 ? (size_t)online_count : 1;
+    }
+    query_context_type ctx = {.frozen_p = frozen_p,
+                              .snapshot_p = snapshot_p,
+                              .keys_arr_pp = keys_arr_pp,
+                              .count = count,
+                              .metric = metric,
+                              .thread_count = thread_count,
+                              .cache_p = cache_capacity > 0 ? query_cache_create(cache_capacity, matches_shown) : NULL};
+    write_buffer_type wb;
+    int exit_code = 1;
+    if ((cache_capacity > 0 && ctx.cache_p == NULL) || !write_buffer_init(&wb, stdout, WRITE_BUFFER_DEFAULT_CAPACITY)) {
+        goto cleanup;
     }
-    printf("Type your input:\n");
 
     // actual program:
-    char* line_p = NULL;
-    size_t n = 0;
-    ssize_t len = 0;
-    while (0 < (len = getline(&line_p, &n, stdin))) {
-        if (line_p[len - 1] == '\n') {
-            line_p[len - 1] = '\0';
-        }
-        if (strmap_contains(strmap_p, line_p)) {
-            printf(" -> %s (%s)\n", line_p, strmap_get(strmap_p, line_p));
-            continue;
+    if (batch_path != NULL) {
+        double start = now_seconds();
+        bool res = answer_batch(&ctx, batch_path, &wb);
+        res = write_buffer_flush(&wb) && res;
+        double elapsed = now_seconds() - start;
+
+        size_t query_count = ctx.exact_count + ctx.fuzzy_count;
+        fprintf(stderr, "batch: %zu queries in %.3f s (%.0f queries/s), %zu exact, %zu fuzzy\n", query_count, elapsed,
+                elapsed > 0 ? (double)query_count / elapsed : 0.0, ctx.exact_count, ctx.fuzzy_count);
+        if (ctx.cache_p != NULL) {
+            query_cache_stats_type stats = query_cache_stats(ctx.cache_p);
+            size_t lookup_count = stats.hits + stats.misses;
+            fprintf(stderr, "cache: %zu hits, %zu misses, %zu evictions (%.1f%% hit rate)\n", stats.hits, stats.misses,
+                    stats.evictions, lookup_count > 0 ? 100.0 * (double)stats.hits / (double)lookup_count : 0.0);
         }
-        cmp_custom_usr_inp_p = &line_p[0];
-        qsort(keys_arr_pp, count, sizeof(char*), cmp_custom);
-        for (size_t i = count - 1; i >= count - 5; i--) {
-            printf(" -> %s (%s)\n", keys_arr_pp[i], strmap_get(strmap_p, keys_arr_pp[i]));
+        exit_code = res ? 0 : 1;
+    } else {
+        printf("Type your input:\n");
+        fflush(stdout);
+
+        char* line_p = NULL;
+        size_t n = 0;
+        ssize_t len = 0;
+        bool res = true;
+        while (0 < (len = getline(&line_p, &n, stdin))) {
+            if (line_p[len - 1] == '\n') {
+                line_p[len - 1] = '\0';
+            }
+            // every answer is written at once, and shown before the next line is read
+            if (!answer_query(&ctx, line_p, &wb) || !write_buffer_flush(&wb)) {
+                res = false;
+                break;
+            }
         }
+        free(line_p);
+        exit_code = res && !ferror(stdin) ? 0 : 1;
     }
+    write_buffer_destroy(&wb);
+
     // clean up stuff:
-    free(line_p);
+cleanup:
+    query_cache_destroy(ctx.cache_p);
+    if (ctx.pool_p != NULL) {
+        fuzzy_pool_destroy(ctx.pool_p);
+    }
+    if (ctx.index_ready) {
+        fuzzy_index_destroy(&ctx.index);
+    }
     free(keys_arr_pp);
-    strmap_destroy(strmap_p);
-    fclose(fp);
+    if (snapshot_p != NULL) {
+        snapshot_close(&snapshot);
+    }
+    strmap_frozen_destroy(frozen_p);
 
-    return 0;
+    return exit_code;
 }
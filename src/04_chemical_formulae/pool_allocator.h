@@ -0,0 +1,141 @@
+/*
+    size-class pool allocator conforming to allocator function types.
+
+    requests are rounded up to a power of two between POOL_ALLOCATOR_MIN_SIZE and POOL_ALLOCATOR_MAX_SIZE, and served
+    from a free list per size class. the lists are refilled by carving up slabs. larger requests go to malloc. every
+    block starts with a header holding its size class, so deallocation needs no size.
+*/
+
+#pragma once
+
+#include <stdalign.h> // alignas
+#include <stddef.h>   // max_align_t
+#include <stdint.h>   // SIZE_MAX
+#include <stdlib.h>   // malloc, free, size_t
+#include <string.h>   // memcpy
+
+#define POOL_ALLOCATOR_MIN_SIZE 16
+#define POOL_ALLOCATOR_MAX_SIZE 1024
+#define POOL_ALLOCATOR_CLASS_COUNT 7 // 16, 32, ..., 1024
+#define POOL_ALLOCATOR_SLAB_SIZE (1 << 16)
+#define POOL_ALLOCATOR_LARGE_CLASS POOL_ALLOCATOR_CLASS_COUNT
+
+typedef union pool_allocator_header_type {
+    struct {
+        size_t size_class;
+        union pool_allocator_header_type* next_free_p; // while on a free list
+    } info;
+    max_align_t align; // keep the block after the header aligned
+} pool_allocator_header_type;
+
+typedef struct pool_allocator_slab_type {
+    struct pool_allocator_slab_type* prev_p;
+    size_t used;
+    alignas(max_align_t) unsigned char data[POOL_ALLOCATOR_SLAB_SIZE];
+} pool_allocator_slab_type;
+
+typedef struct {
+    pool_allocator_header_type* free_lists_p[POOL_ALLOCATOR_CLASS_COUNT];
+    pool_allocator_slab_type* slab_p; // current slab, linked to the previous ones
+} pool_allocator_type;
+
+static inline void pool_allocator_init(pool_allocator_type* pool_p) {
+    *pool_p = (pool_allocator_type){0};
+}
+
+// free every slab. blocks from malloc must have been deallocated already.
+static inline void pool_allocator_release(pool_allocator_type* pool_p) {
+    pool_allocator_slab_type* slab_p = pool_p->slab_p;
+    while (slab_p != NULL) {
+        pool_allocator_slab_type* prev_p = slab_p->prev_p;
+        free(slab_p);
+        slab_p = prev_p;
+    }
+    *pool_p = (pool_allocator_type){0};
+}
+
+static inline size_t pool_allocator_size_class(size_t size) {
+    size_t size_class = 0;
+    size_t class_size = POOL_ALLOCATOR_MIN_SIZE;
+    while (class_size < size) {
+        if (class_size == POOL_ALLOCATOR_MAX_SIZE) {
+            return POOL_ALLOCATOR_LARGE_CLASS;
+        }
+        class_size <<= 1;
+        size_class++;
+    }
+    return size_class;
+}
+
+#define pool_allocator_class_size(size_class) ((size_t)POOL_ALLOCATOR_MIN_SIZE << (size_class))
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+
+static inline void* pool_allocate(void* allocator_struct_p, size_t alignment, size_t size) {
+    pool_allocator_type* pool_p = allocator_struct_p;
+    size_t size_class = pool_allocator_size_class(size);
+
+    pool_allocator_header_type* header_p;
+    if (size_class == POOL_ALLOCATOR_LARGE_CLASS) {
+        if (size > SIZE_MAX - sizeof(pool_allocator_header_type)) {
+            return NULL;
+        }
+        header_p = malloc(sizeof(pool_allocator_header_type) + size);
+        if (header_p == NULL) {
+            return NULL;
+        }
+    } else if (pool_p->free_lists_p[size_class] != NULL) {
+        header_p = pool_p->free_lists_p[size_class];
+        pool_p->free_lists_p[size_class] = header_p->info.next_free_p;
+    } else {
+        size_t block_size = sizeof(pool_allocator_header_type) + pool_allocator_class_size(size_class);
+        if (pool_p->slab_p == NULL || POOL_ALLOCATOR_SLAB_SIZE - pool_p->slab_p->used < block_size) {
+            pool_allocator_slab_type* slab_p = malloc(sizeof(pool_allocator_slab_type));
+            if (slab_p == NULL) {
+                return NULL;
+            }
+            slab_p->prev_p = pool_p->slab_p;
+            slab_p->used = 0;
+            pool_p->slab_p = slab_p;
+        }
+        header_p = (pool_allocator_header_type*)&pool_p->slab_p->data[pool_p->slab_p->used];
+        pool_p->slab_p->used += block_size;
+    }
+    header_p->info.size_class = size_class;
+    return header_p + 1;
+}
+
+static inline void pool_deallocate(void* allocator_struct_p, void* ptr) {
+    pool_allocator_type* pool_p = allocator_struct_p;
+    if (ptr == NULL) {
+        return;
+    }
+    pool_allocator_header_type* header_p = (pool_allocator_header_type*)ptr - 1;
+    if (header_p->info.size_class == POOL_ALLOCATOR_LARGE_CLASS) {
+        free(header_p);
+        return;
+    }
+    header_p->info.next_free_p = pool_p->free_lists_p[header_p->info.size_class];
+    pool_p->free_lists_p[header_p->info.size_class] = header_p;
+}
+
+static inline void* pool_reallocate(void* allocator_struct_p, void* ptr, size_t alignment, size_t old_size, size_t new_size) {
+    if (ptr == NULL) {
+        return pool_allocate(allocator_struct_p, alignment, new_size);
+    }
+    pool_allocator_header_type* header_p = (pool_allocator_header_type*)ptr - 1;
+    if (header_p->info.size_class != POOL_ALLOCATOR_LARGE_CLASS &&
+        new_size <= pool_allocator_class_size(header_p->info.size_class)) {
+        return ptr;
+    }
+    void* new_ptr = pool_allocate(allocator_struct_p, alignment, new_size);
+    if (new_ptr == NULL) {
+        return NULL;
+    }
+    memcpy(new_ptr, ptr, old_size < new_size ? old_size : new_size);
+    pool_deallocate(allocator_struct_p, ptr);
+    return new_ptr;
+}
+
+#pragma GCC diagnostic pop
@@ -0,0 +1,176 @@
+#include <stdbool.h> // bool, true, false
+#include <stdint.h>  // uint64_t, SIZE_MAX
+#include <stdlib.h>  // malloc, calloc, free
+#include <string.h>  // memcmp, memcpy, strlen
+
+#include "fuzzy.h" // fuzzy_match_type
+#include "query_cache.h"
+#include "wyhash.h" // wyhash
+
+#define QUERY_CACHE_NIL SIZE_MAX
+
+typedef struct {
+    char* query_p;
+    size_t query_len;
+    uint64_t hash;
+    size_t next_in_bucket;
+    size_t lru_prev; // towards the most recently used entry
+    size_t lru_next; // towards the least recently used entry
+    size_t match_count;
+} query_cache_entry_type;
+
+struct query_cache_type {
+    size_t capacity;
+    size_t k;
+    size_t count;
+    size_t bucket_mask;
+    size_t* buckets_p;
+    query_cache_entry_type* entries_p;
+    fuzzy_match_type* matches_p; // k matches per entry
+    size_t lru_head;             // most recently used
+    size_t lru_tail;             // least recently used
+
+    query_cache_stats_type stats;
+};
+
+query_cache_type* query_cache_create(size_t capacity, size_t k) {
+    if (capacity == 0 || k == 0 || capacity > SIZE_MAX / 2 / sizeof(query_cache_entry_type) ||
+        k > SIZE_MAX / capacity / sizeof(fuzzy_match_type)) {
+        return NULL;
+    }
+    query_cache_type* cache_p = calloc(1, sizeof(query_cache_type));
+    if (cache_p == NULL) {
+        return NULL;
+    }
+    size_t bucket_count = 1;
+    while (bucket_count < 2 * capacity) {
+        bucket_count <<= 1;
+    }
+    cache_p->capacity = capacity;
+    cache_p->k = k;
+    cache_p->bucket_mask = bucket_count - 1;
+    cache_p->buckets_p = malloc(bucket_count * sizeof(size_t));
+    cache_p->entries_p = malloc(capacity * sizeof(query_cache_entry_type));
+    cache_p->matches_p = malloc(capacity * k * sizeof(fuzzy_match_type));
+    if (cache_p->buckets_p == NULL || cache_p->entries_p == NULL || cache_p->matches_p == NULL) {
+        query_cache_destroy(cache_p);
+        return NULL;
+    }
+    for (size_t i = 0; i < bucket_count; i++) {
+        cache_p->buckets_p[i] = QUERY_CACHE_NIL;
+    }
+    cache_p->lru_head = cache_p->lru_tail = QUERY_CACHE_NIL;
+    return cache_p;
+}
+
+void query_cache_destroy(query_cache_type* cache_p) {
+    if (cache_p == NULL) {
+        return;
+    }
+    for (size_t i = 0; i < cache_p->count; i++) {
+        free(cache_p->entries_p[i].query_p);
+    }
+    free(cache_p->matches_p);
+    free(cache_p->entries_p);
+    free(cache_p->buckets_p);
+    free(cache_p);
+}
+
+query_cache_stats_type query_cache_stats(const query_cache_type* cache_p) {
+    return cache_p->stats;
+}
+
+static size_t query_cache_find(const query_cache_type* cache_p, const char* query_p, size_t query_len, uint64_t hash) {
+    size_t index = cache_p->buckets_p[hash & cache_p->bucket_mask];
+    while (index != QUERY_CACHE_NIL) {
+        const query_cache_entry_type* entry_p = &cache_p->entries_p[index];
+        if (entry_p->hash == hash && entry_p->query_len == query_len && memcmp(entry_p->query_p, query_p, query_len) == 0) {
+            return index;
+        }
+        index = entry_p->next_in_bucket;
+    }
+    return QUERY_CACHE_NIL;
+}
+
+static void query_cache_lru_unlink(query_cache_type* cache_p, size_t index) {
+    query_cache_entry_type* entry_p = &cache_p->entries_p[index];
+    if (entry_p->lru_prev != QUERY_CACHE_NIL) {
+        cache_p->entries_p[entry_p->lru_prev].lru_next = entry_p->lru_next;
+    } else {
+        cache_p->lru_head = entry_p->lru_next;
+    }
+    if (entry_p->lru_next != QUERY_CACHE_NIL) {
+        cache_p->entries_p[entry_p->lru_next].lru_prev = entry_p->lru_prev;
+    } else {
+        cache_p->lru_tail = entry_p->lru_prev;
+    }
+}
+
+static void query_cache_lru_push_front(query_cache_type* cache_p, size_t index) {
+    query_cache_entry_type* entry_p = &cache_p->entries_p[index];
+    entry_p->lru_prev = QUERY_CACHE_NIL;
+    entry_p->lru_next = cache_p->lru_head;
+    if (cache_p->lru_head != QUERY_CACHE_NIL) {
+        cache_p->entries_p[cache_p->lru_head].lru_prev = index;
+    } else {
+        cache_p->lru_tail = index;
+    }
+    cache_p->lru_head = index;
+}
+
+// free the least recently used entry and return its slot.
+static size_t query_cache_evict(query_cache_type* cache_p) {
+    size_t index = cache_p->lru_tail;
+    query_cache_entry_type* entry_p = &cache_p->entries_p[index];
+    query_cache_lru_unlink(cache_p, index);
+
+    size_t* link_p = &cache_p->buckets_p[entry_p->hash & cache_p->bucket_mask];
+    while (*link_p != index) {
+        link_p = &cache_p->entries_p[*link_p].next_in_bucket;
+    }
+    *link_p = entry_p->next_in_bucket;
+
+    free(entry_p->query_p);
+    cache_p->stats.evictions++;
+    return index;
+}
+
+bool query_cache_get(query_cache_type* cache_p, const char* query_p, fuzzy_match_type* matches_p, size_t* match_count_p) {
+    size_t query_len = strlen(query_p);
+    uint64_t hash = wyhash((const unsigned char*)query_p, query_len, 0);
+    size_t index = query_cache_find(cache_p, query_p, query_len, hash);
+    if (index == QUERY_CACHE_NIL) {
+        cache_p->stats.misses++;
+        return false;
+    }
+    cache_p->stats.hits++;
+    if (index != cache_p->lru_head) {
+        query_cache_lru_unlink(cache_p, index);
+        query_cache_lru_push_front(cache_p, index);
+    }
+    *match_count_p = cache_p->entries_p[index].match_count;
+    memcpy(matches_p, &cache_p->matches_p[index * cache_p->k], *match_count_p * sizeof(fuzzy_match_type));
+    return true;
+}
+
+void query_cache_put(query_cache_type* cache_p, const char* query_p, const fuzzy_match_type* matches_p,
+                     size_t match_count) {
+    size_t query_len = strlen(query_p);
+    char* copy_p = malloc(query_len + 1);
+    if (copy_p == NULL) {
+        return;
+    }
+    memcpy(copy_p, query_p, query_len + 1);
+    uint64_t hash = wyhash((const unsigned char*)query_p, query_len, 0);
+    match_count = match_count < cache_p->k ? match_count : cache_p->k;
+
+    size_t index = cache_p->count < cache_p->capacity ? cache_p->count++ : query_cache_evict(cache_p);
+    cache_p->entries_p[index] = (query_cache_entry_type){.query_p = copy_p,
+                                                         .query_len = query_len,
+                                                         .hash = hash,
+                                                         .next_in_bucket = cache_p->buckets_p[hash & cache_p->bucket_mask],
+                                                         .match_count = match_count};
+    memcpy(&cache_p->matches_p[index * cache_p->k], matches_p, match_count * sizeof(fuzzy_match_type));
+    cache_p->buckets_p[hash & cache_p->bucket_mask] = index;
+    query_cache_lru_push_front(cache_p, index);
+}
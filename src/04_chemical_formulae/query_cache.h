@@ -0,0 +1,31 @@
+#pragma once
+
+#include <stdbool.h> // bool
+#include <stddef.h>  // size_t
+
+#include "fuzzy.h" // fuzzy_match_type
+
+// bounded LRU cache of the fuzzy matches of recent queries. the matched keys are not copied, so they must outlive the
+// cache. not thread-safe.
+typedef struct query_cache_type query_cache_type;
+
+typedef struct {
+    size_t hits;
+    size_t misses;
+    size_t evictions;
+} query_cache_stats_type;
+
+// a cache of `capacity` queries with up to `k` matches each.
+query_cache_type* query_cache_create(size_t capacity, size_t k);
+
+void query_cache_destroy(query_cache_type* cache_p);
+
+// copy the matches of `query_p` to `matches_p` and make it the most recently used query. false if it is not cached.
+bool query_cache_get(query_cache_type* cache_p, const char* query_p, fuzzy_match_type* matches_p, size_t* match_count_p);
+
+// cache up to k matches of a query that is not cached yet, evicting the least recently used query if the cache is
+// full. on allocation failure nothing is cached.
+void query_cache_put(query_cache_type* cache_p, const char* query_p, const fuzzy_match_type* matches_p,
+                     size_t match_count);
+
+query_cache_stats_type query_cache_stats(const query_cache_type* cache_p);
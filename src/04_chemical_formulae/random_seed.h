@@ -0,0 +1,23 @@
+/*
+    a per-map hash seed, shared by the strmap variants so they seed the same way.
+*/
+
+#pragma once
+
+#include <stdint.h> // uint64_t, uintptr_t
+#include <time.h>   // clock_gettime
+
+#include <sys/random.h> // getrandom
+
+#include "wyhash.h" // wymix, WYHASH_SECRET
+
+// a random seed from the kernel, or from the clock and an address if there is none.
+static inline uint64_t random_seed(const void* p) {
+    uint64_t seed;
+    if (getrandom(&seed, sizeof(seed), GRND_NONBLOCK) == sizeof(seed)) {
+        return seed;
+    }
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return wymix((uint64_t)ts.tv_sec ^ WYHASH_SECRET[0], (uint64_t)ts.tv_nsec ^ (uint64_t)(uintptr_t)p);
+}
@@ -0,0 +1,199 @@
+#include <fcntl.h>   // open, O_RDONLY
+#include <stdalign.h> // alignof
+#include <stdbool.h> // bool, true, false
+#include <stdint.h>  // uint32_t, uint64_t, UINT32_MAX
+#include <stdio.h>   // fopen, fwrite, fclose, FILE
+#include <stdlib.h>  // calloc, malloc, free, size_t
+#include <string.h>  // memcmp, memcpy, strcmp, strlen
+
+#include <sys/mman.h> // mmap, munmap
+#include <sys/stat.h> // fstat
+#include <unistd.h>   // close
+
+#include "snapshot.h"
+#include "strmap.h" // strmap_type, strmap_for_each, strmap_get_count
+#include "wyhash.h" // wyhash
+
+// round up to the alignment of the slots, which is the strictest in the file
+static inline uint64_t align_up(uint64_t offset) {
+    return (offset + alignof(snapshot_slot_type) - 1) & ~(uint64_t)(alignof(snapshot_slot_type) - 1);
+}
+
+bool snapshot_write(const char* path, const strmap_type* strmap_p) {
+    size_t count = strmap_get_count(strmap_p);
+
+    // the string pool holds every key followed by its value
+    uint64_t pool_size = 0;
+    {
+        size_t list_index;
+        strmap_node_type* node_p = NULL;
+        const char* key_p = NULL;
+        const char* value_p = NULL;
+
+        (void)(key_p);
+        (void)(value_p);
+
+        strmap_for_each(strmap_p, list_index, node_p, key_p, value_p) {
+            pool_size += node_p->key_len + 1 + node_p->value_len + 1;
+        }
+    }
+    if (pool_size >= UINT32_MAX) {
+        return false;
+    }
+    uint64_t slot_count = 16;
+    while (slot_count < 2 * (uint64_t)count) {
+        slot_count <<= 1;
+    }
+
+    snapshot_header_type header = {
+        .magic = SNAPSHOT_MAGIC,
+        .version = SNAPSHOT_VERSION,
+        .byte_order = SNAPSHOT_BYTE_ORDER,
+        .seed = strmap_p->seed,
+        .key_count = count,
+        .slot_count = slot_count,
+    };
+    header.slots_offset = align_up(sizeof(header));
+    header.keys_offset = header.slots_offset + slot_count * sizeof(snapshot_slot_type);
+    header.pool_offset = header.keys_offset + count * sizeof(uint32_t);
+    header.pool_size = pool_size;
+    header.file_size = header.pool_offset + pool_size;
+
+    unsigned char* data_p = calloc(header.file_size, 1);
+    if (data_p == NULL) {
+        return false;
+    }
+    memcpy(data_p, &header, sizeof(header));
+    snapshot_slot_type* slots_p = (snapshot_slot_type*)&data_p[header.slots_offset];
+    uint32_t* keys_p = (uint32_t*)&data_p[header.keys_offset];
+    char* pool_p = (char*)&data_p[header.pool_offset];
+    for (uint64_t i = 0; i < slot_count; i++) {
+        slots_p[i].key_offset = SNAPSHOT_EMPTY_SLOT;
+    }
+
+    // nodes keep the hash of their key under the seed of the map, so keys are not rehashed
+    {
+        size_t key_index = 0;
+        uint32_t pool_offset = 0;
+        size_t list_index;
+        strmap_node_type* node_p = NULL;
+        const char* key_p = NULL;
+        const char* value_p = NULL;
+        strmap_for_each(strmap_p, list_index, node_p, key_p, value_p) {
+            size_t key_size = node_p->key_len + 1;
+            size_t value_size = node_p->value_len + 1;
+            memcpy(&pool_p[pool_offset], key_p, key_size);
+            memcpy(&pool_p[pool_offset + key_size], value_p, value_size);
+
+            uint64_t index = node_p->hash & (slot_count - 1);
+            while (slots_p[index].key_offset != SNAPSHOT_EMPTY_SLOT) {
+                index = (index + 1) & (slot_count - 1);
+            }
+            slots_p[index] = (snapshot_slot_type){
+                .hash = node_p->hash, .key_offset = pool_offset, .value_offset = pool_offset + (uint32_t)key_size};
+            keys_p[key_index++] = pool_offset;
+            pool_offset += (uint32_t)(key_size + value_size);
+        }
+    }
+
+    bool res = false;
+    FILE* fp = fopen(path, "wb");
+    if (fp != NULL) {
+        res = fwrite(data_p, 1, header.file_size, fp) == header.file_size;
+        res = fclose(fp) == 0 && res;
+    }
+    free(data_p);
+    return res;
+}
+
+// check that every section lies within the file, so lookups only need to trust the offsets in the slots and keys
+static bool snapshot_validate(const snapshot_header_type* header_p, size_t size) {
+    if (size < sizeof(snapshot_header_type) || memcmp(header_p->magic, SNAPSHOT_MAGIC, sizeof(header_p->magic)) != 0 ||
+        header_p->version != SNAPSHOT_VERSION || header_p->byte_order != SNAPSHOT_BYTE_ORDER || header_p->file_size != size) {
+        return false;
+    }
+    uint64_t slot_count = header_p->slot_count;
+    if (slot_count == 0 || (slot_count & (slot_count - 1)) != 0 || slot_count <= header_p->key_count ||
+        header_p->slots_offset % alignof(snapshot_slot_type) != 0 || header_p->slots_offset < sizeof(snapshot_header_type) ||
+        header_p->slots_offset > size || (size - header_p->slots_offset) / sizeof(snapshot_slot_type) < slot_count) {
+        return false;
+    }
+    if (header_p->keys_offset != header_p->slots_offset + slot_count * sizeof(snapshot_slot_type) ||
+        (size - header_p->keys_offset) / sizeof(uint32_t) < header_p->key_count) {
+        return false;
+    }
+    if (header_p->pool_offset != header_p->keys_offset + header_p->key_count * sizeof(uint32_t) ||
+        header_p->pool_size != size - header_p->pool_offset) {
+        return false;
+    }
+    // a null character at the end of the pool ends every string in it
+    return header_p->pool_size == 0 ? header_p->key_count == 0 : ((const char*)header_p)[size - 1] == '\0';
+}
+
+bool snapshot_open(snapshot_type* snapshot_p, const char* path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return false;
+    }
+    size_t size = (size_t)st.st_size;
+    void* data_p = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data_p == MAP_FAILED) {
+        return false;
+    }
+    const snapshot_header_type* header_p = data_p;
+    if (!snapshot_validate(header_p, size)) {
+        munmap(data_p, size);
+        return false;
+    }
+    const unsigned char* bytes_p = data_p;
+    *snapshot_p = (snapshot_type){
+        .data_p = data_p,
+        .size = size,
+        .header_p = header_p,
+        .slots_p = (const snapshot_slot_type*)&bytes_p[header_p->slots_offset],
+        .keys_p = (const uint32_t*)&bytes_p[header_p->keys_offset],
+        .pool_p = (const char*)&bytes_p[header_p->pool_offset],
+    };
+    return true;
+}
+
+void snapshot_close(snapshot_type* snapshot_p) {
+    munmap(snapshot_p->data_p, snapshot_p->size);
+    *snapshot_p = (snapshot_type){0};
+}
+
+size_t snapshot_get_count(const snapshot_type* snapshot_p) {
+    return snapshot_p->header_p->key_count;
+}
+
+const char* snapshot_get(const snapshot_type* snapshot_p, const char* key_p) {
+    const snapshot_header_type* header_p = snapshot_p->header_p;
+    uint64_t hash = wyhash((const unsigned char*)key_p, strlen(key_p), header_p->seed);
+    uint64_t mask = header_p->slot_count - 1;
+
+    // a written snapshot uses at most half of the slots, so the probe ends at an empty slot. the file may not have been
+    // written by `snapshot_write`, so it is also bounded by the number of slots.
+    uint64_t index = hash & mask;
+    for (uint64_t step = 0; step < header_p->slot_count; step++, index = (index + 1) & mask) {
+        const snapshot_slot_type* slot_p = &snapshot_p->slots_p[index];
+        if (slot_p->key_offset == SNAPSHOT_EMPTY_SLOT) {
+            return NULL;
+        }
+        if (slot_p->hash == hash && slot_p->key_offset < header_p->pool_size && slot_p->value_offset < header_p->pool_size &&
+            strcmp(&snapshot_p->pool_p[slot_p->key_offset], key_p) == 0) {
+            return &snapshot_p->pool_p[slot_p->value_offset];
+        }
+    }
+    return NULL;
+}
+
+const char* snapshot_key(const snapshot_type* snapshot_p, size_t index) {
+    uint32_t offset = snapshot_p->keys_p[index];
+    return offset < snapshot_p->header_p->pool_size ? &snapshot_p->pool_p[offset] : "";
+}
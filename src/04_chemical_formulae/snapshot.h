@@ -0,0 +1,63 @@
+#pragma once
+
+#include <stdbool.h> // bool
+#include <stddef.h>  // size_t
+#include <stdint.h>  // uint32_t, uint64_t
+
+#include "strmap.h" // strmap_type
+
+// read-only dictionary snapshot, written once from a `strmap` and mapped into memory at startup. lookups are served
+// from the mapping, with no parsing or allocation. the file is:
+//   header
+//   slots:  `slot_count` slots of an open-addressing table with linear probing, each with the full hash of its key and
+//           the offsets of the key and value in the string pool
+//   keys:   `key_count` offsets of the keys in the string pool, in the order they were written
+//   pool:   every key and its value, each null-terminated
+// hashes are wyhash with the seed in the header. all integers are in the byte order of the writer, which is checked.
+
+#define SNAPSHOT_MAGIC "CHEMSNAP"
+#define SNAPSHOT_VERSION 1
+#define SNAPSHOT_BYTE_ORDER 0x01020304
+#define SNAPSHOT_EMPTY_SLOT UINT32_MAX
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint64_t seed;
+    uint64_t key_count;
+    uint64_t slot_count; // a power of two
+    uint64_t slots_offset;
+    uint64_t keys_offset;
+    uint64_t pool_offset;
+    uint64_t pool_size;
+    uint64_t file_size;
+} snapshot_header_type;
+
+typedef struct {
+    uint64_t hash;
+    uint32_t key_offset; // SNAPSHOT_EMPTY_SLOT if the slot is empty
+    uint32_t value_offset;
+} snapshot_slot_type;
+
+typedef struct {
+    void* data_p;
+    size_t size;
+    const snapshot_header_type* header_p;
+    const snapshot_slot_type* slots_p;
+    const uint32_t* keys_p;
+    const char* pool_p;
+} snapshot_type;
+
+bool snapshot_write(const char* path, const strmap_type* strmap_p);
+
+bool snapshot_open(snapshot_type* snapshot_p, const char* path);
+
+void snapshot_close(snapshot_type* snapshot_p);
+
+size_t snapshot_get_count(const snapshot_type* snapshot_p);
+
+const char* snapshot_get(const snapshot_type* snapshot_p, const char* key_p);
+
+// the key at `index`, below the count.
+const char* snapshot_key(const snapshot_type* snapshot_p, size_t index);
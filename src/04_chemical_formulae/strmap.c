@@ -19,13 +19,21 @@
  */
 
 /*
-    `strmap` is an implementation of string-to-string hash table using chaining.
+    `strmap` is an implementation of string-to-string hash table using open addressing.
 
-    The hash function is hard coded to `fnv_hash64`, and the hash table is resized when the chain length
-    exceeds a fixed number of nodes.
+    The layout follows SwissTable: every slot has a control byte, which is either empty, deleted, or the low 7 bits of
+    the hash of the key in the slot. Lookups scan a group of control bytes at once (16 with SSE2, otherwise 8 within a
+    64-bit word), and only slots with a matching control byte are checked. The full 64-bit hash is stored in every node
+    and compared before the keys, so most mismatches never touch key memory, and resizing never rehashes keys.
 
-    Buckets are implemented as linked lists for simplicity, but may be replaced by fixed size arrays for additional
-    performance.
+    Groups are probed quadratically. The table is rehashed when more than 7/8 of the slots would be in use, counting
+    deleted slots. It doubles in size unless deleted slots account for enough of the load, in which case it is rehashed
+    in place, and it halves when a quarter of the load is left. Rehashing is incremental: the old table stays live, and
+    every insertion or deletion moves a few of its slots to the new table.
+
+    The hash function is wyhash (final version 4), which reads the key 8 or 16 bytes at a time. Every map has its own
+    random seed, so colliding key sets cannot be prepared in advance. Maps with the same seed, set with
+    `strmap_set_seed`, accept the same precomputed hashes.
 
     Strings are expected to have a null character (`\0` byte) at the end. Otherwise the functions may loop
     forever. Be careful about user inputs if security is important.
@@ -34,38 +42,210 @@
 #include <assert.h>   // static_assert
 #include <stdalign.h> // alignof
 #include <stdbool.h>  // bool, true, false
-#include <stdint.h>   // uint64_t
+#include <stdint.h>   // uint64_t, uint32_t, int8_t
 #include <stdlib.h>   // size_t, SIZE_MAX
-#include <string.h>   // strcmp, strdup, strcpy
+#include <string.h>   // strcmp, strlen, memcpy, memmove, memset
+#include <time.h>     // clock_gettime
+
+#if defined(__SSE2__)
+#include <emmintrin.h> // _mm_*
+#endif
 
 #include "allocator_function_types.h" // allocate_f, reallocate_f, deallocate_f
 #include "std_allocator.h"            // std_allocate, std_reallocate, std_deallocate
 
-#include "is_pow2.h" // is_pow2
+#include "is_pow2.h"     // is_pow2
+#include "random_seed.h" // random_seed
 #include "strmap.h"
+#include "wyhash.h" // wyhash
 
 #define INITIAL_CAPACITY 16
-#define MAX_CHAIN_LENGTH 5
+
+#if defined(__SSE2__)
+#define GROUP_WIDTH 16
+#else
+#define GROUP_WIDTH 8
+#endif
 
 static_assert(INITIAL_CAPACITY != 1, "subtracting initial capacity by one does not yield zero");
 static_assert(INITIAL_CAPACITY != 0 && (INITIAL_CAPACITY & (INITIAL_CAPACITY - 1)) == 0, "initial capacity is a power of 2");
+static_assert(INITIAL_CAPACITY >= GROUP_WIDTH, "initial capacity fits a group");
+
+static inline uint64_t strmap_hash_with_len(const strmap_type* strmap_p, const char* key_p, size_t key_len) {
+    return wyhash((const unsigned char*)key_p, key_len, strmap_p->seed);
+}
+
+uint64_t strmap_hash(const strmap_type* strmap_p, const char* key_p) {
+    assert(strmap_p != NULL);
+    assert(key_p != NULL);
+
+    return strmap_hash_with_len(strmap_p, key_p, strlen(key_p));
+}
+
+// split the hash into the probe start (h1) and the control byte (h2).
+#define h1(hash) ((size_t)((hash) >> 7))
+#define h2(hash) ((int8_t)((hash)&0x7F))
+
+// group operations. a match is a bitmask with one bit (SSE2) or one byte (SWAR) per matching control byte, iterated
+// with `bitmask_next`.
+#if defined(__SSE2__)
+
+typedef __m128i group_type;
+typedef uint32_t bitmask_type;
+
+static inline group_type group_load(const int8_t* ctrl_p) {
+    return _mm_loadu_si128((const __m128i*)ctrl_p);
+}
 
-uint64_t fnvhash(const unsigned char* char_p) {
-    // FNV-1a hash
-    // https://en.wikipedia.org/wiki/Fowler–Noll–Vo_hash_function
+static inline bitmask_type group_match(group_type group, int8_t h2) {
+    return (bitmask_type)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), group));
+}
+
+static inline bitmask_type group_match_empty(group_type group) {
+    return (bitmask_type)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(STRMAP_CTRL_EMPTY), group));
+}
+
+static inline bitmask_type group_match_empty_or_deleted(group_type group) {
+    // the only control bytes with the sign bit set
+    return (bitmask_type)_mm_movemask_epi8(group);
+}
+
+static inline size_t bitmask_next(bitmask_type* mask_p) {
+    size_t index = (size_t)__builtin_ctz(*mask_p);
+    *mask_p &= *mask_p - 1;
+    return index;
+}
 
-    assert(char_p != NULL);
+// index of the last match. the mask must not be empty.
+static inline size_t bitmask_last(bitmask_type mask) {
+    return 31 - (size_t)__builtin_clz(mask);
+}
 
-    static const uint64_t FNV_OFFSET = 14695981039346656037UL;
-    static const uint64_t FNV_PRIME = 1099511628211UL;
+#else
 
-    uint64_t hash = FNV_OFFSET;
-    while (*char_p != '\0') {
-        hash ^= *(char_p++);
-        hash *= FNV_PRIME;
+typedef uint64_t group_type;
+typedef uint64_t bitmask_type;
+
+#define LSBS 0x0101010101010101UL
+#define MSBS 0x8080808080808080UL
+
+static inline group_type group_load(const int8_t* ctrl_p) {
+    uint64_t group;
+    memcpy(&group, ctrl_p, sizeof(group));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    group = __builtin_bswap64(group);
+#endif
+    return group;
+}
+
+static inline bitmask_type group_match(group_type group, int8_t h2) {
+    // may report false positives, which are rejected by the hash comparison
+    uint64_t x = group ^ (LSBS * (uint8_t)h2);
+    return (x - LSBS) & ~x & MSBS;
+}
+
+static inline bitmask_type group_match_empty(group_type group) {
+    // empty is the only control byte with bit 7 set and bit 1 clear
+    return group & (~group << 6) & MSBS;
+}
+
+static inline bitmask_type group_match_empty_or_deleted(group_type group) {
+    return group & MSBS;
+}
+
+static inline size_t bitmask_next(bitmask_type* mask_p) {
+    size_t index = (size_t)__builtin_ctzll(*mask_p) >> 3;
+    *mask_p &= *mask_p - 1;
+    return index;
+}
+
+// index of the last match. the mask must not be empty.
+static inline size_t bitmask_last(bitmask_type mask) {
+    return (63 - (size_t)__builtin_clzll(mask)) >> 3;
+}
+
+#endif
+
+// 7/8 of the slots may be in use before the table is rehashed.
+static inline size_t max_load(size_t capacity) {
+    return capacity - capacity / 8;
+}
+
+// slots of the old table moved to the new table by every insertion or deletion while resizing. the new table has room
+// for at least capacity / 64 more nodes when the resize starts, so the old table is emptied before the new one fills.
+#define MIGRATE_SLOTS_COUNT 64
+
+// the least power of two at least `min_capacity` with room for `count` nodes, or 0 on overflow.
+static size_t capacity_for(size_t count, size_t min_capacity) {
+    size_t capacity = min_capacity;
+    while (max_load(capacity) < count) {
+        if (capacity > SIZE_MAX / 2) {
+            return 0;
+        }
+        capacity <<= 1;
     }
+    return capacity;
+}
+
+// size of the block holding the strings that do not fit in a node, or 0.
+static inline size_t strmap_node_block_size(size_t key_len, size_t value_len) {
+    bool key_inline = key_len < STRMAP_NODE_INLINE_SIZE;
+    bool value_inline = key_inline && key_len + value_len + 2 <= STRMAP_NODE_INLINE_SIZE;
+    return (key_inline ? 0 : key_len + 1) + (value_inline ? 0 : value_len + 1);
+}
 
-    return hash;
+static inline bool strmap_is_resizing(const strmap_type* strmap_p) {
+    return strmap_p->old_table.capacity != 0;
+}
+
+// set a control byte, and its copy after the end of the table if it is in the first group.
+static inline void table_set_ctrl(strmap_table_type* table_p, size_t index, int8_t ctrl) {
+    table_p->ctrl_arr_p[index] = ctrl;
+    table_p->ctrl_arr_p[((index - GROUP_WIDTH) & (table_p->capacity - 1)) + GROUP_WIDTH] = ctrl;
+}
+
+#ifdef STRMAP_STATS
+
+#define stats_add(strmap_p, field, n) ((strmap_p)->stats.field += (n))
+#define stats_sub(strmap_p, field, n) ((strmap_p)->stats.field -= (n))
+
+static inline uint64_t stats_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+#define stats_timer_start() uint64_t stats_start_ns = stats_now_ns()
+#define stats_timer_stop(strmap_p) stats_add(strmap_p, resize_ns, stats_now_ns() - stats_start_ns)
+
+#else
+
+#define stats_add(strmap_p, field, n) ((void)0)
+#define stats_sub(strmap_p, field, n) ((void)0)
+#define stats_timer_start() ((void)0)
+#define stats_timer_stop(strmap_p) ((void)0)
+
+#endif
+
+// allocate the slots and control bytes of a table with `capacity` empty slots.
+static bool strmap_alloc_table(strmap_type* strmap_p, strmap_table_type* table_p, size_t capacity) {
+    if (capacity > (SIZE_MAX - GROUP_WIDTH) / (sizeof(strmap_node_type) + 1)) {
+        return false;
+    }
+    size_t nodes_size = capacity * sizeof(strmap_node_type);
+    strmap_node_type* nodes_p =
+        strmap_p->allocate_f_p(strmap_p->allocator_struct_p, alignof(strmap_node_type), nodes_size + capacity + GROUP_WIDTH);
+    if (nodes_p == NULL) {
+        return false;
+    }
+    table_p->nodes_arr_p = nodes_p;
+    table_p->ctrl_arr_p = (int8_t*)((char*)nodes_p + nodes_size);
+    memset(table_p->ctrl_arr_p, (uint8_t)STRMAP_CTRL_EMPTY, capacity + GROUP_WIDTH);
+    table_p->capacity = capacity;
+    table_p->growth_left = max_load(capacity);
+    stats_add(strmap_p, node_bytes, nodes_size);
+    stats_add(strmap_p, ctrl_bytes, capacity + GROUP_WIDTH);
+    return true;
 }
 
 bool strmap_init_with_initial_capacity(strmap_type** strmap_pp, size_t pow2_capacity, void* allocator_struct_p,
@@ -74,31 +254,29 @@ bool strmap_init_with_initial_capacity(strmap_type** strmap_pp, size_t pow2_capa
     assert(is_pow2(pow2_capacity) && "initial capacity is a power of 2");
     assert(pow2_capacity - 1 != 0 && "subtracting initial capacity by one does not yield zero");
 
-    *strmap_pp = NULL;
-    if (pow2_capacity > SIZE_MAX / sizeof(strmap_node_list_type)) {
-        return NULL;
-    }
     *strmap_pp = allocate_f_p(allocator_struct_p, alignof(strmap_type), sizeof(strmap_type));
     if (*strmap_pp == NULL) {
         return false;
     }
-    (*strmap_pp)->lists_arr_p =
-        allocate_f_p(allocator_struct_p, alignof(strmap_node_list_type), pow2_capacity * sizeof(strmap_node_list_type));
-    if ((*strmap_pp)->lists_arr_p == NULL) {
-        deallocate_f_p(allocator_struct_p, *strmap_pp);
-        *strmap_pp = NULL;
-        return false;
-    }
-    (*strmap_pp)->list_count = pow2_capacity;
-    for (size_t i = 0; i < (*strmap_pp)->list_count; i++) {
-        (*strmap_pp)->lists_arr_p[i] = (strmap_node_list_type){.head_p = NULL, .tail_p = NULL, .node_count = 0};
-    }
-    (*strmap_pp)->total_nodes_count = 0;
-
     (*strmap_pp)->allocator_struct_p = allocator_struct_p;
     (*strmap_pp)->allocate_f_p = allocate_f_p;
     (*strmap_pp)->reallocate_f_p = reallocate_f_p;
     (*strmap_pp)->deallocate_f_p = deallocate_f_p;
+    (*strmap_pp)->seed = random_seed(*strmap_pp);
+#ifdef STRMAP_STATS
+    (*strmap_pp)->stats = (strmap_stats_type){0};
+#endif
+
+    if (!strmap_alloc_table(*strmap_pp, &(*strmap_pp)->table, pow2_capacity < GROUP_WIDTH ? GROUP_WIDTH : pow2_capacity)) {
+        if (deallocate_f_p != NULL) {
+            deallocate_f_p(allocator_struct_p, *strmap_pp);
+        }
+        *strmap_pp = NULL;
+        return false;
+    }
+    (*strmap_pp)->old_table = (strmap_table_type){0};
+    (*strmap_pp)->migrated_count = 0;
+    (*strmap_pp)->total_nodes_count = 0;
 
     return true;
 }
@@ -121,325 +299,553 @@ void strmap_destroy(strmap_type* strmap_p) {
     void* allocator_struct_p = strmap_p->allocator_struct_p;
     deallocate_f deallocate_f_p = strmap_p->deallocate_f_p;
 
-    // iterate through lists
-    for (size_t i = 0; i < strmap_p->list_count; i++) {
-        strmap_node_type* node_p = strmap_p->lists_arr_p[i].head_p;
-        strmap_node_type* next_p = NULL;
-
-        // traverse list and free nodes one by one
-        while (node_p != NULL) {
-            next_p = node_p->next_p;
-
-            deallocate_f_p(allocator_struct_p, node_p->key_p);
-            deallocate_f_p(allocator_struct_p, node_p->value_p);
-            deallocate_f_p(allocator_struct_p, node_p);
+    // without a deallocate function, everything is released with the allocator (e.g. an arena)
+    if (deallocate_f_p == NULL) {
+        return;
+    }
 
-            node_p = next_p;
+    // strings that do not fit in a node are in one block
+    strmap_table_type* tables_p[] = {&strmap_p->table, &strmap_p->old_table};
+    for (size_t t = 0; t < 2; t++) {
+        for (size_t i = 0; i < tables_p[t]->capacity; i++) {
+            if (tables_p[t]->ctrl_arr_p[i] >= 0 && tables_p[t]->nodes_arr_p[i].block_p != NULL) {
+                deallocate_f_p(allocator_struct_p, tables_p[t]->nodes_arr_p[i].block_p);
+            }
+        }
+        if (tables_p[t]->capacity != 0) {
+            deallocate_f_p(allocator_struct_p, tables_p[t]->nodes_arr_p);
         }
     }
-
-    deallocate_f_p(allocator_struct_p, strmap_p->lists_arr_p);
     deallocate_f_p(allocator_struct_p, strmap_p);
 }
 
+static inline void strmap_deallocate(const strmap_type* strmap_p, void* ptr) {
+    if (strmap_p->deallocate_f_p != NULL) {
+        strmap_p->deallocate_f_p(strmap_p->allocator_struct_p, ptr);
+    }
+}
+
 size_t strmap_get_count(const strmap_type* strmap_p) {
     return strmap_p->total_nodes_count;
 }
 
-bool strmap_contains(const strmap_type* strmap_p, const char* key_p) {
+bool strmap_set_seed(strmap_type* strmap_p, uint64_t seed) {
     assert(strmap_p != NULL);
-    assert(key_p != NULL);
 
-    uint64_t hash = fnvhash((unsigned char*)key_p);
-    uint64_t index = hash & (strmap_p->list_count - 1);
-
-    strmap_node_type* node_p = strmap_p->lists_arr_p[index].head_p;
+    // the stored hashes would be stale
+    if (strmap_p->total_nodes_count != 0) {
+        return false;
+    }
+    strmap_p->seed = seed;
+    return true;
+}
 
-    while (node_p != NULL) {
-        if (strcmp(node_p->key_p, key_p) == 0) {
-            return true;
+// return the slot holding `key_p`, or SIZE_MAX.
+static size_t table_find(const strmap_table_type* table_p, const char* key_p, size_t key_len, uint64_t hash) {
+    size_t mask = table_p->capacity - 1;
+    size_t pos = h1(hash) & mask;
+    size_t stride = 0;
+
+    while (true) {
+        group_type group = group_load(&table_p->ctrl_arr_p[pos]);
+        bitmask_type match = group_match(group, h2(hash));
+        while (match != 0) {
+            size_t index = (pos + bitmask_next(&match)) & mask;
+            const strmap_node_type* node_p = &table_p->nodes_arr_p[index];
+            if (node_p->hash == hash && node_p->key_len == key_len && memcmp(strmap_node_key(node_p), key_p, key_len) == 0) {
+                return index;
+            }
         }
-        node_p = node_p->next_p;
+        // the key would have been inserted here
+        if (group_match_empty(group) != 0) {
+            return SIZE_MAX;
+        }
+        stride += GROUP_WIDTH;
+        pos = (pos + stride) & mask;
     }
-
-    return false;
 }
 
-const char* strmap_get(const strmap_type* strmap_p, const char* key_p) {
-    assert(strmap_p != NULL);
-    assert(key_p != NULL);
-
-    uint64_t hash = fnvhash((const unsigned char*)key_p);
-    uint64_t index = hash & (strmap_p->list_count - 1);
+// return the first empty or deleted slot on the probe sequence of `hash`.
+static size_t table_find_insert_slot(const strmap_table_type* table_p, uint64_t hash) {
+    size_t mask = table_p->capacity - 1;
+    size_t pos = h1(hash) & mask;
+    size_t stride = 0;
 
-    strmap_node_type* node_p = strmap_p->lists_arr_p[index].head_p;
-
-    while (node_p != NULL) {
-        if (strcmp(node_p->key_p, key_p) == 0) {
-            return node_p->value_p;
+    while (true) {
+        bitmask_type match = group_match_empty_or_deleted(group_load(&table_p->ctrl_arr_p[pos]));
+        if (match != 0) {
+            return (pos + bitmask_next(&match)) & mask;
         }
-        node_p = node_p->next_p;
+        stride += GROUP_WIDTH;
+        pos = (pos + stride) & mask;
     }
-
-    return STRMAP_GET_VALUE_DEFAULT;
 }
 
-bool strmap_del(strmap_type* strmap_p, const char* key_p) {
-    assert(strmap_p != NULL);
-    assert(key_p != NULL);
-
-    uint64_t hash = fnvhash((unsigned char*)key_p);
-    uint64_t index = hash & (strmap_p->list_count - 1);
-
-    strmap_node_type* node_p = strmap_p->lists_arr_p[index].head_p;
+// store a node whose key is not in the table yet. the table must have growth left.
+static void table_insert_node(strmap_table_type* table_p, const strmap_node_type* node_p) {
+    size_t index = table_find_insert_slot(table_p, node_p->hash);
+    table_p->growth_left -= table_p->ctrl_arr_p[index] == STRMAP_CTRL_EMPTY;
+    table_set_ctrl(table_p, index, h2(node_p->hash));
+    table_p->nodes_arr_p[index] = *node_p;
+}
 
-    if (node_p == NULL) {
-        return false;
+// free the slot of a node.
+static void table_erase(strmap_table_type* table_p, size_t index) {
+    // probing stops at the first group with an empty slot. if the run of non-empty slots around this one is shorter
+    // than a group, no probe can have passed over it, and it may become empty again. otherwise it is marked deleted.
+    size_t mask = table_p->capacity - 1;
+    bitmask_type empty_after = group_match_empty(group_load(&table_p->ctrl_arr_p[index]));
+    bitmask_type empty_before = group_match_empty(group_load(&table_p->ctrl_arr_p[(index - GROUP_WIDTH) & mask]));
+    if (empty_after != 0 && empty_before != 0 &&
+        bitmask_next(&empty_after) + (GROUP_WIDTH - 1 - bitmask_last(empty_before)) < GROUP_WIDTH) {
+        table_set_ctrl(table_p, index, STRMAP_CTRL_EMPTY);
+        table_p->growth_left++;
+    } else {
+        table_set_ctrl(table_p, index, STRMAP_CTRL_DELETED);
     }
+}
 
-    // check if key matches with the head of the list
-    if (strcmp(node_p->key_p, key_p) == 0) {
-        strmap_p->lists_arr_p[index].head_p = node_p->next_p;
-        if (strmap_p->lists_arr_p[index].head_p == NULL) {
-            strmap_p->lists_arr_p[index].tail_p = NULL;
-        }
+#ifdef STRMAP_STATS
 
-        strmap_p->deallocate_f_p(strmap_p->allocator_struct_p, node_p->key_p);
-        strmap_p->deallocate_f_p(strmap_p->allocator_struct_p, node_p->value_p);
-        strmap_p->deallocate_f_p(strmap_p->allocator_struct_p, node_p);
+// groups on the probe sequence of `hash` up to the one holding slot `index`, or up to the first one with an empty slot
+// if `index` is SIZE_MAX.
+static size_t table_probe_length(const strmap_table_type* table_p, uint64_t hash, size_t index) {
+    size_t mask = table_p->capacity - 1;
+    size_t pos = h1(hash) & mask;
+    size_t stride = 0;
 
-        strmap_p->lists_arr_p[index].node_count--;
-        strmap_p->total_nodes_count--;
+    for (size_t length = 1;; length++) {
+        // a key is found in the first group holding its slot
+        if (index != SIZE_MAX ? ((index - pos) & mask) < GROUP_WIDTH
+                              : group_match_empty(group_load(&table_p->ctrl_arr_p[pos])) != 0) {
+            return length;
+        }
+        stride += GROUP_WIDTH;
+        pos = (pos + stride) & mask;
+    }
+}
 
-        return true;
+// groups probed by a lookup of `hash` that found slot `index` of `table_p`, or found nothing if `table_p` is NULL.
+static size_t strmap_probe_length(const strmap_type* strmap_p, uint64_t hash, const strmap_table_type* table_p,
+                                  size_t index) {
+    if (table_p == &strmap_p->table) {
+        return table_probe_length(&strmap_p->table, hash, index);
+    }
+    size_t length = table_probe_length(&strmap_p->table, hash, SIZE_MAX);
+    if (strmap_is_resizing(strmap_p)) {
+        length += table_probe_length(&strmap_p->old_table, hash, table_p != NULL ? index : SIZE_MAX);
     }
+    return length;
+}
 
-    // otherwise iterate through list and compare key one by one
-    strmap_node_type* prev_p = NULL;
+// the counters are not ordered with anything else, so relaxed atomics are enough.
+static inline void stats_max(_Atomic size_t* max_p, size_t value) {
+    size_t max = atomic_load_explicit(max_p, memory_order_relaxed);
+    while (value > max) {
+        // on failure `max` is reloaded
+        if (atomic_compare_exchange_weak_explicit(max_p, &max, value, memory_order_relaxed, memory_order_relaxed)) {
+            break;
+        }
+    }
+}
 
-    prev_p = node_p;
-    node_p = node_p->next_p;
+// the probes are counted again apart from the lookup, which stays as it is without the counters.
+static void stats_record_lookup(strmap_type* strmap_p, uint64_t hash, const strmap_table_type* table_p, size_t index) {
+    size_t length = strmap_probe_length(strmap_p, hash, table_p, index);
+    strmap_stats_type* stats_p = &strmap_p->stats;
+    if (table_p != NULL) {
+        atomic_fetch_add_explicit(&stats_p->hit_count, 1, memory_order_relaxed);
+        atomic_fetch_add_explicit(&stats_p->hit_probes_total, length, memory_order_relaxed);
+        stats_max(&stats_p->hit_probes_max, length);
+    } else {
+        atomic_fetch_add_explicit(&stats_p->miss_count, 1, memory_order_relaxed);
+        atomic_fetch_add_explicit(&stats_p->miss_probes_total, length, memory_order_relaxed);
+        stats_max(&stats_p->miss_probes_max, length);
+    }
+}
 
-    while (node_p != NULL) {
-        if (strcmp(node_p->key_p, key_p) == 0) {
-            prev_p->next_p = node_p->next_p;
-            if (prev_p->next_p == NULL) {
-                strmap_p->lists_arr_p[index].tail_p = prev_p;
-            }
+#else
 
-            strmap_p->deallocate_f_p(strmap_p->allocator_struct_p, node_p->key_p);
-            strmap_p->deallocate_f_p(strmap_p->allocator_struct_p, node_p->value_p);
-            strmap_p->deallocate_f_p(strmap_p->allocator_struct_p, node_p);
+#define stats_record_lookup(strmap_p, hash, table_p, index) ((void)0)
 
-            strmap_p->lists_arr_p[index].node_count--;
-            strmap_p->total_nodes_count--;
+#endif
 
-            return true;
+// return the table holding `key_p` and set `*index_p` to its slot, or return NULL. nodes not yet moved are only in the
+// old table.
+static strmap_table_type* strmap_find(strmap_type* strmap_p, const char* key_p, size_t key_len, uint64_t hash,
+                                      size_t* index_p) {
+    strmap_table_type* table_p = &strmap_p->table;
+    *index_p = table_find(table_p, key_p, key_len, hash);
+    if (*index_p == SIZE_MAX) {
+        table_p = NULL;
+        if (strmap_is_resizing(strmap_p)) {
+            *index_p = table_find(&strmap_p->old_table, key_p, key_len, hash);
+            table_p = *index_p != SIZE_MAX ? &strmap_p->old_table : NULL;
         }
-
-        prev_p = node_p;
-        node_p = node_p->next_p;
     }
-
-    return false;
+    stats_record_lookup(strmap_p, hash, table_p, *index_p);
+    return table_p;
 }
 
-strmap_node_type* strmap_create_flattened_list(strmap_type* strmap_p, size_t list_count) {
-    assert(strmap_p != NULL);
-
-    strmap_node_type* head_p = NULL;
-    strmap_node_type* tail_p = NULL;
+// return the node holding `key_p` in either table, or NULL.
+static strmap_node_type* strmap_find_node(const strmap_type* strmap_p, const char* key_p, size_t key_len, uint64_t hash) {
+    // maps are only created by `strmap_init*`, never as const objects, and a lookup changes nothing but the counters,
+    // which are atomic
+    size_t index;
+    strmap_table_type* table_p = strmap_find((strmap_type*)strmap_p, key_p, key_len, hash, &index);
+    return table_p != NULL ? &table_p->nodes_arr_p[index] : NULL;
+}
 
-    strmap_node_list_type* lists_p = strmap_p->lists_arr_p;
-    size_t next_index = list_count;
+// move up to `slot_count` slots of the old table to the new table. nodes keep their hash, so keys are not rehashed.
+static void strmap_migrate(strmap_type* strmap_p, size_t slot_count) {
+    stats_timer_start();
+    strmap_table_type* old_table_p = &strmap_p->old_table;
+    size_t end = old_table_p->capacity - strmap_p->migrated_count > slot_count ? strmap_p->migrated_count + slot_count
+                                                                                : old_table_p->capacity;
 
-    // find first nonempty list
-    for (size_t i = 0; i < list_count; i++) {
-        if (lists_p[i].head_p == NULL) {
+    for (size_t i = strmap_p->migrated_count; i < end; i++) {
+        if (old_table_p->ctrl_arr_p[i] < 0) {
             continue;
         }
-        head_p = lists_p[i].head_p;
-        tail_p = lists_p[i].tail_p;
-        next_index = i + 1;
-        break;
+        table_insert_node(&strmap_p->table, &old_table_p->nodes_arr_p[i]);
+        // marked deleted rather than empty, so the probe sequences of the remaining nodes stay intact
+        table_set_ctrl(old_table_p, i, STRMAP_CTRL_DELETED);
+    }
+    strmap_p->migrated_count = end;
+
+    if (end == old_table_p->capacity) {
+        stats_sub(strmap_p, node_bytes, old_table_p->capacity * sizeof(strmap_node_type));
+        stats_sub(strmap_p, ctrl_bytes, old_table_p->capacity + GROUP_WIDTH);
+        strmap_deallocate(strmap_p, old_table_p->nodes_arr_p);
+        *old_table_p = (strmap_table_type){0};
+        strmap_p->migrated_count = 0;
+    }
+    stats_timer_stop(strmap_p);
+}
+
+// start moving every node to a new table with `new_capacity` slots. the nodes are moved a few slots at a time by later
+// insertions and deletions, so no single operation pays for the whole table.
+static bool strmap_start_resize(strmap_type* strmap_p, size_t new_capacity) {
+    assert(!strmap_is_resizing(strmap_p));
+
+    stats_timer_start();
+    strmap_table_type old_table = strmap_p->table;
+    bool res = strmap_alloc_table(strmap_p, &strmap_p->table, new_capacity);
+    stats_timer_stop(strmap_p);
+    if (!res) {
+        strmap_p->table = old_table;
+        return false;
     }
+    stats_add(strmap_p, resize_count, 1);
+    strmap_p->old_table = old_table;
+    strmap_p->migrated_count = 0;
+    strmap_migrate(strmap_p, MIGRATE_SLOTS_COUNT);
+    return true;
+}
 
-    // flattern other nonempty lists by stringing them together
-    for (size_t i = next_index; i < list_count; i++) {
-        if (lists_p[i].head_p == NULL) {
-            continue;
+// make room for one more node.
+static bool strmap_reserve_one(strmap_type* strmap_p) {
+    if (strmap_p->table.growth_left > 0) {
+        return true;
+    }
+    // the migration normally finishes well before the new table fills. if it has not, it is finished at once.
+    if (strmap_is_resizing(strmap_p)) {
+        strmap_migrate(strmap_p, SIZE_MAX);
+        if (strmap_p->table.growth_left > 0) {
+            return true;
         }
-        tail_p->next_p = lists_p[i].head_p;
-        tail_p = lists_p[i].tail_p;
     }
-
-    return head_p;
+    // if deleted slots take up most of the load, rehashing in place frees enough of them
+    size_t capacity = strmap_p->table.capacity;
+    if (strmap_p->total_nodes_count < max_load(capacity) / 2) {
+        return strmap_start_resize(strmap_p, capacity);
+    }
+    if (capacity > SIZE_MAX / 2) {
+        return false;
+    }
+    return strmap_start_resize(strmap_p, capacity << 1);
 }
 
-int strmap_grow_if_necessary(strmap_type* strmap_p, size_t chain_length) {
+bool strmap_reserve(strmap_type* strmap_p, size_t count) {
     assert(strmap_p != NULL);
 
-    if (chain_length <= MAX_CHAIN_LENGTH) {
-        return 0;
+    if (strmap_is_resizing(strmap_p)) {
+        strmap_migrate(strmap_p, SIZE_MAX);
     }
-
-    size_t old_list_count = strmap_p->list_count;
-    size_t new_list_count = strmap_p->list_count << 1;
-
-    if (new_list_count > SIZE_MAX / sizeof(strmap_node_list_type)) {
-        return -1;
+    size_t capacity = capacity_for(count, strmap_p->table.capacity);
+    if (capacity == 0) {
+        return false;
     }
-
-    strmap_node_list_type* lists_p =
-        strmap_p->reallocate_f_p(strmap_p->allocator_struct_p, strmap_p->lists_arr_p, alignof(strmap_node_list_type),
-                                 old_list_count * sizeof(strmap_node_list_type), new_list_count * sizeof(strmap_node_list_type));
-    if (lists_p == NULL) {
-        return -1;
+    if (capacity == strmap_p->table.capacity) {
+        return true;
     }
-    strmap_p->lists_arr_p = lists_p;
-
-    // create seperate flattened list (only using memory on the stack)
-    strmap_node_type* node_p = strmap_create_flattened_list(strmap_p, old_list_count);
-
-    // set to default values
-    for (size_t i = 0; i < new_list_count; i++) {
-        lists_p[i] = (strmap_node_list_type){.head_p = NULL, .tail_p = NULL, .node_count = 0};
+    // the caller is about to insert, so the table is moved at once
+    if (!strmap_start_resize(strmap_p, capacity)) {
+        return false;
     }
-    strmap_p->total_nodes_count = 0;
-
-    // reinsert every node
-    while (node_p != NULL) {
-        uint64_t hash = fnvhash((unsigned char*)node_p->key_p);
-        uint64_t index = hash & (new_list_count - 1);
-
-        strmap_node_type* head_p = lists_p[index].head_p;
-        strmap_node_type* next_temp_p = node_p->next_p;
+    strmap_migrate(strmap_p, SIZE_MAX);
+    return true;
+}
 
-        // insert node by the head
-        if (head_p == NULL) {
-            lists_p[index].head_p = node_p;
-            lists_p[index].tail_p = node_p;
-            node_p->next_p = NULL;
-        } else {
-            node_p->next_p = lists_p[index].head_p;
-            lists_p[index].head_p = node_p;
-        }
+bool strmap_contains(const strmap_type* strmap_p, const char* key_p) {
+    assert(strmap_p != NULL);
+    assert(key_p != NULL);
 
-        lists_p[index].node_count++;
-        strmap_p->total_nodes_count++;
+    size_t key_len = strlen(key_p);
+    return strmap_find_node(strmap_p, key_p, key_len, strmap_hash_with_len(strmap_p, key_p, key_len)) != NULL;
+}
 
-        node_p = next_temp_p;
-    }
-    strmap_p->list_count = new_list_count;
+bool strmap_contains_prehashed(const strmap_type* strmap_p, const char* key_p, uint64_t hash) {
+    assert(strmap_p != NULL);
+    assert(key_p != NULL);
 
-    return 1;
+    return strmap_find_node(strmap_p, key_p, strlen(key_p), hash) != NULL;
 }
 
-strmap_node_type* strmap_node_create(strmap_type* strmap_p, const char* key_p, const char* value_p) {
+const char* strmap_get(const strmap_type* strmap_p, const char* key_p) {
+    assert(strmap_p != NULL);
     assert(key_p != NULL);
-    assert(value_p != NULL);
 
-    strmap_node_type* node_p =
-        strmap_p->allocate_f_p(strmap_p->allocator_struct_p, alignof(strmap_node_type), sizeof(strmap_node_type));
+    size_t key_len = strlen(key_p);
+    const strmap_node_type* node_p = strmap_find_node(strmap_p, key_p, key_len, strmap_hash_with_len(strmap_p, key_p, key_len));
     if (node_p == NULL) {
-        return NULL;
+        return STRMAP_GET_VALUE_DEFAULT;
     }
-    size_t key_size = strlen(key_p) + 1;
-    node_p->key_p = strmap_p->allocate_f_p(strmap_p->allocator_struct_p, alignof(char), sizeof(char) * key_size);
-    if (node_p->key_p == NULL) {
-        strmap_p->deallocate_f_p(strmap_p->allocator_struct_p, node_p);
-        return NULL;
-    }
-    size_t value_size = strlen(value_p) + 1;
-    node_p->value_p = strmap_p->allocate_f_p(strmap_p->allocator_struct_p, alignof(char), sizeof(char) * value_size);
-    if (node_p->value_p == NULL) {
-        strmap_p->deallocate_f_p(strmap_p->allocator_struct_p, node_p->key_p);
-        strmap_p->deallocate_f_p(strmap_p->allocator_struct_p, node_p);
-        return NULL;
-    }
-    node_p->next_p = NULL;
+    return strmap_node_value(node_p);
+}
 
-    memcpy(node_p->key_p, key_p, key_size);
-    memcpy(node_p->value_p, value_p, value_size);
+const char* strmap_get_prehashed(const strmap_type* strmap_p, const char* key_p, uint64_t hash) {
+    assert(strmap_p != NULL);
+    assert(key_p != NULL);
 
-    return node_p;
+    const strmap_node_type* node_p = strmap_find_node(strmap_p, key_p, strlen(key_p), hash);
+    if (node_p == NULL) {
+        return STRMAP_GET_VALUE_DEFAULT;
+    }
+    return strmap_node_value(node_p);
 }
 
-bool strmap_set(strmap_type* strmap_p, const char* key_p, const char* value_p) {
+bool strmap_del(strmap_type* strmap_p, const char* key_p) {
     assert(strmap_p != NULL);
     assert(key_p != NULL);
-    assert(value_p != NULL);
-
-    uint64_t hash = fnvhash((const unsigned char*)key_p);
-    uint64_t index = hash & (strmap_p->list_count - 1);
 
-    int rtr_val = strmap_grow_if_necessary(strmap_p, strmap_p->lists_arr_p[index].node_count + 1);
-    if (rtr_val == -1) {
+    size_t key_len = strlen(key_p);
+    size_t index;
+    strmap_table_type* table_p = strmap_find(strmap_p, key_p, key_len, strmap_hash_with_len(strmap_p, key_p, key_len), &index);
+    if (table_p == NULL) {
         return false;
-    } else if (rtr_val == 1) {
-        index = hash & (strmap_p->list_count - 1);
     }
 
-    strmap_node_type* node_p = strmap_p->lists_arr_p[index].head_p;
-    strmap_node_type* prev_p = NULL;
-
-    // iterate through list, compare keys, and replace value if key matches.
-    while (node_p != NULL) {
-        prev_p = node_p;
-
-        if (strcmp(node_p->key_p, key_p) == 0) {
-            strmap_p->deallocate_f_p(strmap_p->allocator_struct_p, node_p->value_p);
+    const strmap_node_type* node_p = &table_p->nodes_arr_p[index];
+    stats_sub(strmap_p, string_bytes, strmap_node_block_size(node_p->key_len, node_p->value_len));
+    strmap_deallocate(strmap_p, node_p->block_p);
+    table_erase(table_p, index);
+    strmap_p->total_nodes_count--;
+
+    // shrink once a quarter of the load is left, which leaves the halved table half loaded
+    if (strmap_is_resizing(strmap_p)) {
+        strmap_migrate(strmap_p, MIGRATE_SLOTS_COUNT);
+    } else if (strmap_p->table.capacity / 2 >= INITIAL_CAPACITY &&
+               strmap_p->total_nodes_count < max_load(strmap_p->table.capacity) / 4) {
+        // on failure the table stays as it is
+        strmap_start_resize(strmap_p, strmap_p->table.capacity / 2);
+    }
 
-            size_t value_size = strlen(value_p) + 1;
-            node_p->value_p = strmap_p->allocate_f_p(strmap_p->allocator_struct_p, alignof(char), sizeof(char) * value_size);
+    return true;
+}
 
-            if (node_p->value_p == NULL) {
-                return false;
-            }
+// store the key and the value in the node where they fit, and allocate one block for the rest.
+static bool strmap_node_init(strmap_type* strmap_p, strmap_node_type* node_p, uint64_t hash, const char* key_p, size_t key_len,
+                             const char* value_p, size_t value_len) {
+    if (key_len > UINT32_MAX || value_len > UINT32_MAX) {
+        return false;
+    }
+    node_p->hash = hash;
+    node_p->key_len = (uint32_t)key_len;
+    node_p->value_len = (uint32_t)value_len;
+    node_p->block_p = NULL;
+
+    size_t block_size = strmap_node_block_size(key_len, value_len);
+    if (block_size != 0) {
+        node_p->block_p = strmap_p->allocate_f_p(strmap_p->allocator_struct_p, alignof(char), sizeof(char) * block_size);
+        if (node_p->block_p == NULL) {
+            return false;
+        }
+        stats_add(strmap_p, string_bytes, block_size);
+    }
+    memcpy((char*)strmap_node_key(node_p), key_p, key_len + 1);
+    memcpy((char*)strmap_node_value(node_p), value_p, value_len + 1);
+    return true;
+}
 
-            memcpy(node_p->value_p, value_p, value_size);
+bool strmap_set(strmap_type* strmap_p, const char* key_p, const char* value_p) {
+    assert(strmap_p != NULL);
+    assert(key_p != NULL);
+    assert(value_p != NULL);
 
+    size_t key_len = strlen(key_p);
+    size_t value_len = strlen(value_p);
+    uint64_t hash = strmap_hash_with_len(strmap_p, key_p, key_len);
+
+    // replace value if key exists. a value of the same length is written in place.
+    size_t index;
+    strmap_table_type* table_p = strmap_find(strmap_p, key_p, key_len, hash, &index);
+    if (table_p != NULL) {
+        strmap_node_type* node_p = &table_p->nodes_arr_p[index];
+        if (value_len == node_p->value_len) {
+            memmove((char*)strmap_node_value(node_p), value_p, value_len);
             return true;
         }
-
-        node_p = node_p->next_p;
+        strmap_node_type new_node;
+        if (!strmap_node_init(strmap_p, &new_node, hash, strmap_node_key(node_p), key_len, value_p, value_len)) {
+            return false;
+        }
+        stats_sub(strmap_p, string_bytes, strmap_node_block_size(node_p->key_len, node_p->value_len));
+        strmap_deallocate(strmap_p, node_p->block_p);
+        *node_p = new_node;
+        return true;
     }
 
-    // otherwise create a new node
-    node_p = strmap_node_create(strmap_p, key_p, value_p);
-    if (node_p == NULL) {
+    // otherwise create a new node. the key and the value are copied first, since they may be stored in a node of this
+    // map, which migrating or growing the table moves.
+    strmap_node_type node;
+    if (!strmap_node_init(strmap_p, &node, hash, key_p, key_len, value_p, value_len)) {
         return false;
     }
-
-    // and insert the node at by the head
-    if (prev_p == NULL) {
-        strmap_p->lists_arr_p[index].head_p = node_p;
-        strmap_p->lists_arr_p[index].tail_p = node_p;
-    } else {
-        node_p->next_p = strmap_p->lists_arr_p[index].head_p;
-        strmap_p->lists_arr_p[index].head_p = node_p;
+    if (strmap_is_resizing(strmap_p)) {
+        strmap_migrate(strmap_p, MIGRATE_SLOTS_COUNT);
+    }
+    if (!strmap_reserve_one(strmap_p)) {
+        stats_sub(strmap_p, string_bytes, strmap_node_block_size(key_len, value_len));
+        strmap_deallocate(strmap_p, node.block_p);
+        return false;
     }
-    strmap_p->lists_arr_p[index].node_count++;
+    table_insert_node(&strmap_p->table, &node);
     strmap_p->total_nodes_count++;
 
     return true;
 }
 
+bool strmap_set_all(strmap_type* strmap_p, const char* const* keys_pp, const char* const* values_pp, size_t count) {
+    assert(strmap_p != NULL);
+    assert(keys_pp != NULL);
+    assert(values_pp != NULL);
+
+    if (count > SIZE_MAX - strmap_p->total_nodes_count || !strmap_reserve(strmap_p, strmap_p->total_nodes_count + count)) {
+        return false;
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (!strmap_set(strmap_p, keys_pp[i], values_pp[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
 strmap_type* strmap_clone(const strmap_type* strmap_src_p) {
     assert(strmap_src_p != NULL);
 
+    // the clone holds the nodes of both tables in one table
+    size_t capacity = capacity_for(strmap_src_p->total_nodes_count, strmap_src_p->table.capacity);
     strmap_type* strmap_dest_p = NULL;
-    if (!strmap_init_with_initial_capacity(&strmap_dest_p, strmap_src_p->list_count, strmap_src_p->allocator_struct_p,
-                                           strmap_src_p->allocate_f_p, strmap_src_p->reallocate_f_p, strmap_src_p->deallocate_f_p)) {
+    if (capacity == 0 || !strmap_init_with_initial_capacity(&strmap_dest_p, capacity, strmap_src_p->allocator_struct_p,
+                                                            strmap_src_p->allocate_f_p, strmap_src_p->reallocate_f_p,
+                                                            strmap_src_p->deallocate_f_p)) {
         return NULL;
     }
-    size_t list_index;
-    strmap_node_type* next_p = NULL;
-    char* key_p = NULL;
-    char* value_p = NULL;
-    strmap_for_each(strmap_src_p, list_index, next_p, key_p, value_p) {
-        strmap_set(strmap_dest_p, key_p, value_p);
+    // the stored hashes depend on the seed
+    strmap_dest_p->seed = strmap_src_p->seed;
+
+    const strmap_table_type* tables_p[] = {&strmap_src_p->table, &strmap_src_p->old_table};
+    for (size_t t = 0; t < 2; t++) {
+        for (size_t i = 0; i < tables_p[t]->capacity; i++) {
+            if (tables_p[t]->ctrl_arr_p[i] < 0) {
+                continue;
+            }
+            const strmap_node_type* src_node_p = &tables_p[t]->nodes_arr_p[i];
+            strmap_node_type node;
+            if (!strmap_node_init(strmap_dest_p, &node, src_node_p->hash, strmap_node_key(src_node_p), src_node_p->key_len,
+                                  strmap_node_value(src_node_p), src_node_p->value_len)) {
+                strmap_destroy(strmap_dest_p);
+                return NULL;
+            }
+            table_insert_node(&strmap_dest_p->table, &node);
+            strmap_dest_p->total_nodes_count++;
+        }
     }
 
     return strmap_dest_p;
 }
+
+#ifdef STRMAP_STATS
+
+const strmap_stats_type* strmap_get_stats(const strmap_type* strmap_p) {
+    assert(strmap_p != NULL);
+
+    return &strmap_p->stats;
+}
+
+// probe lengths of stored keys from 1 up to this, the last counting the longer ones as well
+#define STATS_PROBE_LENGTH_MAX 16
+
+static void stats_print_histogram(FILE* file_p, const char* name_p, const size_t* counts_p, size_t count) {
+    fprintf(file_p, "  \"%s\": [", name_p);
+    for (size_t i = 0; i < count; i++) {
+        fprintf(file_p, i == 0 ? "%zu" : ", %zu", counts_p[i]);
+    }
+    fprintf(file_p, "]");
+}
+
+bool strmap_stats_print_json(const strmap_type* strmap_p, FILE* file_p) {
+    assert(strmap_p != NULL);
+    assert(file_p != NULL);
+
+    // the tables are walked here, so only the counters are kept while the map is used
+    size_t occupancy_arr[GROUP_WIDTH + 1] = {0}; // groups with 0 up to GROUP_WIDTH full slots
+    size_t probe_length_arr[STATS_PROBE_LENGTH_MAX] = {0};
+    size_t deleted_count = 0;
+    const strmap_table_type* tables_p[] = {&strmap_p->table, &strmap_p->old_table};
+    for (size_t t = 0; t < 2; t++) {
+        for (size_t group = 0; group < tables_p[t]->capacity; group += GROUP_WIDTH) {
+            size_t full_count = 0;
+            for (size_t i = group; i < group + GROUP_WIDTH; i++) {
+                if (tables_p[t]->ctrl_arr_p[i] == STRMAP_CTRL_DELETED) {
+                    deleted_count++;
+                }
+                if (tables_p[t]->ctrl_arr_p[i] < 0) {
+                    continue;
+                }
+                full_count++;
+                size_t length = strmap_probe_length(strmap_p, tables_p[t]->nodes_arr_p[i].hash, tables_p[t], i);
+                probe_length_arr[(length < STATS_PROBE_LENGTH_MAX ? length : STATS_PROBE_LENGTH_MAX) - 1]++;
+            }
+            occupancy_arr[full_count]++;
+        }
+    }
+
+    const strmap_stats_type* stats_p = &strmap_p->stats;
+    fprintf(file_p, "{\n");
+    fprintf(file_p, "  \"count\": %zu,\n", strmap_p->total_nodes_count);
+    fprintf(file_p, "  \"capacity\": %zu,\n", strmap_p->table.capacity);
+    fprintf(file_p, "  \"old_capacity\": %zu,\n", strmap_p->old_table.capacity);
+    fprintf(file_p, "  \"deleted_count\": %zu,\n", deleted_count);
+    fprintf(file_p, "  \"group_width\": %d,\n", GROUP_WIDTH);
+    fprintf(file_p, "  \"hits\": {\"count\": %zu, \"probes_avg\": %.3f, \"probes_max\": %zu},\n", stats_p->hit_count,
+            stats_p->hit_count != 0 ? (double)stats_p->hit_probes_total / (double)stats_p->hit_count : 0.0,
+            stats_p->hit_probes_max);
+    fprintf(file_p, "  \"misses\": {\"count\": %zu, \"probes_avg\": %.3f, \"probes_max\": %zu},\n", stats_p->miss_count,
+            stats_p->miss_count != 0 ? (double)stats_p->miss_probes_total / (double)stats_p->miss_count : 0.0,
+            stats_p->miss_probes_max);
+    fprintf(file_p, "  \"resizes\": {\"count\": %zu, \"ms\": %.3f},\n", stats_p->resize_count,
+            (double)stats_p->resize_ns / 1e6);
+    fprintf(file_p, "  \"bytes\": {\"nodes\": %zu, \"ctrl\": %zu, \"strings\": %zu, \"total\": %zu},\n",
+            stats_p->node_bytes, stats_p->ctrl_bytes, stats_p->string_bytes,
+            stats_p->node_bytes + stats_p->ctrl_bytes + stats_p->string_bytes);
+    stats_print_histogram(file_p, "group_occupancy", occupancy_arr, GROUP_WIDTH + 1);
+    fprintf(file_p, ",\n");
+    stats_print_histogram(file_p, "probe_length", probe_length_arr, STATS_PROBE_LENGTH_MAX);
+    fprintf(file_p, "\n}\n");
+    return !ferror(file_p);
+}
+
+#endif
@@ -1,41 +1,86 @@
 #pragma once
 
 #include <stdbool.h> // bool, true, false
+#include <stdint.h>  // uint64_t, uint32_t, int8_t
 #include <stdlib.h>  // size_t, NULL
 
 #include "allocator_function_types.h" // allocate_f, reallocate_f, deallocate_f
 
-typedef struct strmap_node_type {
-    struct strmap_node_type* next_p;
-    char* key_p;
-    char* value_p;
+#define STRMAP_NODE_INLINE_SIZE 40
+
+// a key shorter than `STRMAP_NODE_INLINE_SIZE` is kept in the node, followed by the value if it fits as well, so
+// comparing keys does not leave the table. strings that do not fit are in one allocation: the value, or the key and
+// then the value. use `strmap_node_key` and `strmap_node_value` to find them.
+typedef struct {
+    uint64_t hash;
+    uint32_t key_len;
+    uint32_t value_len;
+    char* block_p; // NULL if both strings are inline
+    char inline_arr[STRMAP_NODE_INLINE_SIZE];
 } strmap_node_type;
 
 typedef struct {
-    size_t node_count;
-    strmap_node_type* head_p;
-    strmap_node_type* tail_p;
-} strmap_node_list_type;
+    size_t capacity;    // number of slots, a power of two. 0 if there is no table.
+    size_t growth_left; // number of empty slots that may be filled before the table must be rehashed
+    int8_t* ctrl_arr_p; // control byte for every slot, followed by a copy of the first group
+    strmap_node_type* nodes_arr_p;
+} strmap_table_type;
+
+#ifdef STRMAP_STATS
+#include <stdatomic.h> // _Atomic
+
+// counters kept while the map is used, only when compiled with `STRMAP_STATS` (e.g. `CFLAGS=-DSTRMAP_STATS make`).
+// every lookup is counted, including those of `strmap_set` and `strmap_del`. probes are counted in groups of control
+// bytes, over both tables while resizing. bytes are those the map holds from its allocator.
+//
+// lookups on a map that is not being changed may run on several threads, so the counters they update are atomic.
+typedef struct {
+    _Atomic size_t hit_count;
+    _Atomic size_t hit_probes_total;
+    _Atomic size_t hit_probes_max;
+    _Atomic size_t miss_count;
+    _Atomic size_t miss_probes_total;
+    _Atomic size_t miss_probes_max;
+    size_t resize_count;
+    uint64_t resize_ns; // allocating new tables and moving nodes to them
+    size_t node_bytes;
+    size_t ctrl_bytes;
+    size_t string_bytes; // blocks of strings that do not fit in their node
+} strmap_stats_type;
+#endif
 
 typedef struct {
     size_t total_nodes_count;
-    size_t list_count;
-    strmap_node_list_type* lists_arr_p;
+    strmap_table_type table;     // new nodes go here
+    strmap_table_type old_table; // while resizing, the nodes not moved to `table` yet
+    size_t migrated_count;       // slots of `old_table` moved so far
+    uint64_t seed;               // of the hash function, random unless set with `strmap_set_seed`
 
     void* allocator_struct_p;
     allocate_f allocate_f_p;
     reallocate_f reallocate_f_p;
     deallocate_f deallocate_f_p;
+
+#ifdef STRMAP_STATS
+    strmap_stats_type stats;
+#endif
 } strmap_type;
 
 #define STRMAP_GET_VALUE_DEFAULT NULL
 
+// control bytes of slots without a node. full slots have the low 7 bits of the hash, so a non-negative control byte.
+#define STRMAP_CTRL_EMPTY ((int8_t)-128)
+#define STRMAP_CTRL_DELETED ((int8_t)-2)
+
 strmap_type* strmap_create();
 
 void strmap_destroy(strmap_type* strmap_p);
 
+// copies every node and string. for cheap snapshots of a changing map, `strmap_persistent` clones in constant time.
 strmap_type* strmap_clone(const strmap_type* strmap_src_p);
 
+// a NULL `deallocate_f_p` means memory is only released with the allocator itself, as with an arena. the map then
+// never frees anything, and `strmap_destroy` returns immediately.
 bool strmap_init(strmap_type** strmap_pp, void* allocator_struct_p, allocate_f allocate_f_p, reallocate_f realloc_f_p,
                  deallocate_f deallocate_f_p);
 
@@ -44,14 +89,66 @@ bool strmap_init_with_initial_capacity(strmap_type** strmap_pp, size_t pow2_capa
 
 size_t strmap_get_count(const strmap_type* strmap_p);
 
+// only possible while the map is empty. maps with the same seed hash keys the same way.
+bool strmap_set_seed(strmap_type* strmap_p, uint64_t seed);
+
+// hash a key once to look it up with `*_prehashed` in every map with the same seed.
+uint64_t strmap_hash(const strmap_type* strmap_p, const char* key_p);
+
 bool strmap_contains(const strmap_type* strmap_p, const char* key_p);
 
+bool strmap_contains_prehashed(const strmap_type* strmap_p, const char* key_p, uint64_t hash);
+
+// the value stays valid until the map is changed by `strmap_set`, `strmap_del`, `strmap_reserve` or
+// `strmap_set_all`, failed calls included, or destroyed. short values are stored in the table, which any of these may
+// move. it may still be passed as the key or the value to a single `strmap_set` on the same map.
 const char* strmap_get(const strmap_type* strmap_p, const char* key_p);
 
+const char* strmap_get_prehashed(const strmap_type* strmap_p, const char* key_p, uint64_t hash);
+
 bool strmap_set(strmap_type* strmap_p, const char* key_p, const char* value_p);
 
 bool strmap_del(strmap_type* strmap_p, const char* key_p);
 
-#define strmap_for_each(p, i, n, k, v)                                                        \
-    for ((i) = 0; (i) < (p)->list_count && ((n) = (p)->lists_arr_p[(i)].head_p, true); (i)++) \
-        while ((n) != NULL && ((k) = (n)->key_p, (v) = (n)->value_p, (n) = (n)->next_p, true))
+// make room for `count` nodes in total without growing again.
+bool strmap_reserve(strmap_type* strmap_p, size_t count);
+
+// set many pairs at once, growing the table at most once.
+bool strmap_set_all(strmap_type* strmap_p, const char* const* keys_pp, const char* const* values_pp, size_t count);
+
+#ifdef STRMAP_STATS
+#include <stdio.h> // FILE
+
+const strmap_stats_type* strmap_get_stats(const strmap_type* strmap_p);
+
+// write the counters as one JSON object, with histograms of the full slots per group and of the groups probed to find
+// every stored key.
+bool strmap_stats_print_json(const strmap_type* strmap_p, FILE* file_p);
+#endif
+
+static inline const char* strmap_node_key(const strmap_node_type* node_p) {
+    return node_p->key_len < STRMAP_NODE_INLINE_SIZE ? node_p->inline_arr : node_p->block_p;
+}
+
+static inline const char* strmap_node_value(const strmap_node_type* node_p) {
+    if (node_p->key_len >= STRMAP_NODE_INLINE_SIZE) {
+        return node_p->block_p + node_p->key_len + 1;
+    }
+    return (size_t)node_p->key_len + node_p->value_len + 2 <= STRMAP_NODE_INLINE_SIZE ? node_p->inline_arr + node_p->key_len + 1
+                                                                                      : node_p->block_p;
+}
+
+// node in slot `index` of the table followed by the old table, or NULL if the slot is not in use.
+static inline strmap_node_type* strmap_slot_node(const strmap_type* strmap_p, size_t index) {
+    const strmap_table_type* table_p = &strmap_p->table;
+    if (index >= table_p->capacity) {
+        index -= table_p->capacity;
+        table_p = &strmap_p->old_table;
+    }
+    return table_p->ctrl_arr_p[index] >= 0 ? &table_p->nodes_arr_p[index] : NULL;
+}
+
+#define strmap_for_each(p, i, n, k, v)                                                                           \
+    for ((i) = 0; (i) < (p)->table.capacity + (p)->old_table.capacity; (i)++)                                    \
+        for ((n) = strmap_slot_node((p), (i)); (n) != NULL && ((k) = strmap_node_key(n), (v) = strmap_node_value(n), true); \
+             (n) = NULL)
@@ -0,0 +1,469 @@
+#include <pthread.h>   // pthread_mutex_*
+#include <stdalign.h>  // alignas
+#include <stdatomic.h> // _Atomic, atomic_*, memory_order_*
+#include <stdbool.h>   // bool, true, false
+#include <stdint.h>    // uint64_t
+#include <stdlib.h>    // malloc, calloc, free, size_t
+#include <string.h>    // memcpy, strcmp, strlen
+
+#include "random_seed.h" // random_seed
+#include "strmap_concurrent.h"
+#include "wyhash.h" // wyhash
+
+// a power of two. tables never have fewer buckets, so all keys of a bucket are guarded by the same stripe.
+#define STRIPE_COUNT 64
+
+// retired items a thread collects before trying to advance the epoch
+#define RETIRED_COUNT_MAX 64
+
+#define CACHE_LINE_SIZE 64
+
+typedef struct strmap_concurrent_node_type {
+    uint64_t hash;
+    _Atomic(struct strmap_concurrent_node_type*) next_p;
+    char* key_p;   // owns one allocation holding the key and then the value, shared with the copies of the node
+    char* value_p; // points into the allocation of the key
+    struct strmap_concurrent_node_type* retired_next_p;
+} strmap_concurrent_node_type;
+
+typedef struct strmap_concurrent_table_type {
+    size_t capacity; // number of buckets, a power of two
+    _Atomic(strmap_concurrent_node_type*)* buckets_p;
+    struct strmap_concurrent_table_type* retired_next_p;
+} strmap_concurrent_table_type;
+
+// what a thread removed during one epoch. a table is retired with its nodes, but not the keys and values, which
+// moved to the copies of the nodes.
+typedef struct {
+    uint64_t epoch;
+    strmap_concurrent_node_type* nodes_p;
+    strmap_concurrent_table_type* tables_p;
+} strmap_concurrent_limbo_type;
+
+struct strmap_concurrent_thread_type {
+    alignas(CACHE_LINE_SIZE) _Atomic uint64_t local_epoch; // epoch shifted left by one, with the low bit set while inside
+    size_t depth;
+    size_t retired_count;
+    strmap_concurrent_limbo_type limbo[3];
+    strmap_concurrent_type* map_p;
+    bool in_use; // guarded by the registry mutex
+    _Atomic(struct strmap_concurrent_thread_type*) next_p;
+};
+
+typedef struct {
+    alignas(CACHE_LINE_SIZE) pthread_mutex_t mutex;
+} strmap_concurrent_stripe_type;
+
+struct strmap_concurrent_type {
+    _Atomic(strmap_concurrent_table_type*) table_p;
+    _Atomic size_t count;
+    uint64_t seed;
+
+    alignas(CACHE_LINE_SIZE) _Atomic uint64_t global_epoch;
+
+    pthread_mutex_t registry_mutex;
+    _Atomic(strmap_concurrent_thread_type*) threads_p; // only grows, until the map is destroyed
+    strmap_concurrent_limbo_type orphan;             // left by unregistered threads, guarded by the registry mutex
+
+    pthread_mutex_t resize_mutex;
+    strmap_concurrent_stripe_type stripes[STRIPE_COUNT];
+};
+
+static strmap_concurrent_table_type* table_create(size_t capacity) {
+    strmap_concurrent_table_type* table_p = malloc(sizeof(strmap_concurrent_table_type));
+    if (table_p == NULL) {
+        return NULL;
+    }
+    table_p->capacity = capacity;
+    table_p->buckets_p = calloc(capacity, sizeof(*table_p->buckets_p));
+    table_p->retired_next_p = NULL;
+    if (table_p->buckets_p == NULL) {
+        free(table_p);
+        return NULL;
+    }
+    return table_p;
+}
+
+// free a table and its nodes, and with `with_strings` also their keys and values.
+static void table_free(strmap_concurrent_table_type* table_p, bool with_strings) {
+    for (size_t i = 0; i < table_p->capacity; i++) {
+        strmap_concurrent_node_type* node_p = atomic_load_explicit(&table_p->buckets_p[i], memory_order_relaxed);
+        while (node_p != NULL) {
+            strmap_concurrent_node_type* next_p = atomic_load_explicit(&node_p->next_p, memory_order_relaxed);
+            if (with_strings) {
+                free(node_p->key_p);
+            }
+            free(node_p);
+            node_p = next_p;
+        }
+    }
+    free(table_p->buckets_p);
+    free(table_p);
+}
+
+static void limbo_free(strmap_concurrent_limbo_type* limbo_p) {
+    while (limbo_p->nodes_p != NULL) {
+        strmap_concurrent_node_type* next_p = limbo_p->nodes_p->retired_next_p;
+        free(limbo_p->nodes_p->key_p);
+        free(limbo_p->nodes_p);
+        limbo_p->nodes_p = next_p;
+    }
+    while (limbo_p->tables_p != NULL) {
+        strmap_concurrent_table_type* next_p = limbo_p->tables_p->retired_next_p;
+        table_free(limbo_p->tables_p, false);
+        limbo_p->tables_p = next_p;
+    }
+}
+
+strmap_concurrent_type* strmap_concurrent_create(void) {
+    strmap_concurrent_type* map_p = aligned_alloc(CACHE_LINE_SIZE, sizeof(strmap_concurrent_type));
+    if (map_p == NULL) {
+        return NULL;
+    }
+    strmap_concurrent_table_type* table_p = table_create(STRIPE_COUNT);
+    if (table_p == NULL) {
+        free(map_p);
+        return NULL;
+    }
+    atomic_init(&map_p->table_p, table_p);
+    atomic_init(&map_p->count, 0);
+    map_p->seed = random_seed(map_p);
+    atomic_init(&map_p->global_epoch, 0);
+    pthread_mutex_init(&map_p->registry_mutex, NULL);
+    atomic_init(&map_p->threads_p, NULL);
+    map_p->orphan = (strmap_concurrent_limbo_type){0};
+    pthread_mutex_init(&map_p->resize_mutex, NULL);
+    for (size_t i = 0; i < STRIPE_COUNT; i++) {
+        pthread_mutex_init(&map_p->stripes[i].mutex, NULL);
+    }
+    return map_p;
+}
+
+void strmap_concurrent_destroy(strmap_concurrent_type* map_p) {
+    if (map_p == NULL) {
+        return;
+    }
+    strmap_concurrent_thread_type* thread_p = atomic_load_explicit(&map_p->threads_p, memory_order_relaxed);
+    while (thread_p != NULL) {
+        strmap_concurrent_thread_type* next_p = atomic_load_explicit(&thread_p->next_p, memory_order_relaxed);
+        for (size_t i = 0; i < 3; i++) {
+            limbo_free(&thread_p->limbo[i]);
+        }
+        free(thread_p);
+        thread_p = next_p;
+    }
+    limbo_free(&map_p->orphan);
+    table_free(atomic_load_explicit(&map_p->table_p, memory_order_relaxed), true);
+
+    pthread_mutex_destroy(&map_p->registry_mutex);
+    pthread_mutex_destroy(&map_p->resize_mutex);
+    for (size_t i = 0; i < STRIPE_COUNT; i++) {
+        pthread_mutex_destroy(&map_p->stripes[i].mutex);
+    }
+    free(map_p);
+}
+
+strmap_concurrent_thread_type* strmap_concurrent_thread_register(strmap_concurrent_type* map_p) {
+    pthread_mutex_lock(&map_p->registry_mutex);
+
+    // reuse the state of a thread that unregistered
+    strmap_concurrent_thread_type* thread_p = atomic_load_explicit(&map_p->threads_p, memory_order_relaxed);
+    while (thread_p != NULL && thread_p->in_use) {
+        thread_p = atomic_load_explicit(&thread_p->next_p, memory_order_relaxed);
+    }
+    if (thread_p == NULL) {
+        thread_p = aligned_alloc(CACHE_LINE_SIZE, sizeof(strmap_concurrent_thread_type));
+        if (thread_p == NULL) {
+            pthread_mutex_unlock(&map_p->registry_mutex);
+            return NULL;
+        }
+        atomic_init(&thread_p->local_epoch, 0);
+        thread_p->map_p = map_p;
+        atomic_init(&thread_p->next_p, atomic_load_explicit(&map_p->threads_p, memory_order_relaxed));
+        atomic_store_explicit(&map_p->threads_p, thread_p, memory_order_release);
+    }
+    thread_p->depth = 0;
+    thread_p->retired_count = 0;
+    for (size_t i = 0; i < 3; i++) {
+        thread_p->limbo[i] = (strmap_concurrent_limbo_type){0};
+    }
+    thread_p->in_use = true;
+
+    pthread_mutex_unlock(&map_p->registry_mutex);
+    return thread_p;
+}
+
+void strmap_concurrent_thread_unregister(strmap_concurrent_thread_type* thread_p) {
+    strmap_concurrent_type* map_p = thread_p->map_p;
+    pthread_mutex_lock(&map_p->registry_mutex);
+
+    // other threads may still hold what this one removed, so it is kept until the map is destroyed
+    for (size_t i = 0; i < 3; i++) {
+        strmap_concurrent_limbo_type* limbo_p = &thread_p->limbo[i];
+        while (limbo_p->nodes_p != NULL) {
+            strmap_concurrent_node_type* next_p = limbo_p->nodes_p->retired_next_p;
+            limbo_p->nodes_p->retired_next_p = map_p->orphan.nodes_p;
+            map_p->orphan.nodes_p = limbo_p->nodes_p;
+            limbo_p->nodes_p = next_p;
+        }
+        while (limbo_p->tables_p != NULL) {
+            strmap_concurrent_table_type* next_p = limbo_p->tables_p->retired_next_p;
+            limbo_p->tables_p->retired_next_p = map_p->orphan.tables_p;
+            map_p->orphan.tables_p = limbo_p->tables_p;
+            limbo_p->tables_p = next_p;
+        }
+    }
+    thread_p->in_use = false;
+
+    pthread_mutex_unlock(&map_p->registry_mutex);
+}
+
+void strmap_concurrent_enter(strmap_concurrent_thread_type* thread_p) {
+    if (thread_p->depth++ != 0) {
+        return;
+    }
+    // announce the epoch, and check it did not move on before the announcement was visible
+    _Atomic uint64_t* global_epoch_p = &thread_p->map_p->global_epoch;
+    uint64_t epoch = atomic_load(global_epoch_p);
+    while (true) {
+        atomic_store(&thread_p->local_epoch, epoch << 1 | 1);
+        uint64_t current = atomic_load(global_epoch_p);
+        if (current == epoch) {
+            break;
+        }
+        epoch = current;
+    }
+}
+
+void strmap_concurrent_leave(strmap_concurrent_thread_type* thread_p) {
+    if (--thread_p->depth != 0) {
+        return;
+    }
+    atomic_store_explicit(&thread_p->local_epoch, 0, memory_order_release);
+}
+
+// move the epoch on if every thread inside the map has seen the current one.
+static void try_advance(strmap_concurrent_type* map_p) {
+    uint64_t epoch = atomic_load(&map_p->global_epoch);
+    strmap_concurrent_thread_type* thread_p = atomic_load_explicit(&map_p->threads_p, memory_order_acquire);
+    for (; thread_p != NULL; thread_p = atomic_load_explicit(&thread_p->next_p, memory_order_acquire)) {
+        uint64_t local_epoch = atomic_load(&thread_p->local_epoch);
+        if ((local_epoch & 1) != 0 && local_epoch >> 1 != epoch) {
+            return;
+        }
+    }
+    atomic_compare_exchange_strong(&map_p->global_epoch, &epoch, epoch + 1);
+}
+
+// free what was removed three epochs ago or earlier. a limbo is tagged with the epoch its thread was inside at, and
+// the global epoch may already be one ahead of it, so a reader that still holds something removed may be inside at the
+// next epoch. the epoch moves on twice more only once that reader has left.
+static void collect(strmap_concurrent_thread_type* thread_p) {
+    uint64_t epoch = atomic_load(&thread_p->map_p->global_epoch);
+    for (size_t i = 0; i < 3; i++) {
+        strmap_concurrent_limbo_type* limbo_p = &thread_p->limbo[i];
+        if (limbo_p->epoch + 3 <= epoch) {
+            limbo_free(limbo_p);
+        }
+    }
+}
+
+// limbo for the epoch the thread entered in. must be inside the map.
+static strmap_concurrent_limbo_type* current_limbo(strmap_concurrent_thread_type* thread_p) {
+    uint64_t epoch = atomic_load_explicit(&thread_p->local_epoch, memory_order_relaxed) >> 1;
+    strmap_concurrent_limbo_type* limbo_p = &thread_p->limbo[epoch % 3];
+    if (limbo_p->epoch != epoch) {
+        // from three epochs ago or earlier, and the thread is inside, so the global epoch is at least three ahead of it
+        limbo_free(limbo_p);
+        limbo_p->epoch = epoch;
+    }
+    return limbo_p;
+}
+
+static void after_retire(strmap_concurrent_thread_type* thread_p) {
+    if (++thread_p->retired_count >= RETIRED_COUNT_MAX) {
+        thread_p->retired_count = 0;
+        try_advance(thread_p->map_p);
+        collect(thread_p);
+    }
+}
+
+static void retire_node(strmap_concurrent_thread_type* thread_p, strmap_concurrent_node_type* node_p) {
+    strmap_concurrent_limbo_type* limbo_p = current_limbo(thread_p);
+    node_p->retired_next_p = limbo_p->nodes_p;
+    limbo_p->nodes_p = node_p;
+    after_retire(thread_p);
+}
+
+static void retire_table(strmap_concurrent_thread_type* thread_p, strmap_concurrent_table_type* table_p) {
+    strmap_concurrent_limbo_type* limbo_p = current_limbo(thread_p);
+    table_p->retired_next_p = limbo_p->tables_p;
+    limbo_p->tables_p = table_p;
+    after_retire(thread_p);
+}
+
+size_t strmap_concurrent_get_count(const strmap_concurrent_type* map_p) {
+    return atomic_load_explicit(&((strmap_concurrent_type*)map_p)->count, memory_order_relaxed);
+}
+
+static inline uint64_t strmap_concurrent_hash(const strmap_concurrent_type* map_p, const char* key_p) {
+    return wyhash((const unsigned char*)key_p, strlen(key_p), map_p->seed);
+}
+
+static strmap_concurrent_node_type* table_find(const strmap_concurrent_table_type* table_p, uint64_t hash, const char* key_p) {
+    strmap_concurrent_node_type* node_p =
+        atomic_load_explicit(&table_p->buckets_p[hash & (table_p->capacity - 1)], memory_order_acquire);
+    for (; node_p != NULL; node_p = atomic_load_explicit(&node_p->next_p, memory_order_acquire)) {
+        if (node_p->hash == hash && strcmp(node_p->key_p, key_p) == 0) {
+            return node_p;
+        }
+    }
+    return NULL;
+}
+
+const char* strmap_concurrent_get(strmap_concurrent_thread_type* thread_p, const char* key_p) {
+    strmap_concurrent_type* map_p = thread_p->map_p;
+    uint64_t hash = strmap_concurrent_hash(map_p, key_p);
+    const strmap_concurrent_node_type* node_p =
+        table_find(atomic_load_explicit(&map_p->table_p, memory_order_acquire), hash, key_p);
+    return node_p != NULL ? node_p->value_p : NULL;
+}
+
+bool strmap_concurrent_contains(strmap_concurrent_thread_type* thread_p, const char* key_p) {
+    strmap_concurrent_enter(thread_p);
+    bool res = strmap_concurrent_get(thread_p, key_p) != NULL;
+    strmap_concurrent_leave(thread_p);
+    return res;
+}
+
+// lock the stripe of `hash` in the current table. the table may be replaced while waiting for the lock.
+static strmap_concurrent_table_type* lock_stripe(strmap_concurrent_type* map_p, uint64_t hash) {
+    pthread_mutex_t* mutex_p = &map_p->stripes[hash & (STRIPE_COUNT - 1)].mutex;
+    while (true) {
+        strmap_concurrent_table_type* table_p = atomic_load_explicit(&map_p->table_p, memory_order_acquire);
+        pthread_mutex_lock(mutex_p);
+        if (table_p == atomic_load_explicit(&map_p->table_p, memory_order_acquire)) {
+            return table_p;
+        }
+        pthread_mutex_unlock(mutex_p);
+    }
+}
+
+static inline void unlock_stripe(strmap_concurrent_type* map_p, uint64_t hash) {
+    pthread_mutex_unlock(&map_p->stripes[hash & (STRIPE_COUNT - 1)].mutex);
+}
+
+// double the buckets once there are more nodes than buckets. the new table shares the keys and values of the old one.
+static void grow(strmap_concurrent_thread_type* thread_p) {
+    strmap_concurrent_type* map_p = thread_p->map_p;
+    pthread_mutex_lock(&map_p->resize_mutex);
+    for (size_t i = 0; i < STRIPE_COUNT; i++) {
+        pthread_mutex_lock(&map_p->stripes[i].mutex);
+    }
+    strmap_concurrent_table_type* old_table_p = atomic_load_explicit(&map_p->table_p, memory_order_relaxed);
+    strmap_concurrent_table_type* new_table_p = NULL;
+    if (atomic_load_explicit(&map_p->count, memory_order_relaxed) <= old_table_p->capacity ||
+        (new_table_p = table_create(2 * old_table_p->capacity)) == NULL) {
+        goto unlock;
+    }
+    size_t mask = new_table_p->capacity - 1;
+    for (size_t i = 0; i < old_table_p->capacity; i++) {
+        strmap_concurrent_node_type* node_p = atomic_load_explicit(&old_table_p->buckets_p[i], memory_order_relaxed);
+        for (; node_p != NULL; node_p = atomic_load_explicit(&node_p->next_p, memory_order_relaxed)) {
+            strmap_concurrent_node_type* copy_p = malloc(sizeof(strmap_concurrent_node_type));
+            if (copy_p == NULL) {
+                table_free(new_table_p, false);
+                new_table_p = NULL;
+                goto unlock;
+            }
+            _Atomic(strmap_concurrent_node_type*)* bucket_p = &new_table_p->buckets_p[node_p->hash & mask];
+            copy_p->hash = node_p->hash;
+            copy_p->key_p = node_p->key_p;
+            copy_p->value_p = node_p->value_p;
+            atomic_init(&copy_p->next_p, atomic_load_explicit(bucket_p, memory_order_relaxed));
+            atomic_store_explicit(bucket_p, copy_p, memory_order_relaxed);
+        }
+    }
+    atomic_store_explicit(&map_p->table_p, new_table_p, memory_order_release);
+
+unlock:
+    for (size_t i = 0; i < STRIPE_COUNT; i++) {
+        pthread_mutex_unlock(&map_p->stripes[i].mutex);
+    }
+    if (new_table_p != NULL) {
+        retire_table(thread_p, old_table_p);
+    }
+    pthread_mutex_unlock(&map_p->resize_mutex);
+}
+
+bool strmap_concurrent_set(strmap_concurrent_thread_type* thread_p, const char* key_p, const char* value_p) {
+    strmap_concurrent_type* map_p = thread_p->map_p;
+    size_t key_size = strlen(key_p) + 1;
+    size_t value_size = strlen(value_p) + 1;
+    uint64_t hash = wyhash((const unsigned char*)key_p, key_size - 1, map_p->seed);
+
+    strmap_concurrent_node_type* new_node_p = malloc(sizeof(strmap_concurrent_node_type));
+    char* block_p = malloc(key_size + value_size);
+    if (new_node_p == NULL || block_p == NULL) {
+        free(new_node_p);
+        free(block_p);
+        return false;
+    }
+    memcpy(block_p, key_p, key_size);
+    memcpy(block_p + key_size, value_p, value_size);
+    new_node_p->hash = hash;
+    new_node_p->key_p = block_p;
+    new_node_p->value_p = block_p + key_size;
+
+    strmap_concurrent_enter(thread_p);
+    strmap_concurrent_table_type* table_p = lock_stripe(map_p, hash);
+
+    // readers may hold the old node, so it is replaced by the new one as a whole
+    _Atomic(strmap_concurrent_node_type*)* link_p = &table_p->buckets_p[hash & (table_p->capacity - 1)];
+    strmap_concurrent_node_type* node_p = atomic_load_explicit(link_p, memory_order_relaxed);
+    while (node_p != NULL && (node_p->hash != hash || strcmp(node_p->key_p, key_p) != 0)) {
+        link_p = &node_p->next_p;
+        node_p = atomic_load_explicit(link_p, memory_order_relaxed);
+    }
+    bool inserted = node_p == NULL;
+    atomic_init(&new_node_p->next_p, inserted ? atomic_load_explicit(link_p, memory_order_relaxed)
+                                             : atomic_load_explicit(&node_p->next_p, memory_order_relaxed));
+    atomic_store_explicit(link_p, new_node_p, memory_order_release);
+    size_t count = inserted ? atomic_fetch_add_explicit(&map_p->count, 1, memory_order_relaxed) + 1 : 0;
+    unlock_stripe(map_p, hash);
+
+    if (!inserted) {
+        retire_node(thread_p, node_p);
+    } else if (count > table_p->capacity) {
+        grow(thread_p);
+    }
+    strmap_concurrent_leave(thread_p);
+    return true;
+}
+
+bool strmap_concurrent_del(strmap_concurrent_thread_type* thread_p, const char* key_p) {
+    strmap_concurrent_type* map_p = thread_p->map_p;
+    uint64_t hash = strmap_concurrent_hash(map_p, key_p);
+
+    strmap_concurrent_enter(thread_p);
+    strmap_concurrent_table_type* table_p = lock_stripe(map_p, hash);
+
+    _Atomic(strmap_concurrent_node_type*)* link_p = &table_p->buckets_p[hash & (table_p->capacity - 1)];
+    strmap_concurrent_node_type* node_p = atomic_load_explicit(link_p, memory_order_relaxed);
+    while (node_p != NULL && (node_p->hash != hash || strcmp(node_p->key_p, key_p) != 0)) {
+        link_p = &node_p->next_p;
+        node_p = atomic_load_explicit(link_p, memory_order_relaxed);
+    }
+    if (node_p != NULL) {
+        // readers on the node go on to its successor
+        atomic_store_explicit(link_p, atomic_load_explicit(&node_p->next_p, memory_order_relaxed), memory_order_release);
+        atomic_fetch_sub_explicit(&map_p->count, 1, memory_order_relaxed);
+    }
+    unlock_stripe(map_p, hash);
+
+    if (node_p != NULL) {
+        retire_node(thread_p, node_p);
+    }
+    strmap_concurrent_leave(thread_p);
+    return node_p != NULL;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stdbool.h> // bool
+#include <stddef.h>  // size_t
+
+// string map shared by threads reading and writing at the same time.
+//
+// readers take no locks and write to no shared memory: they walk bucket chains whose nodes are never changed once
+// published. writers lock one of a fixed set of stripes, chosen by the hash, so writers to different stripes do not
+// wait for each other. a value is replaced by a new node rather than written in place. growing the table takes every
+// stripe and copies the chains into a new table, which is then published at once. readers keep using the old table
+// until then, and are never blocked.
+//
+// removed nodes and old tables are reclaimed by epochs. a thread enters the map before reading, and leaves it when it
+// no longer holds any value it read. memory removed while a thread is inside is freed only once it has left.
+typedef struct strmap_concurrent_type strmap_concurrent_type;
+
+// state of one thread using a map. not shared between threads.
+typedef struct strmap_concurrent_thread_type strmap_concurrent_thread_type;
+
+strmap_concurrent_type* strmap_concurrent_create(void);
+
+// no thread may be using the map.
+void strmap_concurrent_destroy(strmap_concurrent_type* map_p);
+
+strmap_concurrent_thread_type* strmap_concurrent_thread_register(strmap_concurrent_type* map_p);
+
+// the thread must have left the map. what it removed is freed with the map.
+void strmap_concurrent_thread_unregister(strmap_concurrent_thread_type* thread_p);
+
+// calls may be nested. only the outermost leave ends the protection of values read.
+void strmap_concurrent_enter(strmap_concurrent_thread_type* thread_p);
+
+void strmap_concurrent_leave(strmap_concurrent_thread_type* thread_p);
+
+size_t strmap_concurrent_get_count(const strmap_concurrent_type* map_p);
+
+// the thread must have entered the map. the value stays valid until it leaves.
+const char* strmap_concurrent_get(strmap_concurrent_thread_type* thread_p, const char* key_p);
+
+bool strmap_concurrent_contains(strmap_concurrent_thread_type* thread_p, const char* key_p);
+
+bool strmap_concurrent_set(strmap_concurrent_thread_type* thread_p, const char* key_p, const char* value_p);
+
+bool strmap_concurrent_del(strmap_concurrent_thread_type* thread_p, const char* key_p);
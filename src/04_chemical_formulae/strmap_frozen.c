@@ -0,0 +1,260 @@
+#include <stdbool.h> // bool, true, false
+#include <stdint.h>  // uint32_t, uint64_t, UINT32_MAX
+#include <stdlib.h>  // malloc, calloc, free, size_t
+#include <string.h>  // memcpy, strcmp, strlen
+
+#include "strmap.h" // strmap_type, strmap_for_each, strmap_get_count
+#include "strmap_frozen.h"
+#include "wyhash.h" // wyhash, wymix, WYHASH_SECRET, uint128_type
+
+#define KEYS_PER_BUCKET 4
+#define SPARE_SLOTS_DIVISOR 32 // one spare slot for every so many keys
+#define SALT_ATTEMPTS_MAX 8
+
+// map a hash onto [0, n) by its high bits.
+static inline size_t fast_range(uint64_t hash, size_t n) {
+    return (size_t)(((uint128_type)hash * n) >> 64);
+}
+
+static inline uint64_t salted_hash(uint64_t hash, uint64_t salt) {
+    return wymix(hash ^ WYHASH_SECRET[0], salt ^ WYHASH_SECRET[1]);
+}
+
+static inline uint64_t pilot_hash(uint32_t pilot) {
+    return wymix(pilot ^ WYHASH_SECRET[2], WYHASH_SECRET[3]) | 1;
+}
+
+// buckets are chosen by the high bits of the hash, so the slot within the table mixes in all of them again
+static inline size_t slot_of(uint64_t hash, uint64_t pilot_hash, size_t table_size) {
+    return fast_range(wymix(hash ^ WYHASH_SECRET[3], pilot_hash), table_size);
+}
+
+// find a pilot for every bucket, largest buckets first, that puts its keys in slots not yet taken. writes the slot of
+// every key to `key_slots_p`, and the slot taking the place of every spare slot in use to the remap table. fails if
+// some bucket has no pilot below `pilot_max`.
+static bool place_keys(strmap_frozen_type* frozen_p, const uint64_t* hashes_p, size_t* key_slots_p, uint32_t pilot_max) {
+    size_t count = frozen_p->count;
+    size_t table_size = frozen_p->table_size;
+    size_t bucket_count = frozen_p->bucket_count;
+    bool res = false;
+
+    size_t* bucket_offsets_p = calloc(bucket_count + 1, sizeof(size_t));
+    size_t* bucket_keys_p = malloc(sizeof(size_t) * count);
+    size_t* order_p = malloc(sizeof(size_t) * bucket_count);
+    uint64_t* taken_p = calloc(table_size / 64 + 1, sizeof(uint64_t));
+    size_t* size_offsets_p = NULL;
+    if (bucket_offsets_p == NULL || bucket_keys_p == NULL || order_p == NULL || taken_p == NULL) {
+        goto cleanup;
+    }
+
+    // group the keys by bucket, and the buckets by size, with counting sorts
+    size_t size_max = 0;
+    for (size_t i = 0; i < count; i++) {
+        bucket_offsets_p[fast_range(hashes_p[i], bucket_count) + 1]++;
+    }
+    for (size_t b = 0; b < bucket_count; b++) {
+        size_max = bucket_offsets_p[b + 1] > size_max ? bucket_offsets_p[b + 1] : size_max;
+        bucket_offsets_p[b + 1] += bucket_offsets_p[b];
+    }
+    for (size_t i = 0; i < count; i++) {
+        size_t b = fast_range(hashes_p[i], bucket_count);
+        bucket_keys_p[bucket_offsets_p[b]++] = i;
+    }
+    for (size_t b = bucket_count; b > 0; b--) {
+        bucket_offsets_p[b] = bucket_offsets_p[b - 1];
+    }
+    bucket_offsets_p[0] = 0;
+
+    size_offsets_p = calloc(size_max + 2, sizeof(size_t));
+    if (size_offsets_p == NULL) {
+        goto cleanup;
+    }
+    for (size_t b = 0; b < bucket_count; b++) {
+        size_offsets_p[size_max - (bucket_offsets_p[b + 1] - bucket_offsets_p[b]) + 1]++;
+    }
+    for (size_t s = 0; s <= size_max; s++) {
+        size_offsets_p[s + 1] += size_offsets_p[s];
+    }
+    for (size_t b = 0; b < bucket_count; b++) {
+        order_p[size_offsets_p[size_max - (bucket_offsets_p[b + 1] - bucket_offsets_p[b])]++] = b;
+    }
+
+    for (size_t o = 0; o < bucket_count; o++) {
+        size_t b = order_p[o];
+        size_t begin = bucket_offsets_p[b];
+        size_t end = bucket_offsets_p[b + 1];
+        uint32_t pilot = 0;
+        for (; begin < end; pilot++) {
+            if (pilot == pilot_max) {
+                goto cleanup;
+            }
+            uint64_t ph = pilot_hash(pilot);
+
+            // take the slots one by one, and give them back if one of them is taken already
+            size_t i = begin;
+            for (; i < end; i++) {
+                size_t slot = slot_of(hashes_p[bucket_keys_p[i]], ph, table_size);
+                if (taken_p[slot / 64] >> (slot % 64) & 1) {
+                    break;
+                }
+                taken_p[slot / 64] |= (uint64_t)1 << (slot % 64);
+                key_slots_p[bucket_keys_p[i]] = slot;
+            }
+            if (i == end) {
+                break;
+            }
+            while (i-- > begin) {
+                size_t slot = key_slots_p[bucket_keys_p[i]];
+                taken_p[slot / 64] &= ~((uint64_t)1 << (slot % 64));
+            }
+        }
+        frozen_p->pilots_p[b] = pilot;
+    }
+
+    // as many slots below the count are free as keys were placed in spare slots. pair them up in order.
+    size_t free_slot = 0;
+    for (size_t slot = count; slot < table_size; slot++) {
+        if (taken_p[slot / 64] >> (slot % 64) & 1) {
+            while (taken_p[free_slot / 64] >> (free_slot % 64) & 1) {
+                free_slot++;
+            }
+            frozen_p->remap_p[slot - count] = (uint32_t)free_slot++;
+        }
+    }
+    res = true;
+
+cleanup:
+    free(bucket_offsets_p);
+    free(bucket_keys_p);
+    free(order_p);
+    free(taken_p);
+    free(size_offsets_p);
+    return res;
+}
+
+strmap_frozen_type* strmap_freeze(const strmap_type* strmap_p) {
+    size_t count = strmap_get_count(strmap_p);
+    strmap_frozen_type* frozen_p = calloc(1, sizeof(strmap_frozen_type));
+    uint64_t* hashes_p = malloc(sizeof(uint64_t) * (count + 1));
+    uint64_t* salted_p = malloc(sizeof(uint64_t) * (count + 1));
+    uint32_t* offsets_p = malloc(sizeof(uint32_t) * (count + 1));
+    size_t* key_slots_p = malloc(sizeof(size_t) * (count + 1));
+    if (frozen_p == NULL || hashes_p == NULL || salted_p == NULL || offsets_p == NULL || key_slots_p == NULL) {
+        goto error;
+    }
+    frozen_p->count = count;
+    frozen_p->table_size = count + count / SPARE_SLOTS_DIVISOR + 1;
+    frozen_p->bucket_count = count / KEYS_PER_BUCKET + 1;
+    frozen_p->seed = strmap_p->seed;
+
+    // copy the keys and values to the pool. the hashes of the keys are kept by the nodes.
+    size_t pool_size = 0;
+    {
+        size_t list_index;
+        strmap_node_type* node_p = NULL;
+        const char* key_p = NULL;
+        const char* value_p = NULL;
+
+        (void)(key_p);
+        (void)(value_p);
+
+        strmap_for_each(strmap_p, list_index, node_p, key_p, value_p) {
+            pool_size += node_p->key_len + 1 + node_p->value_len + 1;
+        }
+    }
+    if (pool_size > UINT32_MAX) {
+        goto error;
+    }
+    frozen_p->pool_p = malloc(pool_size + 1);
+    frozen_p->pilots_p = malloc(sizeof(uint32_t) * frozen_p->bucket_count);
+    // spare slots not in use lead to slot 0, where the key does not match
+    frozen_p->remap_p = calloc(frozen_p->table_size - count, sizeof(uint32_t));
+    frozen_p->slots_p = malloc(sizeof(strmap_frozen_slot_type) * (count + 1));
+    if (frozen_p->pool_p == NULL || frozen_p->pilots_p == NULL || frozen_p->remap_p == NULL || frozen_p->slots_p == NULL) {
+        goto error;
+    }
+    {
+        size_t key_index = 0;
+        size_t pool_offset = 0;
+        size_t list_index;
+        strmap_node_type* node_p = NULL;
+        const char* key_p = NULL;
+        const char* value_p = NULL;
+        strmap_for_each(strmap_p, list_index, node_p, key_p, value_p) {
+            size_t key_size = node_p->key_len + 1;
+            size_t value_size = node_p->value_len + 1;
+            memcpy(&frozen_p->pool_p[pool_offset], key_p, key_size);
+            memcpy(&frozen_p->pool_p[pool_offset + key_size], value_p, value_size);
+            hashes_p[key_index] = node_p->hash;
+            offsets_p[key_index++] = (uint32_t)pool_offset;
+            pool_offset += key_size + value_size;
+        }
+    }
+
+    // the spare slots keep a few slots free to the end, so even the last buckets are placed in a few tries. if some
+    // bucket cannot be placed, the hashes are remixed with another salt.
+    uint32_t pilot_max = 1 << 20;
+    bool placed = false;
+    for (uint64_t salt = 0; salt < SALT_ATTEMPTS_MAX && !placed; salt++) {
+        frozen_p->salt = salt;
+        for (size_t i = 0; i < count; i++) {
+            salted_p[i] = salted_hash(hashes_p[i], salt);
+        }
+        placed = place_keys(frozen_p, salted_p, key_slots_p, pilot_max);
+    }
+    if (!placed) {
+        goto error;
+    }
+    for (size_t i = 0; i < count; i++) {
+        size_t slot = key_slots_p[i] < count ? key_slots_p[i] : frozen_p->remap_p[key_slots_p[i] - count];
+        uint32_t key_offset = offsets_p[i];
+        uint32_t value_offset = key_offset + (uint32_t)strlen(&frozen_p->pool_p[key_offset]) + 1;
+        frozen_p->slots_p[slot] = (strmap_frozen_slot_type){.key_offset = key_offset, .value_offset = value_offset};
+    }
+    free(hashes_p);
+    free(salted_p);
+    free(offsets_p);
+    free(key_slots_p);
+    return frozen_p;
+
+error:
+    free(hashes_p);
+    free(salted_p);
+    free(offsets_p);
+    free(key_slots_p);
+    strmap_frozen_destroy(frozen_p);
+    return NULL;
+}
+
+void strmap_frozen_destroy(strmap_frozen_type* frozen_p) {
+    if (frozen_p == NULL) {
+        return;
+    }
+    free(frozen_p->pilots_p);
+    free(frozen_p->remap_p);
+    free(frozen_p->slots_p);
+    free(frozen_p->pool_p);
+    free(frozen_p);
+}
+
+size_t strmap_frozen_get_count(const strmap_frozen_type* frozen_p) {
+    return frozen_p->count;
+}
+
+const char* strmap_frozen_get(const strmap_frozen_type* frozen_p, const char* key_p) {
+    if (frozen_p->count == 0) {
+        return NULL;
+    }
+    uint64_t hash = salted_hash(wyhash((const unsigned char*)key_p, strlen(key_p), frozen_p->seed), frozen_p->salt);
+    uint32_t pilot = frozen_p->pilots_p[fast_range(hash, frozen_p->bucket_count)];
+    size_t slot = slot_of(hash, pilot_hash(pilot), frozen_p->table_size);
+    if (slot >= frozen_p->count) {
+        slot = frozen_p->remap_p[slot - frozen_p->count];
+    }
+    const strmap_frozen_slot_type* slot_p = &frozen_p->slots_p[slot];
+    return strcmp(&frozen_p->pool_p[slot_p->key_offset], key_p) == 0 ? &frozen_p->pool_p[slot_p->value_offset] : NULL;
+}
+
+const char* strmap_frozen_key(const strmap_frozen_type* frozen_p, size_t index) {
+    return &frozen_p->pool_p[frozen_p->slots_p[index].key_offset];
+}
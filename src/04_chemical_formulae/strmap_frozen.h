@@ -0,0 +1,43 @@
+#pragma once
+
+#include <stddef.h> // size_t
+#include <stdint.h> // uint32_t, uint64_t
+
+#include "strmap.h" // strmap_type
+
+// immutable copy of a `strmap`, for maps that are no longer changed once loaded.
+//
+// the keys are placed with a minimal perfect hash, so every key has a slot of its own and there are no more slots than
+// keys. the hash of a key picks a bucket, and the pilot of the bucket picks the slot of every key in it (as in PTHash).
+// pilots are searched over a few spare slots past the count, so the last buckets do not need as many tries as there are
+// keys. the keys placed in spare slots are moved to the free slots below the count, through a small remap table.
+// a lookup is one probe and one comparison of the key. the keys and values are kept in one pool of strings, which the
+// slots refer to by offset.
+typedef struct {
+    uint32_t key_offset;
+    uint32_t value_offset;
+} strmap_frozen_slot_type;
+
+typedef struct {
+    size_t count;
+    size_t table_size; // the count and the spare slots
+    size_t bucket_count;
+    uint64_t seed; // of the hash of the keys, the same as in the map
+    uint64_t salt; // remixes the hashes, if placing the keys failed with the ones before
+    uint32_t* pilots_p;
+    uint32_t* remap_p; // slot below the count for every spare slot in use
+    strmap_frozen_slot_type* slots_p;
+    char* pool_p;
+} strmap_frozen_type;
+
+// NULL if there is not enough memory or the strings do not fit 32-bit offsets. the map is not changed.
+strmap_frozen_type* strmap_freeze(const strmap_type* strmap_p);
+
+void strmap_frozen_destroy(strmap_frozen_type* frozen_p);
+
+size_t strmap_frozen_get_count(const strmap_frozen_type* frozen_p);
+
+const char* strmap_frozen_get(const strmap_frozen_type* frozen_p, const char* key_p);
+
+// the key in slot `index`, below the count.
+const char* strmap_frozen_key(const strmap_frozen_type* frozen_p, size_t index);
@@ -0,0 +1,445 @@
+#include <stdbool.h> // bool, true, false
+#include <stdint.h>  // uint32_t, uint64_t
+#include <stdlib.h>  // malloc, realloc, free, size_t
+#include <string.h>  // memcpy, memmove, strcmp, strlen
+
+#include "random_seed.h" // random_seed
+#include "strmap_persistent.h"
+#include "wyhash.h" // wyhash
+
+#define BITS_PER_LEVEL 5
+#define LEVEL_MASK ((1 << BITS_PER_LEVEL) - 1)
+#define HASH_BITS 64
+
+typedef enum { NODE_KIND_BRANCH, NODE_KIND_LEAF, NODE_KIND_COLLISION } node_kind_type;
+
+// common start of every node
+struct strmap_persistent_node_type {
+    size_t refcount;
+    node_kind_type kind;
+};
+
+typedef struct {
+    strmap_persistent_node_type header;
+    uint32_t bitmap; // children present, by the five bits of the hash at this level
+    strmap_persistent_node_type* children_p[];
+} branch_type;
+
+typedef struct {
+    strmap_persistent_node_type header;
+    uint64_t hash;
+    char* value_p; // points after the key
+    char key[];    // followed by the value
+} leaf_type;
+
+typedef struct {
+    strmap_persistent_node_type header;
+    uint64_t hash; // of every leaf
+    size_t count;
+    leaf_type* leaves_p[];
+} collision_type;
+
+static inline uint32_t level_index(uint64_t hash, unsigned shift) {
+    return (uint32_t)(hash >> shift) & LEVEL_MASK;
+}
+
+// position of the child for `bit` among the children present.
+static inline unsigned child_pos(uint32_t bitmap, uint32_t bit) {
+    return (unsigned)__builtin_popcount(bitmap & (bit - 1));
+}
+
+static inline uint64_t node_hash(const strmap_persistent_node_type* node_p) {
+    return node_p->kind == NODE_KIND_LEAF ? ((const leaf_type*)node_p)->hash : ((const collision_type*)node_p)->hash;
+}
+
+static void node_release(strmap_persistent_node_type* node_p) {
+    if (node_p == NULL || --node_p->refcount != 0) {
+        return;
+    }
+    if (node_p->kind == NODE_KIND_BRANCH) {
+        branch_type* branch_p = (branch_type*)node_p;
+        unsigned count = (unsigned)__builtin_popcount(branch_p->bitmap);
+        for (unsigned i = 0; i < count; i++) {
+            node_release(branch_p->children_p[i]);
+        }
+    } else if (node_p->kind == NODE_KIND_COLLISION) {
+        collision_type* collision_p = (collision_type*)node_p;
+        for (size_t i = 0; i < collision_p->count; i++) {
+            node_release(&collision_p->leaves_p[i]->header);
+        }
+    }
+    free(node_p);
+}
+
+static leaf_type* leaf_create(uint64_t hash, const char* key_p, const char* value_p) {
+    size_t key_size = strlen(key_p) + 1;
+    size_t value_size = strlen(value_p) + 1;
+    leaf_type* leaf_p = malloc(sizeof(leaf_type) + key_size + value_size);
+    if (leaf_p == NULL) {
+        return NULL;
+    }
+    leaf_p->header = (strmap_persistent_node_type){.refcount = 1, .kind = NODE_KIND_LEAF};
+    leaf_p->hash = hash;
+    memcpy(leaf_p->key, key_p, key_size);
+    memcpy(leaf_p->key + key_size, value_p, value_size);
+    leaf_p->value_p = leaf_p->key + key_size;
+    return leaf_p;
+}
+
+// branch with room for `count` children, which are filled in by the caller.
+static branch_type* branch_create(uint32_t bitmap, unsigned count) {
+    branch_type* branch_p = malloc(sizeof(branch_type) + sizeof(strmap_persistent_node_type*) * count);
+    if (branch_p == NULL) {
+        return NULL;
+    }
+    branch_p->header = (strmap_persistent_node_type){.refcount = 1, .kind = NODE_KIND_BRANCH};
+    branch_p->bitmap = bitmap;
+    return branch_p;
+}
+
+// a branch, or a collision node, that only this map holds and that has room for `extra` more children. a shared node
+// is copied, taking a reference to each of its children, and the reference to the original is given up.
+static strmap_persistent_node_type* node_unshare(strmap_persistent_node_type* node_p, size_t extra) {
+    size_t count;
+    size_t header_size;
+    if (node_p->kind == NODE_KIND_BRANCH) {
+        count = (size_t)__builtin_popcount(((branch_type*)node_p)->bitmap);
+        header_size = sizeof(branch_type);
+    } else {
+        count = ((collision_type*)node_p)->count;
+        header_size = sizeof(collision_type);
+    }
+    size_t size = header_size + sizeof(strmap_persistent_node_type*) * (count + extra);
+    if (node_p->refcount == 1) {
+        return extra == 0 ? node_p : realloc(node_p, size);
+    }
+    strmap_persistent_node_type* copy_p = malloc(size);
+    if (copy_p == NULL) {
+        return NULL;
+    }
+    memcpy(copy_p, node_p, header_size + sizeof(strmap_persistent_node_type*) * count);
+    copy_p->refcount = 1;
+    for (size_t i = 0; i < count; i++) {
+        if (node_p->kind == NODE_KIND_BRANCH) {
+            ((branch_type*)copy_p)->children_p[i]->refcount++;
+        } else {
+            ((collision_type*)copy_p)->leaves_p[i]->header.refcount++;
+        }
+    }
+    node_p->refcount--;
+    return copy_p;
+}
+
+// join two nodes with different hashes under branches from level `shift` down, until their hashes differ.
+static strmap_persistent_node_type* node_join(strmap_persistent_node_type* a_p, strmap_persistent_node_type* b_p,
+                                              unsigned shift) {
+    uint32_t a_index = level_index(node_hash(a_p), shift);
+    uint32_t b_index = level_index(node_hash(b_p), shift);
+    if (a_index == b_index) {
+        branch_type* branch_p = branch_create((uint32_t)1 << a_index, 1);
+        if (branch_p == NULL) {
+            return NULL;
+        }
+        branch_p->children_p[0] = node_join(a_p, b_p, shift + BITS_PER_LEVEL);
+        if (branch_p->children_p[0] == NULL) {
+            free(branch_p);
+            return NULL;
+        }
+        return &branch_p->header;
+    }
+    branch_type* branch_p = branch_create((uint32_t)1 << a_index | (uint32_t)1 << b_index, 2);
+    if (branch_p == NULL) {
+        return NULL;
+    }
+    branch_p->children_p[a_index < b_index ? 0 : 1] = a_p;
+    branch_p->children_p[a_index < b_index ? 1 : 0] = b_p;
+    return &branch_p->header;
+}
+
+// set `leaf_p` in the trie at `node_p`, from level `shift` down. takes the reference to `node_p` and returns the
+// reference to the node replacing it. if there is not enough memory, `oom_p` is set and the leaf is not in the trie.
+static strmap_persistent_node_type* node_set(strmap_persistent_node_type* node_p, leaf_type* leaf_p, unsigned shift,
+                                             bool* added_p, bool* oom_p) {
+    if (node_p == NULL) {
+        *added_p = true;
+        return &leaf_p->header;
+    }
+    switch (node_p->kind) {
+    case NODE_KIND_LEAF: {
+        leaf_type* old_leaf_p = (leaf_type*)node_p;
+        if (old_leaf_p->hash == leaf_p->hash && strcmp(old_leaf_p->key, leaf_p->key) == 0) {
+            node_release(node_p);
+            return &leaf_p->header;
+        }
+        strmap_persistent_node_type* joined_p = NULL;
+        if (old_leaf_p->hash != leaf_p->hash) {
+            joined_p = node_join(node_p, &leaf_p->header, shift);
+        } else {
+            collision_type* collision_p = malloc(sizeof(collision_type) + sizeof(leaf_type*) * 2);
+            if (collision_p != NULL) {
+                collision_p->header = (strmap_persistent_node_type){.refcount = 1, .kind = NODE_KIND_COLLISION};
+                collision_p->hash = leaf_p->hash;
+                collision_p->count = 2;
+                collision_p->leaves_p[0] = old_leaf_p;
+                collision_p->leaves_p[1] = leaf_p;
+                joined_p = &collision_p->header;
+            }
+        }
+        if (joined_p == NULL) {
+            *oom_p = true;
+            return node_p;
+        }
+        *added_p = true;
+        return joined_p;
+    }
+    case NODE_KIND_COLLISION: {
+        collision_type* collision_p = (collision_type*)node_p;
+        if (collision_p->hash != leaf_p->hash) {
+            strmap_persistent_node_type* joined_p = node_join(node_p, &leaf_p->header, shift);
+            if (joined_p == NULL) {
+                *oom_p = true;
+                return node_p;
+            }
+            *added_p = true;
+            return joined_p;
+        }
+        size_t i = 0;
+        while (i < collision_p->count && strcmp(collision_p->leaves_p[i]->key, leaf_p->key) != 0) {
+            i++;
+        }
+        bool added = i == collision_p->count;
+        collision_p = (collision_type*)node_unshare(node_p, added ? 1 : 0);
+        if (collision_p == NULL) {
+            *oom_p = true;
+            return node_p;
+        }
+        if (added) {
+            collision_p->count++;
+        } else {
+            node_release(&collision_p->leaves_p[i]->header);
+        }
+        collision_p->leaves_p[i] = leaf_p;
+        *added_p = added;
+        return &collision_p->header;
+    }
+    case NODE_KIND_BRANCH:
+    default: {
+        uint32_t bit = (uint32_t)1 << level_index(leaf_p->hash, shift);
+        bool present = (((branch_type*)node_p)->bitmap & bit) != 0;
+        branch_type* branch_p = (branch_type*)node_unshare(node_p, present ? 0 : 1);
+        if (branch_p == NULL) {
+            *oom_p = true;
+            return node_p;
+        }
+        unsigned pos = child_pos(branch_p->bitmap, bit);
+        if (present) {
+            branch_p->children_p[pos] = node_set(branch_p->children_p[pos], leaf_p, shift + BITS_PER_LEVEL, added_p, oom_p);
+            return &branch_p->header;
+        }
+        unsigned count = (unsigned)__builtin_popcount(branch_p->bitmap);
+        memmove(&branch_p->children_p[pos + 1], &branch_p->children_p[pos], sizeof(branch_p->children_p[0]) * (count - pos));
+        branch_p->children_p[pos] = &leaf_p->header;
+        branch_p->bitmap |= bit;
+        *added_p = true;
+        return &branch_p->header;
+    }
+    }
+}
+
+// delete the key, which is in the trie at `node_p`. takes the reference to `node_p` and returns the reference to the
+// node replacing it, which is NULL if none is left. `oom_p` is set if there is not enough memory.
+static strmap_persistent_node_type* node_del(strmap_persistent_node_type* node_p, uint64_t hash, const char* key_p,
+                                             unsigned shift, bool* oom_p) {
+    switch (node_p->kind) {
+    case NODE_KIND_LEAF:
+        node_release(node_p);
+        return NULL;
+    case NODE_KIND_COLLISION: {
+        collision_type* collision_p = (collision_type*)node_unshare(node_p, 0);
+        if (collision_p == NULL) {
+            *oom_p = true;
+            return node_p;
+        }
+        size_t i = 0;
+        while (strcmp(collision_p->leaves_p[i]->key, key_p) != 0) {
+            i++;
+        }
+        node_release(&collision_p->leaves_p[i]->header);
+        collision_p->leaves_p[i] = collision_p->leaves_p[--collision_p->count];
+        if (collision_p->count > 1) {
+            return &collision_p->header;
+        }
+        leaf_type* last_leaf_p = collision_p->leaves_p[0];
+        free(collision_p);
+        return &last_leaf_p->header;
+    }
+    case NODE_KIND_BRANCH:
+    default: {
+        branch_type* branch_p = (branch_type*)node_unshare(node_p, 0);
+        if (branch_p == NULL) {
+            *oom_p = true;
+            return node_p;
+        }
+        uint32_t bit = (uint32_t)1 << level_index(hash, shift);
+        unsigned pos = child_pos(branch_p->bitmap, bit);
+        strmap_persistent_node_type* child_p = node_del(branch_p->children_p[pos], hash, key_p, shift + BITS_PER_LEVEL, oom_p);
+        if (*oom_p) {
+            branch_p->children_p[pos] = child_p;
+            return &branch_p->header;
+        }
+        unsigned count = (unsigned)__builtin_popcount(branch_p->bitmap);
+        if (child_p != NULL) {
+            branch_p->children_p[pos] = child_p;
+        } else {
+            memmove(&branch_p->children_p[pos], &branch_p->children_p[pos + 1], sizeof(branch_p->children_p[0]) * (count - pos - 1));
+            branch_p->bitmap &= ~bit;
+            count--;
+        }
+        // a branch left with nothing below but one leaf or collision node is replaced by it, except at the root
+        if (count == 0) {
+            free(branch_p);
+            return NULL;
+        }
+        if (count == 1 && shift != 0 && branch_p->children_p[0]->kind != NODE_KIND_BRANCH) {
+            strmap_persistent_node_type* only_p = branch_p->children_p[0];
+            free(branch_p);
+            return only_p;
+        }
+        return &branch_p->header;
+    }
+    }
+}
+
+static const leaf_type* node_find(const strmap_persistent_node_type* node_p, uint64_t hash, const char* key_p) {
+    for (unsigned shift = 0; node_p != NULL; shift += BITS_PER_LEVEL) {
+        if (node_p->kind == NODE_KIND_LEAF) {
+            const leaf_type* leaf_p = (const leaf_type*)node_p;
+            return leaf_p->hash == hash && strcmp(leaf_p->key, key_p) == 0 ? leaf_p : NULL;
+        }
+        if (node_p->kind == NODE_KIND_COLLISION) {
+            const collision_type* collision_p = (const collision_type*)node_p;
+            for (size_t i = 0; collision_p->hash == hash && i < collision_p->count; i++) {
+                if (strcmp(collision_p->leaves_p[i]->key, key_p) == 0) {
+                    return collision_p->leaves_p[i];
+                }
+            }
+            return NULL;
+        }
+        const branch_type* branch_p = (const branch_type*)node_p;
+        uint32_t bit = (uint32_t)1 << level_index(hash, shift);
+        if ((branch_p->bitmap & bit) == 0) {
+            return NULL;
+        }
+        node_p = branch_p->children_p[child_pos(branch_p->bitmap, bit)];
+    }
+    return NULL;
+}
+
+static inline uint64_t strmap_persistent_hash(const strmap_persistent_type* map_p, const char* key_p) {
+    return wyhash((const unsigned char*)key_p, strlen(key_p), map_p->seed);
+}
+
+strmap_persistent_type* strmap_persistent_create(void) {
+    strmap_persistent_type* map_p = malloc(sizeof(strmap_persistent_type));
+    if (map_p == NULL) {
+        return NULL;
+    }
+    *map_p = (strmap_persistent_type){.count = 0, .seed = 0, .root_p = NULL};
+    map_p->seed = random_seed(map_p);
+    return map_p;
+}
+
+void strmap_persistent_destroy(strmap_persistent_type* map_p) {
+    if (map_p == NULL) {
+        return;
+    }
+    node_release(map_p->root_p);
+    free(map_p);
+}
+
+strmap_persistent_type* strmap_persistent_clone(const strmap_persistent_type* map_p) {
+    strmap_persistent_type* clone_p = malloc(sizeof(strmap_persistent_type));
+    if (clone_p == NULL) {
+        return NULL;
+    }
+    *clone_p = *map_p;
+    if (clone_p->root_p != NULL) {
+        clone_p->root_p->refcount++;
+    }
+    return clone_p;
+}
+
+size_t strmap_persistent_get_count(const strmap_persistent_type* map_p) {
+    return map_p->count;
+}
+
+bool strmap_persistent_contains(const strmap_persistent_type* map_p, const char* key_p) {
+    return node_find(map_p->root_p, strmap_persistent_hash(map_p, key_p), key_p) != NULL;
+}
+
+const char* strmap_persistent_get(const strmap_persistent_type* map_p, const char* key_p) {
+    const leaf_type* leaf_p = node_find(map_p->root_p, strmap_persistent_hash(map_p, key_p), key_p);
+    return leaf_p != NULL ? leaf_p->value_p : NULL;
+}
+
+bool strmap_persistent_set(strmap_persistent_type* map_p, const char* key_p, const char* value_p) {
+    leaf_type* leaf_p = leaf_create(strmap_persistent_hash(map_p, key_p), key_p, value_p);
+    if (leaf_p == NULL) {
+        return false;
+    }
+    bool added = false;
+    bool oom = false;
+    map_p->root_p = node_set(map_p->root_p, leaf_p, 0, &added, &oom);
+    if (oom) {
+        free(leaf_p);
+        return false;
+    }
+    map_p->count += added;
+    return true;
+}
+
+bool strmap_persistent_del(strmap_persistent_type* map_p, const char* key_p) {
+    uint64_t hash = strmap_persistent_hash(map_p, key_p);
+
+    // only copy the path to keys that are there
+    if (node_find(map_p->root_p, hash, key_p) == NULL) {
+        return false;
+    }
+    bool oom = false;
+    map_p->root_p = node_del(map_p->root_p, hash, key_p, 0, &oom);
+    if (oom) {
+        return false;
+    }
+    map_p->count--;
+    return true;
+}
+
+static bool node_for_each(const strmap_persistent_node_type* node_p, bool (*visit_f_p)(const char*, const char*, void*),
+                          void* context_p) {
+    switch (node_p->kind) {
+    case NODE_KIND_LEAF:
+        return visit_f_p(((const leaf_type*)node_p)->key, ((const leaf_type*)node_p)->value_p, context_p);
+    case NODE_KIND_COLLISION:
+        for (size_t i = 0; i < ((const collision_type*)node_p)->count; i++) {
+            if (!node_for_each(&((const collision_type*)node_p)->leaves_p[i]->header, visit_f_p, context_p)) {
+                return false;
+            }
+        }
+        return true;
+    case NODE_KIND_BRANCH:
+    default:
+        for (unsigned i = 0; i < (unsigned)__builtin_popcount(((const branch_type*)node_p)->bitmap); i++) {
+            if (!node_for_each(((const branch_type*)node_p)->children_p[i], visit_f_p, context_p)) {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+void strmap_persistent_for_each(const strmap_persistent_type* map_p, bool (*visit_f_p)(const char*, const char*, void*),
+                                void* context_p) {
+    if (map_p->root_p != NULL) {
+        node_for_each(map_p->root_p, visit_f_p, context_p);
+    }
+}
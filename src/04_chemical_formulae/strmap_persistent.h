@@ -0,0 +1,43 @@
+#pragma once
+
+#include <stdbool.h> // bool
+#include <stddef.h>  // size_t
+#include <stdint.h>  // uint64_t
+
+// string map whose clones share their structure, for taking consistent views of a map that keeps changing.
+//
+// the map is a hash array mapped trie: every level of the trie branches on five bits of the hash, and keeps only the
+// children that exist. nodes are reference counted, so a clone only takes another reference to the root, and both maps
+// go on to share every node. a write copies the nodes on the path to its key that are shared, and changes the nodes
+// only this map holds in place. keys with the same 64-bit hash are kept in a collision node at the bottom.
+//
+// reference counts are not atomic: maps sharing nodes must be used from one thread, or be guarded by the caller.
+typedef struct strmap_persistent_node_type strmap_persistent_node_type;
+
+typedef struct {
+    size_t count;
+    uint64_t seed; // of the hash function, shared with clones
+    strmap_persistent_node_type* root_p;
+} strmap_persistent_type;
+
+strmap_persistent_type* strmap_persistent_create(void);
+
+void strmap_persistent_destroy(strmap_persistent_type* map_p);
+
+// in constant time. later writes to either map are not seen by the other.
+strmap_persistent_type* strmap_persistent_clone(const strmap_persistent_type* map_p);
+
+size_t strmap_persistent_get_count(const strmap_persistent_type* map_p);
+
+bool strmap_persistent_contains(const strmap_persistent_type* map_p, const char* key_p);
+
+// the value stays valid until the key is set or deleted in this map, or the map is destroyed.
+const char* strmap_persistent_get(const strmap_persistent_type* map_p, const char* key_p);
+
+bool strmap_persistent_set(strmap_persistent_type* map_p, const char* key_p, const char* value_p);
+
+bool strmap_persistent_del(strmap_persistent_type* map_p, const char* key_p);
+
+// call `visit_f_p` with every pair, until it returns false.
+void strmap_persistent_for_each(const strmap_persistent_type* map_p, bool (*visit_f_p)(const char*, const char*, void*),
+                                void* context_p);
@@ -0,0 +1,52 @@
+#include <assert.h>  // assert
+#include <stdbool.h> // bool, true, false
+#include <stdlib.h>  // malloc, free
+#include <string.h>  // memcpy, strlen
+
+#include "write_buffer.h"
+
+bool write_buffer_init(write_buffer_type* wb_p, FILE* fp, size_t capacity) {
+    assert(wb_p != NULL);
+    assert(capacity > 0);
+
+    *wb_p = (write_buffer_type){.fp = fp, .buf = malloc(capacity), .len = 0, .capacity = capacity};
+    return wb_p->buf != NULL;
+}
+
+void write_buffer_destroy(write_buffer_type* wb_p) {
+    assert(wb_p != NULL);
+
+    write_buffer_flush(wb_p);
+    free(wb_p->buf);
+    wb_p->buf = NULL;
+}
+
+bool write_buffer_flush(write_buffer_type* wb_p) {
+    assert(wb_p != NULL);
+
+    if (wb_p->len == 0) {
+        return true;
+    }
+    size_t written = fwrite(wb_p->buf, 1, wb_p->len, wb_p->fp);
+    bool success = written == wb_p->len;
+    wb_p->len = 0;
+    return success && fflush(wb_p->fp) == 0;
+}
+
+bool write_buffer_write(write_buffer_type* wb_p, const char* str, size_t n) {
+    assert(wb_p != NULL);
+
+    if (wb_p->len + n > wb_p->capacity && !write_buffer_flush(wb_p)) {
+        return false;
+    }
+    if (n > wb_p->capacity) {
+        return fwrite(str, 1, n, wb_p->fp) == n;
+    }
+    memcpy(&wb_p->buf[wb_p->len], str, n);
+    wb_p->len += n;
+    return true;
+}
+
+bool write_buffer_write_str(write_buffer_type* wb_p, const char* str) {
+    return write_buffer_write(wb_p, str, strlen(str));
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <stdbool.h> // bool
+#include <stddef.h>  // size_t
+#include <stdio.h>   // FILE
+
+#define WRITE_BUFFER_DEFAULT_CAPACITY (1 << 16)
+
+// output buffer that is written to `fp` in blocks of `capacity` bytes.
+typedef struct {
+    FILE* fp;
+    char* buf;
+    size_t len;
+    size_t capacity;
+} write_buffer_type;
+
+bool write_buffer_init(write_buffer_type* wb_p, FILE* fp, size_t capacity);
+
+// flushes the buffer before releasing it.
+void write_buffer_destroy(write_buffer_type* wb_p);
+
+bool write_buffer_flush(write_buffer_type* wb_p);
+
+bool write_buffer_write(write_buffer_type* wb_p, const char* str, size_t n);
+
+// as `write_buffer_write` for a null-terminated string.
+bool write_buffer_write_str(write_buffer_type* wb_p, const char* str);
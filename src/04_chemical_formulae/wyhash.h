@@ -0,0 +1,92 @@
+/*
+    wyhash, final version 4, with the default secret.
+    https://github.com/wangyi-fudan/wyhash
+
+    reads are little-endian, so a hash is the same on every platform and may be stored.
+*/
+
+#pragma once
+
+#include <stddef.h> // size_t
+#include <stdint.h> // uint64_t, uint32_t
+#include <string.h> // memcpy
+
+__extension__ typedef unsigned __int128 uint128_type;
+
+static const uint64_t WYHASH_SECRET[4] = {0x2d358dccaa6c78a5UL, 0x8bb84b93962eacc9UL, 0x4b33a62ed433d4a3UL,
+                                          0x4d5a2da51de1aa47UL};
+
+static inline void wymum(uint64_t* a_p, uint64_t* b_p) {
+    uint128_type r = (uint128_type)*a_p * *b_p;
+    *a_p = (uint64_t)r;
+    *b_p = (uint64_t)(r >> 64);
+}
+
+static inline uint64_t wymix(uint64_t a, uint64_t b) {
+    wymum(&a, &b);
+    return a ^ b;
+}
+
+static inline uint64_t wyr8(const unsigned char* p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap64(v);
+#endif
+    return v;
+}
+
+static inline uint64_t wyr4(const unsigned char* p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap32(v);
+#endif
+    return v;
+}
+
+static inline uint64_t wyr3(const unsigned char* p, size_t k) {
+    return ((uint64_t)p[0] << 16) | ((uint64_t)p[k >> 1] << 8) | p[k - 1];
+}
+
+static inline uint64_t wyhash(const unsigned char* p, size_t len, uint64_t seed) {
+    const uint64_t* s = WYHASH_SECRET;
+    seed ^= wymix(seed ^ s[0], s[1]);
+
+    uint64_t a, b;
+    if (len <= 16) {
+        if (len >= 4) {
+            a = (wyr4(p) << 32) | wyr4(p + ((len >> 3) << 2));
+            b = (wyr4(p + len - 4) << 32) | wyr4(p + len - 4 - ((len >> 3) << 2));
+        } else if (len > 0) {
+            a = wyr3(p, len);
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        size_t i = len;
+        if (i > 48) {
+            uint64_t see1 = seed, see2 = seed;
+            do {
+                seed = wymix(wyr8(p) ^ s[1], wyr8(p + 8) ^ seed);
+                see1 = wymix(wyr8(p + 16) ^ s[2], wyr8(p + 24) ^ see1);
+                see2 = wymix(wyr8(p + 32) ^ s[3], wyr8(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            } while (i > 48);
+            seed ^= see1 ^ see2;
+        }
+        while (i > 16) {
+            seed = wymix(wyr8(p) ^ s[1], wyr8(p + 8) ^ seed);
+            i -= 16;
+            p += 16;
+        }
+        a = wyr8(p + i - 16);
+        b = wyr8(p + i - 8);
+    }
+    a ^= s[1];
+    b ^= seed;
+    wymum(&a, &b);
+    return wymix(a ^ s[0] ^ len, b ^ s[1]);
+}
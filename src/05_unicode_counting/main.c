@@ -1,3 +1,4 @@
+#include <assert.h>
 #include <errno.h>
 #include <stdbool.h>
 #include <stdint.h>
@@ -5,19 +6,17 @@
 #include <stdlib.h>
 #include <string.h>
 
-#define NAME ucharht
-#define KEY_TYPE char*
-#define VALUE_TYPE unsigned int
-#define KEY_IS_EQUAL(a, b) (strcmp((a), (b)) == 0)
-#define HASH_FUNCTION(key) (fnvhash_32_str(key))
-#include "fhashtable.h"
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "utf8_validate.h"
 
 #define NAME ucharpque
-#define VALUE_TYPE char*
+#define VALUE_TYPE uint32_t
 #include "fpqueue.h"
 
-#include "arena.h"
-
+// `s` must start a valid sequence. see `utf8_validate`.
 size_t utf8_num_of_bytes(const unsigned char* s) {
     // https://en.wikipedia.org/wiki/UTF-8#Encoding
 
@@ -33,6 +32,7 @@ size_t utf8_num_of_bytes(const unsigned char* s) {
     assert(false);
 }
 
+// `s` must start a valid sequence.
 uint32_t utf8_get_differing_bits(const unsigned char* s) {
     if (s[0] >> 7 == 0) {
         return (uint32_t)s[0];
@@ -59,8 +59,126 @@ uint32_t utf8_get_differing_bits(const unsigned char* s) {
     return retval;
 }
 
-int int_max(const int a, const int b) {
-    return (a >= b) ? a : b;
+// write the utf8 encoding of a code point to `s`, and return the number of bytes.
+size_t utf8_encode(uint32_t code_point, char* s) {
+    if (code_point < 0x80) {
+        s[0] = (char)code_point;
+        return 1;
+    } else if (code_point < 0x800) {
+        s[0] = (char)(0b11000000 | (code_point >> 6));
+        s[1] = (char)(0b10000000 | (code_point & 0b00111111));
+        return 2;
+    } else if (code_point < 0x10000) {
+        s[0] = (char)(0b11100000 | (code_point >> 12));
+        s[1] = (char)(0b10000000 | ((code_point >> 6) & 0b00111111));
+        s[2] = (char)(0b10000000 | (code_point & 0b00111111));
+        return 3;
+    }
+    s[0] = (char)(0b11110000 | (code_point >> 18));
+    s[1] = (char)(0b10000000 | ((code_point >> 12) & 0b00111111));
+    s[2] = (char)(0b10000000 | ((code_point >> 6) & 0b00111111));
+    s[3] = (char)(0b10000000 | (code_point & 0b00111111));
+    return 4;
+}
+
+#define code_point_end 0x110000
+#define replacement_character 0xFFFD
+#define ascii_size 0x80
+#define bmp_size 0x10000
+#define page_bits 8
+#define page_size (1 << page_bits)
+
+// count of every code point. the basic multilingual plane, which holds ascii, is counted in a flat array. code points
+// of the supplementary planes are rare, so their counts are kept in pages of 256, allocated when first used.
+struct histogram_type {
+    unsigned int bmp_counts[bmp_size];
+    unsigned int* pages[(code_point_end - bmp_size) >> page_bits];
+
+    uint32_t* seen; // code points above ascii with a non-zero count, in order of first use
+    size_t seen_count;
+    size_t seen_capacity;
+};
+
+// count the run of ascii characters at the start of `s`, and return its length. whole blocks of 64 ascii bytes are
+// found with one comparison, and counted without further checks.
+static inline size_t histogram_add_ascii(struct histogram_type* hist_ptr, const unsigned char* s, size_t len) {
+    size_t i = 0;
+#if defined(__SSE2__)
+    while (len - i >= 64) {
+        __m128i block = _mm_or_si128(_mm_or_si128(_mm_loadu_si128((const __m128i*)&s[i]), _mm_loadu_si128((const __m128i*)&s[i + 16])),
+                                     _mm_or_si128(_mm_loadu_si128((const __m128i*)&s[i + 32]), _mm_loadu_si128((const __m128i*)&s[i + 48])));
+        if (_mm_movemask_epi8(block) != 0) {
+            break;
+        }
+        for (size_t j = i; j < i + 64; j++) {
+            hist_ptr->bmp_counts[s[j]]++;
+        }
+        i += 64;
+    }
+#endif
+    while (i < len && s[i] < ascii_size) {
+        hist_ptr->bmp_counts[s[i]]++;
+        i++;
+    }
+    return i;
+}
+
+// count a code point above ascii and below `code_point_end`. returns false if out of memory.
+static inline bool histogram_add(struct histogram_type* hist_ptr, uint32_t code_point) {
+    unsigned int* count_ptr;
+    if (code_point < bmp_size) {
+        count_ptr = &hist_ptr->bmp_counts[code_point];
+    } else {
+        unsigned int** page_ptr = &hist_ptr->pages[(code_point - bmp_size) >> page_bits];
+        if (*page_ptr == NULL && (*page_ptr = calloc(page_size, sizeof(unsigned int))) == NULL) {
+            return false;
+        }
+        count_ptr = &(*page_ptr)[code_point & (page_size - 1)];
+    }
+    if (*count_ptr == 0) {
+        if (hist_ptr->seen_count == hist_ptr->seen_capacity) {
+            size_t capacity = hist_ptr->seen_capacity == 0 ? 256 : 2 * hist_ptr->seen_capacity;
+            uint32_t* seen = realloc(hist_ptr->seen, capacity * sizeof(uint32_t));
+            if (seen == NULL) {
+                return false;
+            }
+            hist_ptr->seen = seen;
+            hist_ptr->seen_capacity = capacity;
+        }
+        hist_ptr->seen[hist_ptr->seen_count++] = code_point;
+    }
+    (*count_ptr)++;
+    return true;
+}
+
+static inline unsigned int histogram_get(const struct histogram_type* hist_ptr, uint32_t code_point) {
+    if (code_point < bmp_size) {
+        return hist_ptr->bmp_counts[code_point];
+    }
+    const unsigned int* page = hist_ptr->pages[(code_point - bmp_size) >> page_bits];
+    return page != NULL ? page[code_point & (page_size - 1)] : 0;
+}
+
+// zero the counts in use. the pages are kept.
+static void histogram_clear(struct histogram_type* hist_ptr) {
+    memset(hist_ptr->bmp_counts, 0, ascii_size * sizeof(unsigned int));
+    for (size_t i = 0; i < hist_ptr->seen_count; i++) {
+        uint32_t code_point = hist_ptr->seen[i];
+        if (code_point < bmp_size) {
+            hist_ptr->bmp_counts[code_point] = 0;
+        } else {
+            hist_ptr->pages[(code_point - bmp_size) >> page_bits][code_point & (page_size - 1)] = 0;
+        }
+    }
+    hist_ptr->seen_count = 0;
+}
+
+static void histogram_destroy(struct histogram_type* hist_ptr) {
+    for (size_t i = 0; i < sizeof(hist_ptr->pages) / sizeof(hist_ptr->pages[0]); i++) {
+        free(hist_ptr->pages[i]);
+    }
+    free(hist_ptr->seen);
+    free(hist_ptr);
 }
 
 struct line_info_type {
@@ -69,18 +187,18 @@ struct line_info_type {
     ssize_t len;
 };
 
-#define lim (4096 * 4)
-
 int main(void) {
     struct line_info_type line = {.buf = NULL};
 
-    unsigned char* arena_buf = malloc(lim);
-    arena_type arena;
-    arena_init(&arena, lim, arena_buf);
-
-    ucharht_type* ht_ptr = ucharht_create(lim);
-    ucharpque_type* pque_ptr = ucharpque_create(lim);
+    struct histogram_type* hist_ptr = calloc(1, sizeof(struct histogram_type));
+    size_t pque_capacity = 256;
+    ucharpque_type* pque_ptr = ucharpque_create(pque_capacity);
+    if (hist_ptr == NULL || pque_ptr == NULL) {
+        fprintf(stderr, "%s\n", strerror(ENOMEM));
+        goto cleanup;
+    }
 
+    size_t line_number = 0;
     while (line.buf == NULL || !feof(stdin)) {
 
         line.len = getline(&line.buf, &line.capacity, stdin);
@@ -90,58 +208,89 @@ int main(void) {
             }
             break;
         }
+        line_number++;
+
+        // count up to the first null character, as the string it would be in c
+        const unsigned char* s = (const unsigned char*)line.buf;
+        const char* null_ptr = memchr(line.buf, '\0', (size_t)line.len);
+        size_t len = null_ptr != NULL ? (size_t)(null_ptr - line.buf) : (size_t)line.len;
 
-        for (size_t i = 0, n = 0; i < (size_t)line.len; i += int_max(1, n)) {
-            if (line.buf[i] == '\0') {
+        // the decoded code point is the key, so counting does not allocate, hash or compare strings. the line is
+        // validated up to the next error, so the bytes before can be decoded without checks. each invalid sequence
+        // counts as one U+FFFD.
+        size_t invalid_count = 0;
+        size_t first_invalid_offset = 0;
+        size_t i = 0;
+        while (i < len) {
+            size_t valid_end = i + utf8_validate(&s[i], len - i);
+            while (i < valid_end) {
+                if (s[i] < ascii_size) {
+                    i += histogram_add_ascii(hist_ptr, &s[i], valid_end - i);
+                    continue;
+                }
+                if (!histogram_add(hist_ptr, utf8_get_differing_bits(&s[i]))) {
+                    fprintf(stderr, "%s\n", strerror(ENOMEM));
+                    goto reset;
+                }
+                i += utf8_num_of_bytes(&s[i]);
+            }
+            if (i == len) {
                 break;
-            } else if (line.buf[i] == ' ' || line.buf[i] == '\n' || line.buf[i] == '\t') {
-                continue;
             }
-
-            n = utf8_num_of_bytes((unsigned char*)&line.buf[i]);
-
-            char* str = arena_allocate(&arena, n + 1);
-            if (!str) {
-                fprintf(stderr, "line too long. sorry.\n");
+            if (invalid_count++ == 0) {
+                first_invalid_offset = i;
+            }
+            if (!histogram_add(hist_ptr, replacement_character)) {
+                fprintf(stderr, "%s\n", strerror(ENOMEM));
                 goto reset;
             }
-            memcpy(str, &line.buf[i], n);
-            str[n] = '\0';
+            bool valid;
+            i += utf8_sequence_length(&s[i], len - i, &valid);
+        }
+        if (invalid_count != 0) {
+            fprintf(stderr, "line %zu: %zu invalid utf8 sequence(s) replaced by U+FFFD, the first at byte %zu.\n",
+                    line_number, invalid_count, first_invalid_offset);
+        }
 
-            if (!ucharht_contains_key(ht_ptr, str)) {
-                if (ucharht_is_full(ht_ptr)) {
-                    fprintf(stderr, "line too long. sorry.\n");
-                    goto reset;
-                }
-                ucharht_insert(ht_ptr, str, 1);
-            } else {
-                (*ucharht_get_value_mut(ht_ptr, str))++;
+        if (pque_capacity < ascii_size + hist_ptr->seen_count) {
+            ucharpque_destroy(pque_ptr);
+            while (pque_capacity < ascii_size + hist_ptr->seen_count) {
+                pque_capacity *= 2;
+            }
+            pque_ptr = ucharpque_create(pque_capacity);
+            if (pque_ptr == NULL) {
+                fprintf(stderr, "%s\n", strerror(ENOMEM));
+                goto cleanup;
             }
         }
-
-        {
-            size_t tempi;
-            char* key;
-            unsigned int value;
-            fhashtable_for_each(ht_ptr, tempi, key, value) {
-                ucharpque_push(pque_ptr, key, value);
+        // whitespace is counted along with the rest of ascii, but not shown
+        for (uint32_t code_point = 0; code_point < ascii_size; code_point++) {
+            if (hist_ptr->bmp_counts[code_point] != 0 && code_point != ' ' && code_point != '\n' && code_point != '\t') {
+                ucharpque_push(pque_ptr, code_point, hist_ptr->bmp_counts[code_point]);
             }
         }
+        for (size_t i = 0; i < hist_ptr->seen_count; i++) {
+            ucharpque_push(pque_ptr, hist_ptr->seen[i], histogram_get(hist_ptr, hist_ptr->seen[i]));
+        }
 
         while (!ucharpque_is_empty(pque_ptr)) {
-            const char* key = ucharpque_pop_max(pque_ptr);
-            const uint32_t differing_bits = utf8_get_differing_bits((unsigned char*)key);
+            const uint32_t differing_bits = ucharpque_pop_max(pque_ptr);
+            char key[4];
+            size_t key_len = utf8_encode(differing_bits, key);
 
-            printf("%s (U+%X): %d\n", key, differing_bits, ucharht_get_value(ht_ptr, key, -1));
+            printf("%.*s (U+%X): %u\n", (int)key_len, key, differing_bits, histogram_get(hist_ptr, differing_bits));
         }
 
     reset:
-        arena_deallocate_all(&arena);
-        ucharht_clear(ht_ptr);
+        histogram_clear(hist_ptr);
     }
 
+cleanup:
     free(line.buf);
-    free(arena_buf);
-    ucharht_destroy(ht_ptr);
-    ucharpque_destroy(pque_ptr);
+    if (hist_ptr != NULL) {
+        histogram_destroy(hist_ptr);
+    }
+    if (pque_ptr != NULL) {
+        ucharpque_destroy(pque_ptr);
+    }
 }
@@ -0,0 +1,192 @@
+/*
+    utf8 validation following Keiser and Lemire, "Validating UTF-8 In Less Than One Instruction Per Byte" (2021).
+
+    every error in utf8 shows within the first two bytes of a sequence, or as a wrong number of continuation bytes. for
+    each pair of adjacent bytes, three 16-entry tables indexed by the high and low nibble of the first byte and the high
+    nibble of the second byte give the errors the pair could be part of, one per bit. the pair is invalid if a bit is set
+    in all three. whether a continuation byte is the third or fourth of a sequence is checked against the bytes two and
+    three places back.
+
+    16 bytes are checked at a time with SSSE3, which is used if the processor has it. blocks of only ascii skip the
+    tables. once a block has an error, the exact offset is found by the scalar validator, starting at the last sequence
+    that began before the block.
+*/
+
+#include <stdbool.h> // bool, true, false
+#include <stdint.h>  // uint8_t
+#include <string.h>  // memcpy
+
+#include "utf8_validate.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define UTF8_VALIDATE_SSSE3
+#include <tmmintrin.h> // _mm_*
+#endif
+
+size_t utf8_sequence_length(const unsigned char* s, size_t len, bool* valid_ptr) {
+    // https://www.unicode.org/versions/latest/core-spec/chapter-3/#G27506 (well-formed utf8 byte sequences)
+    unsigned char lead = s[0];
+    unsigned char low = 0x80;
+    unsigned char high = 0xBF;
+    size_t n;
+    if (lead < 0x80) {
+        *valid_ptr = true;
+        return 1;
+    } else if (lead >= 0xC2 && lead <= 0xDF) {
+        n = 2;
+    } else if (lead >= 0xE0 && lead <= 0xEF) {
+        n = 3;
+        low = lead == 0xE0 ? 0xA0 : low;   // overlong
+        high = lead == 0xED ? 0x9F : high; // surrogates
+    } else if (lead >= 0xF0 && lead <= 0xF4) {
+        n = 4;
+        low = lead == 0xF0 ? 0x90 : low;   // overlong
+        high = lead == 0xF4 ? 0x8F : high; // above U+10FFFF
+    } else {
+        *valid_ptr = false;
+        return 1;
+    }
+    for (size_t i = 1; i < n; i++) {
+        if (i >= len || s[i] < low || s[i] > high) {
+            *valid_ptr = false;
+            return i;
+        }
+        low = 0x80;
+        high = 0xBF;
+    }
+    *valid_ptr = true;
+    return n;
+}
+
+static size_t utf8_validate_scalar(const unsigned char* s, size_t len) {
+    size_t i = 0;
+    while (i < len) {
+        bool valid;
+        size_t n = utf8_sequence_length(&s[i], len - i, &valid);
+        if (!valid) {
+            return i;
+        }
+        i += n;
+    }
+    return len;
+}
+
+#if defined(UTF8_VALIDATE_SSSE3)
+
+// error bits of the tables. an error is found if its bit is set for both nibbles of the first byte and for the second.
+#define TOO_SHORT (1 << 0)      // 11______ 0_______, 11______ 11______
+#define TOO_LONG (1 << 1)       // 0_______ 10______
+#define OVERLONG_3 (1 << 2)     // 11100000 100_____
+#define TOO_LARGE (1 << 3)      // 11110100 1001____, 11110100 101_____, 11110101+ 10______
+#define SURROGATE (1 << 4)      // 11101101 101_____
+#define OVERLONG_2 (1 << 5)     // 1100000_ 10______
+#define TOO_LARGE_1000 (1 << 6) // 11110101+ 1000____
+#define OVERLONG_4 (1 << 6)     // 11110000 1000____
+#define TWO_CONTS (1 << 7)      // 10______ 10______, unless the second is the third or fourth byte of a sequence
+#define CARRY (TOO_SHORT | TOO_LONG | TWO_CONTS)
+
+__attribute__((target("ssse3"))) static size_t utf8_validate_ssse3(const unsigned char* s, size_t len) {
+    const __m128i byte_1_high_table =
+        _mm_setr_epi8(TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, // 0_______
+                      (char)TWO_CONTS, (char)TWO_CONTS, (char)TWO_CONTS, (char)TWO_CONTS,             // 10______
+                      TOO_SHORT | OVERLONG_2,                                                         // 1100____
+                      TOO_SHORT,                                                                      // 1101____
+                      TOO_SHORT | OVERLONG_3 | SURROGATE,                                             // 1110____
+                      (char)(TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4));                   // 1111____
+    const __m128i byte_1_low_table =
+        _mm_setr_epi8((char)(CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4), // ____0000
+                      (char)(CARRY | OVERLONG_2),                           // ____0001
+                      (char)CARRY, (char)CARRY,                             // ____001_
+                      (char)(CARRY | TOO_LARGE),                            // ____0100
+                      (char)(CARRY | TOO_LARGE | TOO_LARGE_1000),           // ____0101
+                      (char)(CARRY | TOO_LARGE | TOO_LARGE_1000),           // ____0110
+                      (char)(CARRY | TOO_LARGE | TOO_LARGE_1000),           // ____0111
+                      (char)(CARRY | TOO_LARGE | TOO_LARGE_1000),           // ____1000
+                      (char)(CARRY | TOO_LARGE | TOO_LARGE_1000),           // ____1001
+                      (char)(CARRY | TOO_LARGE | TOO_LARGE_1000),           // ____1010
+                      (char)(CARRY | TOO_LARGE | TOO_LARGE_1000),           // ____1011
+                      (char)(CARRY | TOO_LARGE | TOO_LARGE_1000),           // ____1100
+                      (char)(CARRY | TOO_LARGE | TOO_LARGE_1000 | SURROGATE), // ____1101
+                      (char)(CARRY | TOO_LARGE | TOO_LARGE_1000),           // ____1110
+                      (char)(CARRY | TOO_LARGE | TOO_LARGE_1000));          // ____1111
+    const __m128i byte_2_high_table = _mm_setr_epi8(
+        TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,    // 0_______
+        (char)(TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE_1000 | OVERLONG_4),     // 1000____
+        (char)(TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE),                      // 1001____
+        (char)(TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE),                       // 101_____
+        (char)(TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE),                       //
+        TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT);                                             // 11______
+    const __m128i nibble_mask = _mm_set1_epi8(0x0F);
+    // a lead byte in the last three places above these needs bytes from the next block
+    const __m128i incomplete_max = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, (char)(0xF0 - 1),
+                                                 (char)(0xE0 - 1), (char)(0xC0 - 1));
+
+    __m128i prev_input = _mm_setzero_si128();
+    __m128i prev_incomplete = _mm_setzero_si128();
+    size_t pos = 0;
+    while (pos < len) {
+        __m128i input;
+        if (len - pos >= 16) {
+            input = _mm_loadu_si128((const __m128i*)&s[pos]);
+        } else {
+            // zeros after the end cut off any sequence left open
+            unsigned char tail[16] = {0};
+            memcpy(tail, &s[pos], len - pos);
+            input = _mm_loadu_si128((const __m128i*)tail);
+        }
+
+        __m128i error;
+        if (_mm_movemask_epi8(input) == 0) {
+            error = prev_incomplete;
+            prev_incomplete = _mm_setzero_si128();
+        } else {
+            __m128i prev1 = _mm_alignr_epi8(input, prev_input, 15);
+            __m128i byte_1_high =
+                _mm_shuffle_epi8(byte_1_high_table, _mm_and_si128(_mm_srli_epi16(prev1, 4), nibble_mask));
+            __m128i byte_1_low = _mm_shuffle_epi8(byte_1_low_table, _mm_and_si128(prev1, nibble_mask));
+            __m128i byte_2_high =
+                _mm_shuffle_epi8(byte_2_high_table, _mm_and_si128(_mm_srli_epi16(input, 4), nibble_mask));
+            __m128i special_cases = _mm_and_si128(_mm_and_si128(byte_1_high, byte_1_low), byte_2_high);
+
+            // bit 7 is set where the byte two places back leads a sequence of three or more bytes, or the byte three
+            // places back one of four bytes. exactly there, two continuation bytes in a row are expected
+            __m128i prev2 = _mm_alignr_epi8(input, prev_input, 14);
+            __m128i prev3 = _mm_alignr_epi8(input, prev_input, 13);
+            __m128i must_be_2_3_continuation = _mm_and_si128(
+                _mm_or_si128(_mm_subs_epu8(prev2, _mm_set1_epi8(0xE0 - 0x80)), _mm_subs_epu8(prev3, _mm_set1_epi8(0xF0 - 0x80))),
+                _mm_set1_epi8((char)0x80));
+            error = _mm_xor_si128(must_be_2_3_continuation, special_cases);
+            prev_incomplete = _mm_subs_epu8(input, incomplete_max);
+        }
+        prev_input = input;
+
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(error, _mm_setzero_si128())) != 0xFFFF) {
+            break;
+        }
+        pos += 16;
+    }
+    if (pos >= len && _mm_movemask_epi8(_mm_cmpeq_epi8(prev_incomplete, _mm_setzero_si128())) == 0xFFFF) {
+        return len;
+    }
+    pos = pos < len ? pos : len;
+
+    // the error is in a sequence starting in this block, or in one of the last three bytes before it. the bytes before
+    // were checked, so the first byte that is not a continuation byte among the four before the block starts a
+    // sequence.
+    size_t start = pos >= 4 ? pos - 4 : 0;
+    while (start < pos && (s[start] & 0xC0) == 0x80) {
+        start++;
+    }
+    return start + utf8_validate_scalar(&s[start], len - start);
+}
+
+#endif
+
+size_t utf8_validate(const unsigned char* s, size_t len) {
+#if defined(UTF8_VALIDATE_SSSE3)
+    if (__builtin_cpu_supports("ssse3")) {
+        return utf8_validate_ssse3(s, len);
+    }
+#endif
+    return utf8_validate_scalar(s, len);
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <stdbool.h> // bool
+#include <stddef.h>  // size_t
+
+// offset of the first byte of `s` that does not belong to a valid utf8 sequence, or `len` if all of it is valid. a
+// sequence cut off by the end of `s` is invalid. overlong encodings, surrogates and code points above U+10FFFF are
+// invalid as well.
+size_t utf8_validate(const unsigned char* s, size_t len);
+
+// length of the sequence at the start of `s`, which must not be empty. if the sequence is not valid, `*valid_ptr` is
+// set to false, and the length is that of its maximal subpart: the longest start of a valid sequence, or 1 byte. each
+// maximal subpart is replaced by one U+FFFD, as recommended by the unicode standard.
+size_t utf8_sequence_length(const unsigned char* s, size_t len, bool* valid_ptr);